@@ -0,0 +1,273 @@
+#include <float.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "astar.hpp"
+#include "deltastep.hpp"
+#include "alt.hpp"
+
+
+/*
+ * Landmarks are chosen one after the other, each from the distances of the
+ * previous ones, so the one-to-all searches cannot run side by side: the
+ * threads go into each search instead (delta-stepping on numThreads workers,
+ * see distanceField()). The field of a landmark is its row of the table.
+ *
+ * Only the cells SOURCE could share a component with matter: everything is
+ * chosen in the component of the free cell closest to the centre of the
+ * grid, so that small islands do not take landmarks.
+ */
+
+/* Free cell the closest to the centre of the grid, -1 if there is none */
+static int centralCell(const BlockLabels* labels, Grid windowSize)
+{
+    int idx, best = -1;
+    long bestDistance = -1;
+
+    for (idx = 0; idx < windowSize.nrow * windowSize.ncol; idx++)
+    {
+        long dx = 2 * (idx % windowSize.ncol) - windowSize.ncol;
+        long dy = 2 * (idx / windowSize.ncol) - windowSize.nrow;
+        if (labels[idx] == LBL_BLOCKED || (best != -1 && dx * dx + dy * dy >= bestDistance))
+            continue;
+        best = idx;
+        bestDistance = dx * dx + dy * dy;
+    }
+    return best;
+}
+
+static float* landmarkField(const BlockLabels* labels, Grid windowSize, int sourceIdx, int numThreads)
+{
+    SearchQuery query;
+
+    initSearchQuery(&query);
+    query.labels = labels;
+    query.grid = windowSize;
+    query.sourceIdx = sourceIdx;
+    query.numThreads = numThreads;
+    return distanceField(&query, DELTA_STEPPING_WIDTH);
+}
+
+/* Lower bound of the distance between two cells from the landmarks chosen so far */
+static float landmarkBound(float* const* fields, int numLandmarks, int fromIdx, int toIdx)
+{
+    int l;
+    float best = 0.0f;
+
+    for (l = 0; l < numLandmarks; l++)
+        if (fields[l][fromIdx] != FLT_MAX && fields[l][toIdx] != FLT_MAX)
+            best = MAX2(best, ABS(fields[l][fromIdx] - fields[l][toIdx]));
+    return best;
+}
+
+/* Cell of the component whose smallest distance to a landmark is the largest */
+static int farthestCell(float* const* fields, int numLandmarks, int numElement)
+{
+    int idx, l, best = -1;
+    float bestDistance = -1.0f;
+
+    for (idx = 0; idx < numElement; idx++)
+    {
+        float nearest = FLT_MAX;
+        if (fields[0][idx] == FLT_MAX)
+            continue;
+        for (l = 0; l < numLandmarks; l++)
+            nearest = MIN2(nearest, fields[l][idx]);
+        if (nearest > bestDistance)
+        {
+            best = idx;
+            bestDistance = nearest;
+        }
+    }
+    return best;
+}
+
+/*
+ * Avoid: grow the shortest path tree of a random root, weigh every cell by
+ * how much the current landmarks underestimate its distance to the root, and
+ * walk down from the root into the heaviest subtree that holds no landmark
+ * yet. Its leaf is the new landmark.
+ */
+static int avoidCell(const BlockLabels* labels, Grid windowSize, float* const* fields, int numLandmarks,
+                     const int* landmarks, int rootIdx, int numThreads)
+{
+    int numElement = windowSize.nrow * windowSize.ncol, ncol = windowSize.ncol;
+    float* root = landmarkField(labels, windowSize, rootIdx, numThreads);
+    std::vector<int> parent(numElement, -1), order;
+    std::vector<double> size(numElement, 0.0);
+    std::vector<bool> covered(numElement, false);
+    int i, idx, padx, pady, current, best;
+
+    for (idx = 0; idx < numElement; idx++)
+        if (root[idx] != FLT_MAX)
+            order.push_back(idx);
+    std::sort(order.begin(), order.end(), [root](int a, int b) { return root[a] < root[b]; });
+
+    /* Parent of a cell: the neighbour it is reached from on a shortest path */
+    for (i = 1; i < (int) order.size(); i++)
+    {
+        int x, y;
+        float bestValue = FLT_MAX;
+
+        idx = order[i];
+        x = idx % ncol;
+        y = idx / ncol;
+        for (pady = -1; pady <= 1; pady++)
+            for (padx = -1; padx <= 1; padx++)
+            {
+                int next = idx + padx + pady * ncol;
+                if ((padx == 0 && pady == 0) ||
+                    x + padx < 0 || x + padx >= ncol || y + pady < 0 || y + pady >= windowSize.nrow ||
+                    root[next] == FLT_MAX ||
+                    root[next] + adjDistance(padx, pady) >= bestValue)
+                    continue;
+                bestValue = root[next] + adjDistance(padx, pady);
+                parent[idx] = next;
+            }
+    }
+
+    /* Subtree weights, from the leaves up; a landmark zeroes the whole path to the root */
+    for (i = 0; i < numLandmarks; i++)
+        covered[landmarks[i]] = true;
+    for (i = (int) order.size() - 1; i >= 0; i--)
+    {
+        idx = order[i];
+        if (!covered[idx])
+            size[idx] += root[idx] - landmarkBound(fields, numLandmarks, rootIdx, idx);
+        else
+            size[idx] = 0.0;
+        if (parent[idx] != -1)
+        {
+            size[parent[idx]] += size[idx];
+            if (covered[idx])
+                covered[parent[idx]] = true;
+        }
+    }
+
+    current = rootIdx;
+    while (true)
+    {
+        int x = current % ncol, y = current / ncol;
+
+        best = -1;
+        for (pady = -1; pady <= 1; pady++)
+            for (padx = -1; padx <= 1; padx++)
+            {
+                int next = current + padx + pady * ncol;
+                if ((padx == 0 && pady == 0) ||
+                    x + padx < 0 || x + padx >= ncol || y + pady < 0 || y + pady >= windowSize.nrow ||
+                    parent[next] != current || size[next] <= 0.0 ||
+                    (best != -1 && size[next] <= size[best]))
+                    continue;
+                best = next;
+            }
+        if (best == -1)
+            break;
+        current = best;
+    }
+
+    free(root);
+    return (current == rootIdx && numLandmarks > 0) ? -1 : current;
+}
+
+/*
+ * Choose `numLandmarks` landmarks and store their distance to every cell.
+ * Returns NULL if the grid has no free cell.
+ */
+AltTable* altBuild(const BlockLabels* labels, Grid windowSize, int numLandmarks,
+                   LandmarkSelection selection, int numThreads)
+{
+    int numElement = windowSize.nrow * windowSize.ncol;
+    int centre = centralCell(labels, windowSize), i, l, next;
+    std::vector<float*> fields;
+    std::vector<int> component;
+    std::mt19937 rng(1);
+    AltTable* table;
+    float* start;
+
+    if (centre == -1 || numLandmarks <= 0)
+        return NULL;
+
+    table = (AltTable*) malloc(sizeof(AltTable));
+    table->windowSize = windowSize;
+    table->landmarks = (int*) malloc(numLandmarks * sizeof(int));
+
+    start = landmarkField(labels, windowSize, centre, numThreads);
+    for (i = 0; i < numElement; i++)
+        if (start[i] != FLT_MAX)
+            component.push_back(i);
+
+    for (l = 0; l < numLandmarks; l++)
+    {
+        if (selection == LANDMARK_AVOID)
+        {
+            int rootIdx = (l == 0) ? centre : component[rng() % component.size()];
+            next = avoidCell(labels, windowSize, fields.data(), l, table->landmarks, rootIdx, numThreads);
+            if (next == -1)
+                next = farthestCell(fields.data(), l, numElement);
+        }
+        else if (l == 0)
+        {
+            fields.push_back(start);
+            next = farthestCell(fields.data(), 1, numElement);
+            fields.pop_back();
+        }
+        else
+            next = farthestCell(fields.data(), l, numElement);
+
+        /* A component too small for more landmarks */
+        if (next == -1 || std::find(table->landmarks, table->landmarks + l, next) != table->landmarks + l)
+            break;
+        table->landmarks[l] = next;
+        fields.push_back(landmarkField(labels, windowSize, next, numThreads));
+    }
+    free(start);
+
+    table->numLandmarks = (int) fields.size();
+    table->distance = (uint32_t*) malloc((size_t) numElement * table->numLandmarks * sizeof(uint32_t));
+    for (i = 0; i < numElement; i++)
+        for (l = 0; l < table->numLandmarks; l++)
+            table->distance[(size_t) i * table->numLandmarks + l] = (fields[l][i] == FLT_MAX) ?
+                ALT_UNREACHABLE : (uint32_t) ((double) fields[l][i] * ALT_SCALE);
+    for (l = 0; l < table->numLandmarks; l++)
+        free(fields[l]);
+    return table;
+}
+
+void altFree(AltTable* table)
+{
+    if (table == NULL)
+        return;
+    free(table->landmarks);
+    free(table->distance);
+    free(table);
+}
+
+/*
+ * Lower bound of the distance from `idx` to `targetIdx`: the largest
+ * |d(L, TARGET) - d(L, idx)|, minus one unit for the rounding of the two
+ * entries. FLT_MAX when a landmark reaches only one of the cells, i.e.
+ * they lie in different components.
+ */
+float altHeuristic(const AltTable* table, int idx, int targetIdx)
+{
+    const uint32_t* from = table->distance + (size_t) idx * table->numLandmarks;
+    const uint32_t* to = table->distance + (size_t) targetIdx * table->numLandmarks;
+    uint32_t best = 0;
+    int l;
+
+    for (l = 0; l < table->numLandmarks; l++)
+    {
+        uint32_t difference;
+
+        if ((from[l] == ALT_UNREACHABLE) != (to[l] == ALT_UNREACHABLE))
+            return FLT_MAX;
+        if (from[l] == ALT_UNREACHABLE)
+            continue;
+        difference = (from[l] > to[l]) ? from[l] - to[l] : to[l] - from[l];
+        best = MAX2(best, difference);
+    }
+    return (best <= 1) ? 0.0f : (float) (best - 1) / ALT_SCALE;
+}
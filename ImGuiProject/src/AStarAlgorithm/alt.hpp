@@ -0,0 +1,38 @@
+/*
+ * ALT heuristic (Goldberg & Harrelson, 2005): A*, Landmarks and the
+ * Triangle inequality. The exact distance from a few landmark cells to every
+ * cell is computed once per map; |d(L, TARGET) - d(L, n)| is then a lower
+ * bound of the distance from n to TARGET that, unlike the octile distance,
+ * knows about the walls between them.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+#define ALT_NUM_LANDMARKS       8
+
+/*
+ * Distances are stored rounded down to 1/ALT_SCALE, in 32 bits: up to
+ * 2^32 / ALT_SCALE (about 16.7 million moves) from a landmark.
+ */
+#define ALT_SCALE               256
+#define ALT_UNREACHABLE         UINT32_MAX
+
+typedef enum LandmarkSelection
+{
+    LANDMARK_FARTHEST,          /* each landmark the farthest cell from the previous ones */
+    LANDMARK_AVOID              /* the leaf of the tree region the landmarks cover worst  */
+} LandmarkSelection;
+
+struct AltTable
+{
+    Grid         windowSize;
+    int          numLandmarks;
+    int         *landmarks;     /* cell of each landmark                                     */
+    uint32_t    *distance;      /* nrow*ncol rows of numLandmarks entries, in 1/ALT_SCALE units */
+};
+
+AltTable* altBuild(const BlockLabels* labels, Grid windowSize, int numLandmarks,
+                   LandmarkSelection selection, int numThreads);
+void altFree(AltTable* table);
+float altHeuristic(const AltTable* table, int idx, int targetIdx);
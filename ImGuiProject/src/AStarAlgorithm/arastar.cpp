@@ -0,0 +1,248 @@
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "arastar.hpp"
+
+
+/*
+ * Each iteration is a weighted A* keyed by g + weight * h, in which a cell
+ * is expanded at most once: a cell whose g improves after its expansion goes
+ * to INCONS instead of back to OPEN. The next iteration starts from OPEN and
+ * INCONS with the new weight, everything else (g, prev) is kept.
+ *
+ * After an iteration, cost(path) / min(g + h) over OPEN and INCONS bounds
+ * how far the path found is from the optimum. The search ends once that
+ * bound is 1, or when the time budget runs out; the first iteration always
+ * completes, the budget only limits the improvements.
+ */
+
+typedef enum AraProgress
+{
+    ARA_DONE,                   /* no cell left with a key below g(TARGET)  */
+    ARA_OUT_OF_TIME,
+    ARA_ABORTED
+} AraProgress;
+
+typedef struct AraSearch
+{
+    const SearchQuery  *query;
+    Cell               *listCell;
+    OpenList            open;
+    int                *closedIn;   /* iteration that expanded the cell, 0 if none   */
+    int                *inconsIn;   /* iteration that put the cell in INCONS         */
+    int                 iteration;
+    float               weight;
+    long                deadline;   /* microseconds, 0: no limit                    */
+    SearchStats        *stats;
+} AraSearch;
+
+static AraProgress improvePath(AraSearch* search)
+{
+    const SearchQuery* query = search->query;
+    const BlockLabels* labels = query->labels;
+    Grid windowSize = query->grid;
+    int targetIdx = query->targetIdx, sourceIdx = query->sourceIdx;
+    Cell* listCell = search->listCell;
+
+    while (search->open.size > 0 && openListTopKey(&search->open) < listCell[targetIdx].g)
+    {
+        int padx, pady, mainX, mainY, mainCellIdx;
+
+        if (search->deadline != 0 && search->stats->expanded % ARA_CLOCK_PERIOD == 0 &&
+            getCurrentMicroSecs() >= search->deadline)
+            return ARA_OUT_OF_TIME;
+
+        mainCellIdx = openListPop(&search->open);
+        if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITING))
+            return ARA_ABORTED;
+        search->closedIn[mainCellIdx] = search->iteration;
+        search->stats->expanded++;
+
+        mainX = mainCellIdx % windowSize.ncol;
+        mainY = mainCellIdx / windowSize.ncol;
+        for (pady = -1; pady <= 1; pady++)
+        {
+            for (padx = -1; padx <= 1; padx++)
+            {
+                OctileCost steps;
+                float successor_g;
+                Cell* successorCell;
+                int successorIdx;
+
+                if ((padx == 0 && pady == 0) ||
+                    mainX + padx < 0 || mainX + padx >= windowSize.ncol ||
+                    mainY + pady < 0 || mainY + pady >= windowSize.nrow)
+                    continue;
+
+                successorIdx = mainCellIdx + padx + pady * windowSize.ncol;
+                successorCell = &listCell[successorIdx];
+                if (labels[successorIdx] == LBL_BLOCKED || successorIdx == sourceIdx)
+                    continue;
+
+                steps = listCell[mainCellIdx].steps;
+                if (padx != 0 && pady != 0)
+                    steps.diagonal++;
+                else
+                    steps.straight++;
+                successor_g = octileValue(steps);
+                if (successorCell->g <= successor_g)
+                    continue;
+
+                if (successorCell->h == INT_MAX)
+                    successorCell->h = octileValue(octileDistance(successorIdx, targetIdx, windowSize.ncol));
+                successorCell->g = successor_g;
+                successorCell->steps = steps;
+                successorCell->prev = mainCellIdx;
+                successorCell->f = successor_g + search->weight * successorCell->h;
+
+                /* Expanded in this iteration already: wait for the next one */
+                if (search->closedIn[successorIdx] == search->iteration)
+                {
+                    search->inconsIn[successorIdx] = search->iteration;
+                    continue;
+                }
+
+                openListPush(&search->open, successorIdx, successorCell->f,
+                             tieBreakValue(query->tieBreaking, successor_g, successorCell->h));
+                search->stats->generated++;
+                search->stats->maxOpenSize = MAX2(search->stats->maxOpenSize, (long) search->open.size);
+                if (NOTIFY_OBSERVER(query, successorIdx, LBL_TOBEVISITED))
+                    return ARA_ABORTED;
+            }
+        }
+
+        if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITED))
+            return ARA_ABORTED;
+    }
+    return ARA_DONE;
+}
+
+/*
+ * Store the path the `prev` links give now. A cell of INCONS may have lowered
+ * its g after its successors took it as `prev`, so the path can be shorter
+ * than g(TARGET): its cost is summed again along the path.
+ */
+static void storeCurrentPath(AraSearch* search, SearchResult* result)
+{
+    int i, ncol = search->query->grid.ncol;
+    OctileCost steps = {0, 0};
+
+    storePath(search->listCell, search->query->targetIdx, result);
+    for (i = 1; i < result->pathLen; i++)
+    {
+        if (result->path[i] % ncol != result->path[i - 1] % ncol &&
+            result->path[i] / ncol != result->path[i - 1] / ncol)
+            steps.diagonal++;
+        else
+            steps.straight++;
+    }
+    result->cost = octileValue(steps);
+}
+
+/* Suboptimality bound of the stored path: its cost / min(g + h) over OPEN and INCONS */
+static float currentBound(AraSearch* search, float cost)
+{
+    int idx, numElement = search->query->grid.nrow * search->query->grid.ncol;
+    float lowest = FLT_MAX, ratio;
+
+    for (idx = 0; idx < numElement; idx++)
+        if (search->open.position[idx] != -1 || search->inconsIn[idx] == search->iteration)
+            lowest = MIN2(lowest, search->listCell[idx].g + search->listCell[idx].h);
+
+    if (lowest == FLT_MAX || cost <= lowest)
+        return 1.0f;
+    ratio = cost / lowest;
+    return MIN2(search->weight, ratio);
+}
+
+/* Next iteration: INCONS joins OPEN and every key takes the new weight */
+static void reopen(AraSearch* search)
+{
+    const SearchQuery* query = search->query;
+    int idx, numElement = query->grid.nrow * query->grid.ncol;
+
+    for (idx = 0; idx < numElement; idx++)
+    {
+        Cell* cell = &search->listCell[idx];
+        if (search->open.position[idx] == -1 && search->inconsIn[idx] != search->iteration)
+            continue;
+        cell->f = cell->g + search->weight * cell->h;
+        openListPush(&search->open, idx, cell->f, tieBreakValue(query->tieBreaking, cell->g, cell->h));
+    }
+    search->iteration++;
+}
+
+/*
+ * ARA* search of the query, starting with query->weight and lowering it by
+ * ARA_WEIGHT_STEP. result->suboptimality tells how far from the optimum the
+ * returned path may be: 1 when it is proven optimal.
+ */
+SearchStatus araStarSearch(const SearchQuery *query, SearchResult *result)
+{
+    Grid windowSize = query->grid;
+    int sourceIdx = query->sourceIdx, targetIdx = query->targetIdx;
+    int numElement = windowSize.nrow * windowSize.ncol;
+    AraSearch search;
+    AraProgress progress;
+    float bound;
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+
+    search.query = query;
+    search.listCell = initListCell(&windowSize, sourceIdx);
+    search.closedIn = (int*) calloc(numElement, sizeof(int));
+    search.inconsIn = (int*) calloc(numElement, sizeof(int));
+    search.iteration = 1;
+    search.weight = MAX2(1.0f, query->weight);
+    search.deadline = 0;
+    search.stats = &result->stats;
+    openListInit(&search.open, query->openList, numElement);
+
+    search.listCell[sourceIdx].h = octileValue(octileDistance(sourceIdx, targetIdx, windowSize.ncol));
+    search.listCell[sourceIdx].f = search.weight * search.listCell[sourceIdx].h;
+    openListPush(&search.open, sourceIdx, search.listCell[sourceIdx].f, 0.0f);
+
+    /* The first path is always searched to the end: there is nothing to return before it */
+    progress = improvePath(&search);
+    if (progress == ARA_DONE && search.listCell[targetIdx].g != INT_MAX)
+    {
+        storeCurrentPath(&search, result);
+        bound = currentBound(&search, result->cost);
+        if (query->timeBudget > 0)
+            search.deadline = getCurrentMicroSecs() + query->timeBudget;
+
+        while (bound > 1.0f && search.weight > 1.0f &&
+               (search.deadline == 0 || getCurrentMicroSecs() < search.deadline))
+        {
+            search.weight = MAX2(1.0f, search.weight - ARA_WEIGHT_STEP);
+            reopen(&search);
+            progress = improvePath(&search);
+            if (progress != ARA_DONE)
+                break;
+
+            free(result->path);
+            storeCurrentPath(&search, result);
+            bound = currentBound(&search, result->cost);
+        }
+        result->suboptimality = bound;
+    }
+
+    openListFree(&search.open);
+    free(search.listCell);
+    free(search.closedIn);
+    free(search.inconsIn);
+
+    if (progress == ARA_ABORTED)
+    {
+        free(result->path);
+        result->path = NULL;
+        result->pathLen = 0;
+        return SEARCH_ABORTED;
+    }
+    return (result->pathLen > 0) ? SEARCH_FOUND : SEARCH_NOT_FOUND;
+}
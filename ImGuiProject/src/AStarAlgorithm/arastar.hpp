@@ -0,0 +1,17 @@
+/*
+ * Anytime Repairing A*, ARA* (Likhachev, Gordon & Thrun, 2003): a first
+ * path is found quickly with the heuristic inflated by a weight, then the
+ * weight is lowered step by step, each search reusing the g values of the
+ * previous one, until it reaches 1 or the time budget of the query expires.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+#define ARA_INITIAL_WEIGHT      3.0f
+#define ARA_WEIGHT_STEP         0.5f
+
+/* Expansions between two looks at the clock */
+#define ARA_CLOCK_PERIOD        256
+
+SearchStatus araStarSearch(const SearchQuery *query, SearchResult *result);
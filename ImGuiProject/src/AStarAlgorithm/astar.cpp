@@ -0,0 +1,513 @@
+#include <assert.h>
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "jps.hpp"
+#include "bidir.hpp"
+#include "hda.hpp"
+#include "mq.hpp"
+#include "deltastep.hpp"
+#include "hpa.hpp"
+#include "blockastar.hpp"
+#include "dstarlite.hpp"
+#include "alt.hpp"
+#include "arastar.hpp"
+#include "rtaa.hpp"
+#include "theta.hpp"
+#include "subgoal.hpp"
+#include "cpd.hpp"
+#include "rsr.hpp"
+#include "goalbound.hpp"
+#include "swamp.hpp"
+
+
+long getCurrentMicroSecs()
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (long) now.tv_sec * (int)1e6 + now.tv_usec;
+}
+
+float adjDistance(int padx, int pady)
+{
+    if (padx == 0 && pady == 0)
+        return 0.0f;
+    if (padx == 0 || pady == 0)
+        return 1.0f;
+    return (float) SQRT2;
+}
+
+float octileValue(OctileCost cost)
+{
+    return (float) cost.straight + (float) cost.diagonal * SQRT2;
+}
+
+/* Obstacle-free distance between two cells: diagonal moves first, then straight ones */
+OctileCost octileDistance(int fromIdx, int toIdx, int ncol)
+{
+    OctileCost cost;
+    int diffX = ABS(toIdx % ncol - fromIdx % ncol);
+    int diffY = ABS(toIdx / ncol - fromIdx / ncol);
+
+    cost.diagonal = MIN2(diffX, diffY);
+    cost.straight = MAX2(diffX, diffY) - cost.diagonal;
+    return cost;
+}
+
+/*
+ * Initialize a heuristic distance from each node to the target
+ * The distance is composed of three kinds of movement: 1. Vertical,
+ * 2. Horizontal, 3. Diagonal 45 degrees.
+ */
+float* initHeuristicDistance(const BlockLabels* labels, Grid *windowSize, int targetIdx)
+{
+    assert(targetIdx >= 0);
+
+    int idx, numElement;
+    float* heuDistance;
+
+    numElement = windowSize->nrow * windowSize->ncol;
+    heuDistance = (float*) malloc(numElement * sizeof(float));
+
+    for (idx = 0; idx < numElement; ++idx)
+    {
+        if (labels[idx] == LBL_BLOCKED)
+        {
+            heuDistance[idx] = INT_MAX;
+            continue;
+        }
+
+        heuDistance[idx] = octileValue(octileDistance(idx, targetIdx, windowSize->ncol));
+    }
+
+    return heuDistance;
+}
+
+/*
+ * Init a list cell representing all block in the grid. The heuristic distance
+ * of a cell is filled in the first time the search reaches it.
+ */
+Cell* initListCell(Grid* windowSize, int sourceIdx)
+{
+    int i, numElement;
+    Cell *listCell;
+
+    numElement = windowSize->nrow * windowSize->ncol;
+    listCell   = (Cell*) malloc(sizeof(Cell) * numElement);
+
+    for (i = 0; i < numElement; i++)
+    {
+        listCell[i].f           = INT_MAX;
+        listCell[i].g           = (i == sourceIdx) ? 0.0f : INT_MAX;
+        listCell[i].h           = INT_MAX;
+        listCell[i].steps.straight = 0;
+        listCell[i].steps.diagonal = 0;
+        listCell[i].prev        = -1;
+    }
+
+    return listCell;
+}
+
+/* Everything but the grid, SOURCE and TARGET gets its default value */
+void initSearchQuery(SearchQuery *query)
+{
+    memset(query, 0, sizeof(SearchQuery));
+    query->sourceIdx = -1;
+    query->targetIdx = -1;
+    query->observer  = NULL;
+    query->userData  = NULL;
+    query->algorithm = ALGO_ASTAR;
+    query->preprocessed = NULL;
+    query->openList  = OPENLIST_HEAP;
+    query->tieBreaking = TIE_HIGH_G;
+    query->heuristic = HEURISTIC_OCTILE;
+    query->landmarks = NULL;
+    query->goalBounds = NULL;
+    query->swamps = NULL;
+    query->numThreads = 1;
+    query->weight = ARA_INITIAL_WEIGHT;
+    query->timeBudget = 0;
+}
+
+/* Secondary key of the open list: among equal f, the smallest value is popped first */
+float tieBreakValue(TieBreaking tieBreaking, float g, float h)
+{
+    switch (tieBreaking)
+    {
+        case TIE_HIGH_G:    return -g;
+        case TIE_LOW_H:     return h;
+        default:            return 0.0f;    /* equal ties => the push order (LIFO) decides */
+    }
+}
+
+void initSearchResult(SearchResult *result)
+{
+    memset(result, 0, sizeof(SearchResult));
+}
+
+void freeSearchResult(SearchResult *result)
+{
+    if (result->path)
+        free(result->path);
+    initSearchResult(result);
+}
+
+/* Walk the `prev` links back from TARGET and store them SOURCE first. */
+void storePath(Cell* listCell, int targetIdx, SearchResult *result)
+{
+    int idx, len;
+
+    len = 0;
+    for (idx = targetIdx; idx != -1; idx = listCell[idx].prev)
+        len++;
+
+    result->path    = (int*) malloc(len * sizeof(int));
+    result->pathLen = len;
+    result->cost    = listCell[targetIdx].g;
+    for (idx = targetIdx; idx != -1; idx = listCell[idx].prev)
+        result->path[--len] = idx;
+}
+
+/*
+ * Store the path to TARGET of an engine that only keeps the g of each cell
+ * (FLT_MAX if unreached): from TARGET, step to the neighbour it is reached
+ * from most cheaply among those with a smaller g, down to SOURCE. g strictly
+ * decreases along the walk, so it always ends; when every g is exact, the
+ * path is a shortest one.
+ */
+void storeDescentPath(const SearchQuery *query, const float* distance, SearchResult *result)
+{
+    Grid windowSize = query->grid;
+    int idx, len, capacity = 64;
+    int* reversed = (int*) malloc(capacity * sizeof(int));
+
+    len = 0;
+    idx = query->targetIdx;
+    reversed[len++] = idx;
+    while (idx != query->sourceIdx)
+    {
+        int padx, pady, best = -1;
+        int x = idx % windowSize.ncol, y = idx / windowSize.ncol;
+        float bestG = FLT_MAX;
+
+        for (pady = -1; pady <= 1; pady++)
+        {
+            for (padx = -1; padx <= 1; padx++)
+            {
+                int neighbourIdx = idx + padx + pady * windowSize.ncol;
+                float through;
+
+                if ((padx == 0 && pady == 0) ||
+                    x + padx < 0 || x + padx >= windowSize.ncol ||
+                    y + pady < 0 || y + pady >= windowSize.nrow ||
+                    distance[neighbourIdx] >= distance[idx])
+                    continue;
+                through = distance[neighbourIdx] + adjDistance(padx, pady);
+                if (through < bestG)
+                {
+                    best = neighbourIdx;
+                    bestG = through;
+                }
+            }
+        }
+
+        idx = best;
+        if (len == capacity)
+        {
+            capacity *= 2;
+            reversed = (int*) realloc(reversed, capacity * sizeof(int));
+        }
+        reversed[len++] = idx;
+    }
+
+    result->path    = (int*) malloc(len * sizeof(int));
+    result->pathLen = len;
+    result->cost    = distance[query->targetIdx];
+    for (idx = 0; idx < len; idx++)
+        result->path[idx] = reversed[len - 1 - idx];
+    free(reversed);
+}
+
+/*
+ * Replace the waypoints of a path by every cell of the segments joining
+ * them, so that all engines hand out the same cell-by-cell path as
+ * astarSearch(). A segment that is neither horizontal, vertical nor at 45
+ * degrees is walked with its diagonal moves first; the caller makes sure
+ * those cells are free.
+ */
+void expandPath(SearchResult *result, int ncol)
+{
+    int i, k, len, numCells;
+    int* cells;
+
+    if (result->pathLen < 2)
+        return;
+
+    numCells = 1;
+    for (i = 1; i < result->pathLen; i++)
+    {
+        int dx = result->path[i] % ncol - result->path[i - 1] % ncol;
+        int dy = result->path[i] / ncol - result->path[i - 1] / ncol;
+        numCells += MAX2(ABS(dx), ABS(dy));
+    }
+
+    cells = (int*) malloc(numCells * sizeof(int));
+    cells[0] = result->path[0];
+    len = 1;
+    for (i = 1; i < result->pathLen; i++)
+    {
+        int dx = result->path[i] % ncol - result->path[i - 1] % ncol;
+        int dy = result->path[i] / ncol - result->path[i - 1] / ncol;
+        int n = MAX2(ABS(dx), ABS(dy)), numDiagonal = MIN2(ABS(dx), ABS(dy));
+        int step = (dx > 0) - (dx < 0) + ((dy > 0) - (dy < 0)) * ncol;
+        int straight = (ABS(dx) > ABS(dy)) ? (dx > 0) - (dx < 0) : ((dy > 0) - (dy < 0)) * ncol;
+
+        for (k = 1; k <= n; k++)
+            cells[len++] = result->path[i - 1] + MIN2(k, numDiagonal) * step + MAX2(k - numDiagonal, 0) * straight;
+    }
+
+    free(result->path);
+    result->path    = cells;
+    result->pathLen = numCells;
+}
+
+bool isValidQuery(const SearchQuery *query)
+{
+    int numElement = query->grid.nrow * query->grid.ncol;
+
+    return (query->labels != NULL &&
+            query->sourceIdx >= 0 && query->sourceIdx < numElement &&
+            query->targetIdx >= 0 && query->targetIdx < numElement &&
+            query->labels[query->sourceIdx] != LBL_BLOCKED &&
+            query->labels[query->targetIdx] != LBL_BLOCKED);
+}
+
+/*
+ * DESIGN:
+ *  Calculate unblocked-target heuristic from each point to target
+ *  Blocked-target = infinity
+ *
+ * n: one of 8 neighbor
+ * g(n): exact cost from SOURCE to n.
+ * h(n): estimated cost from n to TARGET
+ * f(n) = g(n) + h(h)
+ *
+ * With HEURISTIC_ALT, h(n) is the larger of the octile distance and the
+ * landmark bound. The bound is rounded down, so it is not exactly consistent:
+ * an expanded cell goes back to the open list when a shorter way to it shows up.
+ */
+SearchStatus astarSearch(const SearchQuery *query, SearchResult *result)
+{
+    const BlockLabels* labels = query->labels;
+    Grid windowSize = query->grid;
+    int sourceIdx = query->sourceIdx, targetIdx = query->targetIdx;
+    int numElement = windowSize.nrow * windowSize.ncol;
+    SearchStatus status = SEARCH_NOT_FOUND;
+
+    Cell* listCell;
+    BlockLabels* state;         /* LBL_UNBLOCKED, LBL_TOBEVISITED, LBL_VISITED or LBL_BLOCKED (skipped swamp) */
+    OpenList openList;
+    const AltTable* alt = (query->heuristic == HEURISTIC_ALT) ? query->landmarks : NULL;
+    const GoalBoundTable* bounds = query->goalBounds;
+    const SwampMap* swamps = query->swamps;
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+    if (query->heuristic == HEURISTIC_ALT &&
+        (alt == NULL || alt->windowSize.nrow != windowSize.nrow || alt->windowSize.ncol != windowSize.ncol))
+        return SEARCH_INVALID;
+    if (bounds != NULL &&
+        (bounds->windowSize.nrow != windowSize.nrow || bounds->windowSize.ncol != windowSize.ncol))
+        return SEARCH_INVALID;
+    if (swamps != NULL &&
+        (swamps->windowSize.nrow != windowSize.nrow || swamps->windowSize.ncol != windowSize.ncol))
+        return SEARCH_INVALID;
+
+    listCell = initListCell(&windowSize, sourceIdx);
+    state = (BlockLabels*) calloc(numElement, sizeof(BlockLabels));
+    openListInit(&openList, query->openList, numElement);
+    if (swamps != NULL)
+        swampMarkSkipped(swamps, sourceIdx, targetIdx, state);
+
+    /* Init the openList with the source in order to start traversing */
+    listCell[sourceIdx].h = octileValue(octileDistance(sourceIdx, targetIdx, windowSize.ncol));
+    listCell[sourceIdx].f = listCell[sourceIdx].h;
+    openListPush(&openList, sourceIdx, listCell[sourceIdx].f, 0.0f);
+    state[sourceIdx] = LBL_TOBEVISITED;
+
+    while (openList.size > 0)
+    {
+        int padx, pady, mainX, mainY;
+        Cell* mainCell;
+        int mainCellIdx;
+
+        mainCellIdx = openListPop(&openList);
+        mainCell = &listCell[mainCellIdx];
+
+        /* Finally reach the TARGET? */
+        if (mainCellIdx == targetIdx)
+        {
+            storePath(listCell, targetIdx, result);
+            status = SEARCH_FOUND;
+            break;
+        }
+
+        if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITING))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+        state[mainCellIdx] = LBL_VISITED;
+        result->stats.expanded++;
+
+        mainX = mainCellIdx % windowSize.ncol;
+        mainY = mainCellIdx / windowSize.ncol;
+
+        for (pady = -1; pady <= 1; pady ++)
+        {
+            for (padx = -1; padx <= 1; padx ++)
+            {
+                float successor_f, successor_g, successor_h;
+                OctileCost steps, total;
+                Cell* successorCell;
+                int successorIdx;
+
+                /* Skip if the successor is invalid (out of grid) */
+                if (mainX + padx < 0 || mainX + padx >= windowSize.ncol ||
+                    mainY + pady < 0 || mainY + pady >= windowSize.nrow)
+                    continue;
+
+                /* Skip the moves that start no shortest path to TARGET */
+                if (bounds != NULL && (padx != 0 || pady != 0) &&
+                    !goalBoundAllows(bounds, mainCellIdx, padx, pady, targetIdx))
+                    continue;
+
+                successorIdx = mainCellIdx + padx + pady * windowSize.ncol;
+                successorCell = &listCell[successorIdx];
+
+                /* Skip if the successor is BLOCKED, in a skipped swamp, already expanded (octile only), or SOURCE */
+                if (labels[successorIdx] == LBL_BLOCKED ||
+                    state[successorIdx] == LBL_BLOCKED ||
+                    (state[successorIdx] == LBL_VISITED && alt == NULL) ||
+                    successorIdx == sourceIdx)
+                {
+                    continue;
+                }
+
+                /* process each successor, counting moves so that equal f are exactly equal */
+                steps = mainCell->steps;
+                if (padx != 0 && pady != 0)
+                    steps.diagonal++;
+                else
+                    steps.straight++;
+                total = octileDistance(successorIdx, targetIdx, windowSize.ncol);
+                successor_h = octileValue(total);                       /* from successor to target */
+                total.straight += steps.straight;
+                total.diagonal += steps.diagonal;
+                successor_g = octileValue(steps);                       /* from source to successor */
+                successor_f = octileValue(total);                       /* total from source to target */
+
+                /*
+                 * Update shortest path to the boundary of current block accordingly
+                 *
+                 * The cell may be visited in next rounds if either the new way with
+                 * shorter path is found, or it has not been visited yet.
+                 */
+                if (successorCell->g > successor_g)
+                {
+                    if (alt != NULL)
+                    {
+                        /* The bound only depends on the cell: computed when the cell is first reached */
+                        if (successorCell->h == INT_MAX)
+                            successorCell->h = MAX2(successor_h, altHeuristic(alt, successorIdx, targetIdx));
+                        /* FLT_MAX: the successor and TARGET lie in different components */
+                        if (successorCell->h == FLT_MAX)
+                            continue;
+                        if (successorCell->h > successor_h)
+                        {
+                            successor_h = successorCell->h;
+                            successor_f = successor_g + successor_h;
+                        }
+                    }
+                    successorCell->f = successor_f;
+                    successorCell->g = successor_g;
+                    successorCell->h = successor_h;
+                    successorCell->steps = steps;
+                    successorCell->prev = mainCellIdx;
+
+                    /* Queued already => this is a decrease-key, not a duplicate entry */
+                    state[successorIdx] = LBL_TOBEVISITED;
+                    openListPush(&openList, successorIdx, successor_f,
+                                 tieBreakValue(query->tieBreaking, successor_g, successor_h));
+                    result->stats.generated++;
+                    result->stats.maxOpenSize = MAX2(result->stats.maxOpenSize, (long) openList.size);
+
+                    if (NOTIFY_OBSERVER(query, successorIdx, LBL_TOBEVISITED))
+                    {
+                        status = SEARCH_ABORTED;
+                        goto done;
+                    }
+                }
+            }
+        }
+
+        if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITED))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+    }
+
+done:
+    openListFree(&openList);
+    free(state);
+    free(listCell);
+
+    return status;
+}
+
+/* Run the engine selected by `query->algorithm` */
+SearchStatus findPath(const SearchQuery *query, SearchResult *result)
+{
+    switch (query->algorithm)
+    {
+        case ALGO_JPS:
+            return jpsSearch(query, result);
+        case ALGO_JPS_PLUS:
+            return jpsPlusSearch(query, result);
+        case ALGO_BIDIRECTIONAL:
+            return bidirectionalSearch(query, result);
+        case ALGO_HDA:
+            return hdaSearch(query, result);
+        case ALGO_MULTIQUEUE:
+            return multiQueueSearch(query, result);
+        case ALGO_DELTA_STEPPING:
+            return deltaSteppingSearch(query, result);
+        case ALGO_HPA:
+            return hpaSearch(query, result);
+        case ALGO_BLOCK_ASTAR:
+            return blockAStarSearch(query, result);
+        case ALGO_DSTAR_LITE:
+            return dstarLiteSearch(query, result);
+        case ALGO_ARA_STAR:
+            return araStarSearch(query, result);
+        case ALGO_RTAA:
+            return rtaaSearch(query, result);
+        case ALGO_LAZY_THETA:
+            return lazyThetaSearch(query, result);
+        case ALGO_SUBGOAL:
+            return subgoalSearch(query, result);
+        case ALGO_CPD:
+            return cpdSearch(query, result);
+        case ALGO_RSR:
+            return rsrSearch(query, result);
+        default:
+            return astarSearch(query, result);
+    }
+}
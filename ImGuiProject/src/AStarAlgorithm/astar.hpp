@@ -0,0 +1,223 @@
+/*
+ * libastar: the headless search core of the A* visualizer.
+ *
+ * Nothing in here depends on ImGui or SDL. Every search function is
+ * reentrant: all working memory belongs to the call, there is no global
+ * state, no lock and no sleep. Engines that use several threads start and
+ * join them inside the call. Clients that want to animate a search
+ * (the visualizer in utils.cpp) do it through the SearchObserver hook.
+ *
+ * Cells are addressed by index: idx = x + y * ncol.
+ *
+ * Coordinator is as below:
+ * O -------------> x
+ * |
+ * |
+ * |
+ * y
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define ABS(x)                  ((x > 0) ? (x) : -(x))
+#define MAX2(x, y)              ((x > y) ? (x) : (y))
+#define MIN2(x, y)              ((x < y) ? (x) : (y))
+
+/* to avoid including math.h header to calculate square root */
+#define SQRT2                   1.41421356f
+
+typedef enum BlockLabels
+{
+    LBL_UNBLOCKED,
+    LBL_BLOCKED,
+    LBL_VISITED,
+    LBL_VISITING,
+    LBL_TOBEVISITED
+} BlockLabels;
+
+typedef struct Grid
+{
+    int          nrow;
+    int          ncol;
+} Grid;
+
+/*
+ * Octile distances are always a + b*sqrt(2) with integer a and b. Keeping the
+ * two counts, and converting them with octileValue() only when a float is
+ * needed, makes equal distances compare equal: a float running sum of 1s and
+ * sqrt(2)s drifts with the order of the additions and turns real f ties
+ * into arbitrary orderings.
+ */
+typedef struct OctileCost
+{
+    int          straight;      /* number of horizontal / vertical moves */
+    int          diagonal;      /* number of 45 degrees moves            */
+} OctileCost;
+
+typedef struct Cell
+{
+    float        f;             /* Total distance (f = g + h)                   */
+    float        g;             /* Exact distance from SOURCE to this Cell      */
+    float        h;             /* Heuristic distance from this Cell to TARGET  */
+    OctileCost   steps;         /* `g` as moves, g = octileValue(steps)         */
+    int          prev;          /* index of the previous Cell that when go
+                                   through it recursively, we will end at
+                                   SOURCE, and archive the total distance `g`.
+                                   -1 if there is none.                         */
+} Cell;
+
+typedef enum SearchStatus
+{
+    SEARCH_FOUND,               /* A path is stored in the result               */
+    SEARCH_NOT_FOUND,           /* TARGET is unreachable from SOURCE            */
+    SEARCH_ABORTED,             /* The observer asked the search to stop        */
+    SEARCH_INVALID              /* SOURCE or TARGET is missing or BLOCKED       */
+} SearchStatus;
+
+typedef enum OpenListKind
+{
+    OPENLIST_HEAP,              /* indexed 4-ary heap with decrease-key (default) */
+    OPENLIST_SET,               /* legacy std::set, one tree node per insert      */
+    OPENLIST_BUCKET             /* circular bucket queue on fixed-point f values  */
+} OpenListKind;
+
+typedef enum SearchAlgorithm
+{
+    ALGO_ASTAR,                 /* plain A* over the 8 neighbours (default)       */
+    ALGO_JPS,                   /* Jump Point Search, only jump points are queued */
+    ALGO_JPS_PLUS,              /* JPS with jumps read from a jpsPlusBuild() table */
+    ALGO_BIDIRECTIONAL,         /* A* from both ends, meeting in the middle       */
+    ALGO_HDA,                   /* Hash Distributed A* on numThreads workers      */
+    ALGO_MULTIQUEUE,            /* parallel A* sharing a relaxed MultiQueue       */
+    ALGO_DELTA_STEPPING,        /* parallel delta-stepping SSSP, up to TARGET     */
+    ALGO_HPA,                   /* HPA* on an hpaBuild() cluster graph            */
+    ALGO_BLOCK_ASTAR,           /* Block A* with a blockDatabaseBuild() LDDB      */
+    ALGO_DSTAR_LITE,            /* incremental D* Lite, replans on a DStarLite    */
+    ALGO_ARA_STAR,              /* anytime ARA*, improves a weighted first path   */
+    ALGO_RTAA,                  /* real-time RTAA* agent, bounded lookahead       */
+    ALGO_LAZY_THETA,            /* any-angle Lazy Theta*, path as waypoints       */
+    ALGO_SUBGOAL,               /* search of a subgoalBuild() subgoal graph       */
+    ALGO_CPD,                   /* first moves read from a cpdBuild() database    */
+    ALGO_RSR                    /* A* on the borders of rsrBuild() rectangles     */
+} SearchAlgorithm;
+
+/* Estimate of the distance to TARGET used by astarSearch() */
+typedef enum HeuristicKind
+{
+    HEURISTIC_OCTILE,           /* obstacle-free octile distance (default)        */
+    HEURISTIC_ALT               /* landmark bound of an altBuild() table          */
+} HeuristicKind;
+
+typedef struct AltTable AltTable;
+typedef struct GoalBoundTable GoalBoundTable;
+typedef struct SwampMap SwampMap;
+
+/*
+ * Which of the cells with the same f the open list pops first. Ties are
+ * resolved by the open list comparator, f itself is never perturbed.
+ * Preferring a high g (deepest cell) walks straight through the plateaus of
+ * open maps instead of expanding them. For exactly equal f, high g and low h
+ * are the same rule; they only differ where float rounding splits f.
+ * OPENLIST_BUCKET quantizes f and always applies TIE_LIFO inside a bucket.
+ */
+typedef enum TieBreaking
+{
+    TIE_HIGH_G,                 /* deepest cell first (default)                   */
+    TIE_LOW_H,                  /* cell closest to TARGET first                   */
+    TIE_LIFO                    /* most recently pushed cell first                */
+} TieBreaking;
+
+/*
+ * Optional hook invoked every time the search changes the state of a cell:
+ * LBL_TOBEVISITED when it is pushed to the open list, LBL_VISITING when it
+ * is popped and LBL_VISITED once all of its successors are processed.
+ * Returning non-zero aborts the search with SEARCH_ABORTED.
+ * With numThreads > 1 it may be called from several threads at once.
+ */
+typedef int (*SearchObserver)(void *userData, int idx, BlockLabels label);
+
+typedef struct SearchQuery
+{
+    const BlockLabels  *labels;     /* nrow*ncol cells, only LBL_BLOCKED matters */
+    Grid                grid;
+    int                 sourceIdx;
+    int                 targetIdx;
+    SearchObserver      observer;   /* NULL to run at full speed */
+    void               *userData;   /* passed back to the observer */
+    SearchAlgorithm     algorithm;  /* engine run by findPath() */
+    const void         *preprocessed; /* map data the engine needs, e.g. jpsPlusBuild();
+                                         ALGO_DSTAR_LITE updates its DStarLite planner,
+                                         ALGO_RTAA the heuristic its RtaaAgent learns */
+    OpenListKind        openList;
+    TieBreaking         tieBreaking;
+    HeuristicKind       heuristic;  /* ALGO_ASTAR only, the other engines use octile */
+    const AltTable     *landmarks;  /* HEURISTIC_ALT: altBuild() table of this grid */
+    const GoalBoundTable *goalBounds; /* ALGO_ASTAR and the JPS engines: goalBoundBuild() table
+                                         of this grid, prunes moves; NULL: no pruning */
+    const SwampMap     *swamps;     /* ALGO_ASTAR: swampBuild() regions of this grid, skipped
+                                         unless SOURCE or TARGET lies inside; NULL: none */
+    int                 numThreads; /* parallel engines only, 1 runs them sequentially */
+    float               weight;     /* ALGO_ARA_STAR: first inflation of h, >= 1 */
+    long                timeBudget; /* ALGO_ARA_STAR: microseconds to improve the first
+                                         path, 0 to go on until it is optimal */
+} SearchQuery;
+
+typedef struct SearchStats
+{
+    long         expanded;      /* cells popped from the open list and expanded */
+    long         generated;     /* successors pushed to the open list           */
+    long         maxOpenSize;   /* peak number of entries in the open list      */
+} SearchStats;
+
+typedef struct SearchResult
+{
+    int         *path;          /* cell indices from SOURCE to TARGET (malloc) */
+    int          pathLen;       /* number of cells in `path`, 0 if not found    */
+    float        cost;          /* total distance `g` of TARGET                 */
+    float        suboptimality; /* ALGO_ARA_STAR: cost <= suboptimality * optimal,
+                                   0 for the other engines                      */
+    SearchStats  stats;
+} SearchResult;
+
+
+long getCurrentMicroSecs();
+float adjDistance(int padx, int pady);
+float octileValue(OctileCost cost);
+OctileCost octileDistance(int fromIdx, int toIdx, int ncol);
+float* initHeuristicDistance(const BlockLabels* labels, Grid *windowSize, int targetIdx);
+void initSearchQuery(SearchQuery *query);
+float tieBreakValue(TieBreaking tieBreaking, float g, float h);
+void initSearchResult(SearchResult *result);
+void freeSearchResult(SearchResult *result);
+SearchStatus astarSearch(const SearchQuery *query, SearchResult *result);
+SearchStatus findPath(const SearchQuery *query, SearchResult *result);
+void expandPath(SearchResult *result, int ncol);
+
+/* Helpers shared by the search engines of the library */
+#define NOTIFY_OBSERVER(query, idx, label) \
+    ((query)->observer != NULL && (query)->observer((query)->userData, idx, label) != 0)
+
+/* An OctileCost in one word, for the engines that share g between threads */
+static inline uint64_t packSteps(OctileCost cost)
+{
+    return ((uint64_t) (uint32_t) cost.straight << 32) | (uint32_t) cost.diagonal;
+}
+
+static inline OctileCost unpackSteps(uint64_t packed)
+{
+    OctileCost cost;
+    cost.straight = (int) (packed >> 32);
+    cost.diagonal = (int) (packed & 0xffffffffu);
+    return cost;
+}
+
+bool isValidQuery(const SearchQuery *query);
+Cell* initListCell(Grid* windowSize, int sourceIdx);
+void storePath(Cell* listCell, int targetIdx, SearchResult *result);
+void storeDescentPath(const SearchQuery *query, const float* distance, SearchResult *result);
+
+/* grid.cpp */
+void randomGrid(BlockLabels* labels, Grid windowSize, float blockedRatio, unsigned int seed,
+                int* sourceIdx, int* targetIdx);
+int loadGridFile(const char* path, BlockLabels** labels, Grid* windowSize);
@@ -0,0 +1,342 @@
+#include <float.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "bidir.hpp"
+
+
+/*
+ * Both sides use the average potential p(v) = (hT(v) - hS(v)) / 2, where hT
+ * and hS are the octile distances to TARGET and to SOURCE: the forward side
+ * keys a cell with g + p(v), the backward side with g - p(v). p is consistent
+ * in both directions, so each side is a Dijkstra on the same reduced costs
+ * (c(u, v) - p(u) + p(v) >= 0) and the keys it pops never decrease.
+ *
+ * Every time one side lowers the g of a cell the other side has reached too,
+ * the two halves form a path; `best` keeps the shortest of them (mu). The
+ * reduced length of every path is its length plus the same constant, so the
+ * bidirectional Dijkstra rule applies: once the smallest keys of the two
+ * open lists add up to mu or more, no path shorter than mu is left. A side
+ * whose open list runs empty has expanded everything reachable from its end,
+ * and every meeting was recorded on the way, so mu is final too.
+ *
+ * With query->numThreads >= 2 both sides run at the same time, each on its
+ * own thread. They share the g of each cell (read only by the other side),
+ * the last key each side popped (`topKey`, a lower bound of its open list
+ * since keys never decrease), and `best`, all atomics: g is stored before
+ * the other side's g is read, and with sequentially consistent atomics at
+ * least one of two sides reaching the same cell sees the other, so no
+ * meeting is missed. No lock is taken; the observer is called from both
+ * threads.
+ */
+
+#define UNREACHED               UINT64_MAX
+
+typedef struct BidirSide
+{
+    int                     rootIdx;    /* where this side starts       */
+    int                     goalIdx;    /* where the other side starts  */
+    std::atomic<uint64_t>  *steps;      /* g as packed OctileCost, UNREACHED if none */
+    int                    *prev;
+    BlockLabels            *state;      /* LBL_UNBLOCKED, LBL_TOBEVISITED or LBL_VISITED */
+    OpenList                openList;
+    std::atomic<float>      topKey;     /* key of the last cell popped  */
+    SearchStats             stats;
+    struct BidirSide       *other;
+} BidirSide;
+
+typedef struct BidirSearch
+{
+    const SearchQuery      *query;
+    BidirSide               side[2];    /* forward, backward */
+    std::atomic<uint64_t>   best;       /* mu as float bits << 32 | meeting cell */
+    std::atomic<bool>       finished;
+    std::atomic<bool>       aborted;
+} BidirSearch;
+
+/* Non-negative floats order like their bit patterns, so mu compares as an integer */
+static inline uint64_t packMeeting(float cost, int idx)
+{
+    uint32_t bits;
+    memcpy(&bits, &cost, sizeof(bits));
+    return ((uint64_t) bits << 32) | (uint32_t) idx;
+}
+
+static inline float meetingCost(uint64_t packed)
+{
+    uint32_t bits = (uint32_t) (packed >> 32);
+    float cost;
+    memcpy(&cost, &bits, sizeof(cost));
+    return cost;
+}
+
+/* Key of a cell reached with `steps` from `side`'s root: g + p(v) forward, g - p(v) backward */
+static inline float sideKey(const BidirSide* side, OctileCost steps, int idx, int ncol)
+{
+    OctileCost toGoal = octileDistance(idx, side->goalIdx, ncol);
+    OctileCost toRoot = octileDistance(idx, side->rootIdx, ncol);
+    OctileCost twice;
+
+    twice.straight = 2 * steps.straight + toGoal.straight - toRoot.straight;
+    twice.diagonal = 2 * steps.diagonal + toGoal.diagonal - toRoot.diagonal;
+    return 0.5f * octileValue(twice);
+}
+
+static void offerMeeting(BidirSearch* search, float cost, int idx)
+{
+    uint64_t candidate = packMeeting(cost, idx);
+    uint64_t current = search->best.load();
+
+    while ((candidate >> 32) < (current >> 32) &&
+           !search->best.compare_exchange_weak(current, candidate))
+        ;
+}
+
+/* Expand one cell of `side`. Returns false once the search is over. */
+static bool expandOne(BidirSearch* search, BidirSide* side)
+{
+    const SearchQuery* query = search->query;
+    const BlockLabels* labels = query->labels;
+    Grid windowSize = query->grid;
+    int padx, pady, mainX, mainY, mainCellIdx;
+    OctileCost mainSteps;
+
+    if (side->openList.size == 0)
+    {
+        search->finished = true;
+        return false;
+    }
+    side->topKey = openListTopKey(&side->openList);
+    if (side->topKey + side->other->topKey >= meetingCost(search->best.load()))
+    {
+        search->finished = true;
+        return false;
+    }
+
+    mainCellIdx = openListPop(&side->openList);
+    if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITING))
+    {
+        search->aborted = true;
+        return false;
+    }
+    side->state[mainCellIdx] = LBL_VISITED;
+    side->stats.expanded++;
+
+    mainSteps = unpackSteps(side->steps[mainCellIdx].load(std::memory_order_relaxed));
+    mainX = mainCellIdx % windowSize.ncol;
+    mainY = mainCellIdx / windowSize.ncol;
+
+    for (pady = -1; pady <= 1; pady++)
+    {
+        for (padx = -1; padx <= 1; padx++)
+        {
+            OctileCost steps;
+            uint64_t current, otherSteps;
+            float successor_g;
+            int successorIdx;
+
+            if (mainX + padx < 0 || mainX + padx >= windowSize.ncol ||
+                mainY + pady < 0 || mainY + pady >= windowSize.nrow)
+                continue;
+
+            successorIdx = mainCellIdx + padx + pady * windowSize.ncol;
+            if (labels[successorIdx] == LBL_BLOCKED ||
+                side->state[successorIdx] == LBL_VISITED ||
+                successorIdx == side->rootIdx)
+                continue;
+
+            steps = mainSteps;
+            if (padx != 0 && pady != 0)
+                steps.diagonal++;
+            else
+                steps.straight++;
+            successor_g = octileValue(steps);
+
+            /* Only this side writes its g, a relaxed load of it is enough */
+            current = side->steps[successorIdx].load(std::memory_order_relaxed);
+            if (current != UNREACHED && octileValue(unpackSteps(current)) <= successor_g)
+                continue;
+
+            side->steps[successorIdx].store(packSteps(steps));
+            side->prev[successorIdx] = mainCellIdx;
+
+            side->state[successorIdx] = LBL_TOBEVISITED;
+            openListPush(&side->openList, successorIdx,
+                         sideKey(side, steps, successorIdx, windowSize.ncol),
+                         tieBreakValue(query->tieBreaking, successor_g,
+                                       octileValue(octileDistance(successorIdx, side->goalIdx,
+                                                                  windowSize.ncol))));
+            side->stats.generated++;
+            side->stats.maxOpenSize = MAX2(side->stats.maxOpenSize, (long) side->openList.size);
+
+            /* Met the other side? */
+            otherSteps = side->other->steps[successorIdx].load();
+            if (otherSteps != UNREACHED)
+            {
+                OctileCost other = unpackSteps(otherSteps);
+                other.straight += steps.straight;
+                other.diagonal += steps.diagonal;
+                offerMeeting(search, octileValue(other), successorIdx);
+            }
+
+            if (NOTIFY_OBSERVER(query, successorIdx, LBL_TOBEVISITED))
+            {
+                search->aborted = true;
+                return false;
+            }
+        }
+    }
+
+    if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITED))
+    {
+        search->aborted = true;
+        return false;
+    }
+    return true;
+}
+
+typedef struct BidirWorker
+{
+    BidirSearch            *search;
+    BidirSide              *side;
+} BidirWorker;
+
+static void* sideThread(void* arg)
+{
+    BidirWorker* worker = (BidirWorker*) arg;
+
+    while (!worker->search->finished && !worker->search->aborted &&
+           expandOne(worker->search, worker->side))
+        ;
+    worker->search->finished = true;
+    return NULL;
+}
+
+static void initSide(BidirSide* side, const SearchQuery* query, int rootIdx, int goalIdx,
+                     BidirSide* other)
+{
+    int i, numElement = query->grid.nrow * query->grid.ncol;
+    OctileCost zero = {0, 0};
+
+    side->rootIdx = rootIdx;
+    side->goalIdx = goalIdx;
+    side->steps   = new std::atomic<uint64_t>[numElement];
+    side->prev    = (int*) malloc(numElement * sizeof(int));
+    side->state   = (BlockLabels*) calloc(numElement, sizeof(BlockLabels));
+    side->other   = other;
+    memset(&side->stats, 0, sizeof(SearchStats));
+    openListInit(&side->openList, query->openList, numElement);
+
+    for (i = 0; i < numElement; i++)
+    {
+        side->steps[i].store(UNREACHED, std::memory_order_relaxed);
+        side->prev[i] = -1;
+    }
+
+    side->steps[rootIdx].store(packSteps(zero));
+    side->state[rootIdx] = LBL_TOBEVISITED;
+    side->topKey = sideKey(side, zero, rootIdx, query->grid.ncol);
+    openListPush(&side->openList, rootIdx, side->topKey, 0.0f);
+}
+
+static void freeSide(BidirSide* side)
+{
+    openListFree(&side->openList);
+    delete[] side->steps;
+    free(side->prev);
+    free(side->state);
+}
+
+/* SOURCE .. meeting cell from the forward links, then meeting cell .. TARGET */
+static void storeMeetingPath(BidirSearch* search, int meetIdx, SearchResult* result)
+{
+    BidirSide* forward = &search->side[0];
+    BidirSide* backward = &search->side[1];
+    int idx, len, numForward = 0, numBackward = 0;
+
+    for (idx = meetIdx; idx != -1; idx = forward->prev[idx])
+        numForward++;
+    for (idx = backward->prev[meetIdx]; idx != -1; idx = backward->prev[idx])
+        numBackward++;
+
+    result->pathLen = numForward + numBackward;
+    result->path    = (int*) malloc(result->pathLen * sizeof(int));
+
+    len = numForward;
+    for (idx = meetIdx; idx != -1; idx = forward->prev[idx])
+        result->path[--len] = idx;
+    len = numForward;
+    for (idx = backward->prev[meetIdx]; idx != -1; idx = backward->prev[idx])
+        result->path[len++] = idx;
+}
+
+/*
+ * Bidirectional A*. With query->numThreads < 2 the two sides take turns in
+ * the calling thread, the one with the smaller open list going next; with 2
+ * or more, the backward side runs on a thread of its own meanwhile (or they
+ * take turns anyway if that thread cannot be started).
+ */
+SearchStatus bidirectionalSearch(const SearchQuery *query, SearchResult *result)
+{
+    BidirSearch search;
+    BidirWorker forward = {&search, &search.side[0]};
+    BidirWorker backward = {&search, &search.side[1]};
+    pthread_t thread;
+    SearchStatus status = SEARCH_NOT_FOUND;
+    uint64_t best;
+    int s;
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+
+    search.query = query;
+    search.best = packMeeting(FLT_MAX, -1);
+    search.finished = false;
+    search.aborted = false;
+    initSide(&search.side[0], query, query->sourceIdx, query->targetIdx, &search.side[1]);
+    initSide(&search.side[1], query, query->targetIdx, query->sourceIdx, &search.side[0]);
+    if (query->sourceIdx == query->targetIdx)
+        offerMeeting(&search, 0.0f, query->sourceIdx);
+
+    if (query->numThreads >= 2 &&
+        pthread_create(&thread, NULL, sideThread, &backward) == 0)
+    {
+        sideThread(&forward);
+        pthread_join(thread, NULL);
+    }
+    else
+    {
+        while (!search.finished && !search.aborted)
+        {
+            BidirSide* side = &search.side[0];
+            if (search.side[1].openList.size < search.side[0].openList.size)
+                side = &search.side[1];
+            expandOne(&search, side);
+        }
+    }
+
+    best = search.best.load();
+    if (search.aborted)
+        status = SEARCH_ABORTED;
+    else if (meetingCost(best) < FLT_MAX)
+    {
+        storeMeetingPath(&search, (int) (best & 0xffffffffu), result);
+        result->cost = meetingCost(best);
+        status = SEARCH_FOUND;
+    }
+
+    for (s = 0; s < 2; s++)
+    {
+        result->stats.expanded    += search.side[s].stats.expanded;
+        result->stats.generated   += search.side[s].stats.generated;
+        result->stats.maxOpenSize += search.side[s].stats.maxOpenSize;
+        freeSide(&search.side[s]);
+    }
+
+    return status;
+}
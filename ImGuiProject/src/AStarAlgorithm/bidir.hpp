@@ -0,0 +1,10 @@
+/*
+ * Bidirectional A*: one A* grows from SOURCE towards TARGET, another one from
+ * TARGET towards SOURCE, and the search stops once no path shorter than the
+ * best meeting found so far can exist.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+SearchStatus bidirectionalSearch(const SearchQuery *query, SearchResult *result);
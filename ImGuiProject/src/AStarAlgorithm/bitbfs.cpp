@@ -0,0 +1,469 @@
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+
+#include "astar.hpp"
+#include "bitbfs.hpp"
+
+
+/*
+ * A layer is a bitmap of the same shape as BitGrid::free. With `frontier`
+ * the cells at distance d, the cells at distance d + 1 are
+ *
+ *      spread(frontier) & free & ~reached
+ *
+ * where spread() adds the neighbours of every bit: within a row, a shift by
+ * one in each direction (carrying the bit that crosses a word boundary);
+ * across rows, an OR with the row above and below. With 8 connected moves
+ * the rows above and below are spread sideways first, which gives the
+ * diagonals; a diagonal move only needs its destination to be UNBLOCKED, as
+ * in astarSearch(), so no corner test is needed.
+ *
+ * Only the words next to a non-empty frontier word can change, so the
+ * frontier is also kept as a list of its non-empty words and a layer costs
+ * the size of the wavefront, not of the grid.
+ */
+
+/* A word of a row with the bits of both horizontal neighbours added */
+static inline uint64_t spreadWord(const uint64_t* row, int k, int wordsPerRow)
+{
+    uint64_t word = row[k];
+    uint64_t left = (k > 0) ? row[k - 1] : 0;
+    uint64_t right = (k + 1 < wordsPerRow) ? row[k + 1] : 0;
+
+    return word | (word << 1) | (left >> 63) | (word >> 1) | (right << 63);
+}
+
+BitGrid* bitGridBuild(const BlockLabels* labels, Grid windowSize)
+{
+    BitGrid* grid = (BitGrid*) malloc(sizeof(BitGrid));
+    int x, y;
+
+    grid->windowSize = windowSize;
+    grid->wordsPerRow = (windowSize.ncol + 63) / 64;
+    grid->free = (uint64_t*) calloc((size_t) windowSize.nrow * grid->wordsPerRow, sizeof(uint64_t));
+
+    for (y = 0; y < windowSize.nrow; y++)
+    {
+        uint64_t* row = &grid->free[(size_t) y * grid->wordsPerRow];
+        for (x = 0; x < windowSize.ncol; x++)
+            if (labels[x + y * windowSize.ncol] != LBL_BLOCKED)
+                row[x / 64] |= (uint64_t) 1 << (x % 64);
+    }
+    return grid;
+}
+
+void bitGridSetBlocked(BitGrid* grid, int idx, bool blocked)
+{
+    int x = idx % grid->windowSize.ncol, y = idx / grid->windowSize.ncol;
+    uint64_t* word = &grid->free[(size_t) y * grid->wordsPerRow + x / 64];
+
+    if (blocked)
+        *word &= ~((uint64_t) 1 << (x % 64));
+    else
+        *word |= (uint64_t) 1 << (x % 64);
+}
+
+void bitGridFree(BitGrid* grid)
+{
+    if (grid == NULL)
+        return;
+    free(grid->free);
+    free(grid);
+}
+
+static inline bool testBit(const uint64_t* bits, int wordsPerRow, int ncol, int idx)
+{
+    int x = idx % ncol, y = idx / ncol;
+    return (bits[(size_t) y * wordsPerRow + x / 64] >> (x % 64)) & 1;
+}
+
+/*
+ * BFS from `sourceIdx`, one layer per move. Returns the number of moves to
+ * `targetIdx`, -1 if it cannot be reached; with `targetIdx` < 0 the whole
+ * component of SOURCE is flooded and the number of its last layer returned.
+ * If `layer` is not NULL (nrow*ncol ints) it receives the layer of every
+ * cell reached, -1 for the others; with a TARGET, only the layers up to the
+ * one of TARGET are filled in.
+ */
+int bitGridBfs(const BitGrid* grid, int sourceIdx, int targetIdx, BfsConnectivity connectivity,
+               int* layer)
+{
+    int nrow = grid->windowSize.nrow, ncol = grid->windowSize.ncol, wordsPerRow = grid->wordsPerRow;
+    int numWords = nrow * wordsPerRow;
+    uint64_t *reached, *frontier, *next;
+    int *active, *candidate, *stamp;
+    int numActive, numCandidate;
+    int d, i, k, distance = -1;
+
+    if (sourceIdx < 0 || sourceIdx >= nrow * ncol ||
+        !testBit(grid->free, wordsPerRow, ncol, sourceIdx))
+        return -1;
+
+    if (layer != NULL)
+        for (k = 0; k < nrow * ncol; k++)
+            layer[k] = -1;
+
+    reached   = (uint64_t*) calloc(numWords, sizeof(uint64_t));
+    frontier  = (uint64_t*) calloc(numWords, sizeof(uint64_t));
+    next      = (uint64_t*) calloc(numWords, sizeof(uint64_t));
+    active    = (int*) malloc(numWords * sizeof(int));
+    candidate = (int*) malloc(numWords * sizeof(int));
+    stamp     = (int*) malloc(numWords * sizeof(int));
+    for (k = 0; k < numWords; k++)
+        stamp[k] = -1;
+
+    k = (sourceIdx / ncol) * wordsPerRow + (sourceIdx % ncol) / 64;
+    frontier[k] = reached[k] = (uint64_t) 1 << ((sourceIdx % ncol) % 64);
+    active[0] = k;
+    numActive = 1;
+    if (layer != NULL)
+        layer[sourceIdx] = 0;
+
+    for (d = 0; ; d++)
+    {
+        uint64_t* swap;
+
+        if (targetIdx >= 0 && testBit(reached, wordsPerRow, ncol, targetIdx))
+        {
+            distance = d;
+            break;
+        }
+        if (numActive == 0)
+        {
+            /* Nothing left to grow: the component is done */
+            if (targetIdx < 0)
+                distance = d - 1;
+            break;
+        }
+
+        /* The words around the frontier, each once */
+        numCandidate = 0;
+        for (i = 0; i < numActive; i++)
+        {
+            int y = active[i] / wordsPerRow, x = active[i] % wordsPerRow, dy, dx;
+
+            for (dy = MAX2(y - 1, 0); dy <= MIN2(y + 1, nrow - 1); dy++)
+                for (dx = MAX2(x - 1, 0); dx <= MIN2(x + 1, wordsPerRow - 1); dx++)
+                {
+                    int w = dy * wordsPerRow + dx;
+                    if (stamp[w] == d)
+                        continue;
+                    stamp[w] = d;
+                    candidate[numCandidate++] = w;
+                }
+        }
+
+        for (i = 0; i < numCandidate; i++)
+        {
+            int w = candidate[i], y = w / wordsPerRow;
+            const uint64_t* row = &frontier[(size_t) y * wordsPerRow];
+            uint64_t grown;
+
+            k = w % wordsPerRow;
+            grown = spreadWord(row, k, wordsPerRow);
+            if (connectivity == BFS_8_CONNECTED)
+            {
+                if (y > 0)
+                    grown |= spreadWord(row - wordsPerRow, k, wordsPerRow);
+                if (y + 1 < nrow)
+                    grown |= spreadWord(row + wordsPerRow, k, wordsPerRow);
+            }
+            else
+            {
+                if (y > 0)
+                    grown |= row[k - wordsPerRow];
+                if (y + 1 < nrow)
+                    grown |= row[k + wordsPerRow];
+            }
+            next[w] = grown & grid->free[w] & ~reached[w];
+        }
+
+        /* Mark the new layer, and leave the old frontier empty for reuse as `next` */
+        for (i = 0; i < numActive; i++)
+            frontier[active[i]] = 0;
+        numActive = 0;
+        for (i = 0; i < numCandidate; i++)
+        {
+            int w = candidate[i];
+            uint64_t word = next[w];
+
+            if (word == 0)
+                continue;
+            reached[w] |= word;
+            active[numActive++] = w;
+            while (layer != NULL && word != 0)
+            {
+                layer[(w / wordsPerRow) * ncol + (w % wordsPerRow) * 64 + __builtin_ctzll(word)] = d + 1;
+                word &= word - 1;
+            }
+        }
+
+        swap = frontier;
+        frontier = next;
+        next = swap;
+    }
+
+    free(reached);
+    free(frontier);
+    free(next);
+    free(active);
+    free(candidate);
+    free(stamp);
+    return distance;
+}
+
+/*
+ * Grow `seeds` along the runs of `free` bits of a row, in both directions and
+ * across word boundaries, with log-step (Kogge-Stone) shifts.
+ */
+static void fillRow(uint64_t* seeds, const uint64_t* free, int wordsPerRow)
+{
+    uint64_t carry = 0;
+    int k, s;
+
+    for (k = 0; k < wordsPerRow; k++)
+    {
+        uint64_t bits = (seeds[k] | carry) & free[k], open = free[k];
+        for (s = 1; s < 64; s <<= 1)
+        {
+            bits |= open & (bits << s);
+            open &= open << s;
+        }
+        seeds[k] = bits;
+        carry = bits >> 63;
+    }
+    carry = 0;
+    for (k = wordsPerRow - 1; k >= 0; k--)
+    {
+        uint64_t bits = seeds[k] | ((carry << 63) & free[k]), open = free[k];
+        for (s = 1; s < 64; s <<= 1)
+        {
+            bits |= open & (bits >> s);
+            open &= open >> s;
+        }
+        seeds[k] = bits;
+        carry = bits & 1;
+    }
+}
+
+/*
+ * Whether TARGET can be reached with the moves of the search engines.
+ *
+ * Distances are not needed here, so instead of one layer per move the
+ * reached set is swept down and up the rows until it stops growing: each row
+ * takes the (sideways spread) reached bits of its neighbour rows and is then
+ * filled along its runs of UNBLOCKED cells, so a corridor is crossed in one
+ * step whatever its length. A row is only recomputed when a neighbour row
+ * changed since its last visit.
+ */
+bool bitGridReachable(const BitGrid* grid, int sourceIdx, int targetIdx)
+{
+    int nrow = grid->windowSize.nrow, ncol = grid->windowSize.ncol, wordsPerRow = grid->wordsPerRow;
+    uint64_t *reached, *row;
+    char* dirty;
+    bool changed = true, found;
+    int pass, y, k;
+
+    if (sourceIdx < 0 || sourceIdx >= nrow * ncol || targetIdx < 0 || targetIdx >= nrow * ncol ||
+        !testBit(grid->free, wordsPerRow, ncol, sourceIdx) ||
+        !testBit(grid->free, wordsPerRow, ncol, targetIdx))
+        return false;
+
+    reached = (uint64_t*) calloc((size_t) nrow * wordsPerRow, sizeof(uint64_t));
+    row = (uint64_t*) malloc(wordsPerRow * sizeof(uint64_t));
+    dirty = (char*) calloc(nrow, sizeof(char));
+
+    y = sourceIdx / ncol;
+    k = sourceIdx % ncol;
+    reached[(size_t) y * wordsPerRow + k / 64] = (uint64_t) 1 << (k % 64);
+    fillRow(&reached[(size_t) y * wordsPerRow], &grid->free[(size_t) y * wordsPerRow], wordsPerRow);
+    dirty[y] = 1;
+
+    found = testBit(reached, wordsPerRow, ncol, targetIdx);
+    for (pass = 0; changed && !found; pass++)
+    {
+        int from = (pass % 2 == 0) ? 0 : nrow - 1, step = (pass % 2 == 0) ? 1 : -1;
+
+        changed = false;
+        for (y = from; y >= 0 && y < nrow; y += step)
+        {
+            uint64_t* current = &reached[(size_t) y * wordsPerRow];
+            bool grew = false;
+
+            if (!(y > 0 && dirty[y - 1]) && !(y + 1 < nrow && dirty[y + 1]))
+                continue;
+
+            for (k = 0; k < wordsPerRow; k++)
+            {
+                row[k] = current[k];
+                if (y > 0)
+                    row[k] |= spreadWord(&reached[(size_t) (y - 1) * wordsPerRow], k, wordsPerRow);
+                if (y + 1 < nrow)
+                    row[k] |= spreadWord(&reached[(size_t) (y + 1) * wordsPerRow], k, wordsPerRow);
+                row[k] &= grid->free[(size_t) y * wordsPerRow + k];
+            }
+            fillRow(row, &grid->free[(size_t) y * wordsPerRow], wordsPerRow);
+
+            for (k = 0; k < wordsPerRow; k++)
+            {
+                grew |= (row[k] != current[k]);
+                current[k] = row[k];
+            }
+            if (grew)
+            {
+                dirty[y] = 2;
+                changed = true;
+            }
+        }
+
+        /* Rows marked during this pass stay dirty for the next one */
+        for (y = 0; y < nrow; y++)
+            dirty[y] = (dirty[y] == 2) ? 1 : 0;
+        found = testBit(reached, wordsPerRow, ncol, targetIdx);
+    }
+
+    free(reached);
+    free(row);
+    free(dirty);
+    return found;
+}
+
+static inline bool isFree(const BitGrid* grid, int x, int y)
+{
+    return (grid->free[(size_t) y * grid->wordsPerRow + x / 64] >> (x % 64)) & 1;
+}
+
+/*
+ * Up to 64 queries, query q in bit q of the masks: `seen` holds the queries
+ * that have reached a cell, `visit` those for which it is on the current
+ * layer. A query drops out of the masks as soon as its TARGET is reached.
+ * `around` has bit k set when the move offset[k] leaves the cell for an
+ * UNBLOCKED one.
+ */
+static void multiBfsBatch(const BitGrid* grid, const uint8_t* around, const int* offset,
+                          const int* sourceIdx, const int* targetIdx, int numQueries, int* moves,
+                          uint64_t* seen, uint64_t* visit, uint64_t* visitNext, int* active, int* nextActive)
+{
+    int ncol = grid->windowSize.ncol, numElement = grid->windowSize.nrow * ncol;
+    uint64_t pending = 0, left;
+    int numActive = 0, numNext, q, i, d;
+
+    memset(seen, 0, numElement * sizeof(uint64_t));
+
+    for (q = 0; q < numQueries; q++)
+    {
+        int s = sourceIdx[q], t = targetIdx[q];
+        uint64_t bit = (uint64_t) 1 << q;
+
+        moves[q] = -1;
+        if (s < 0 || s >= numElement || t < 0 || t >= numElement ||
+            !isFree(grid, s % ncol, s / ncol) || !isFree(grid, t % ncol, t / ncol))
+            continue;
+        if (s == t)
+        {
+            moves[q] = 0;
+            continue;
+        }
+        if (visit[s] == 0)
+            active[numActive++] = s;
+        visit[s] |= bit;
+        seen[s] |= bit;
+        pending |= bit;
+    }
+
+    for (d = 0; pending != 0 && numActive > 0; d++)
+    {
+        uint64_t done;
+
+        numNext = 0;
+        for (i = 0; i < numActive; i++)
+        {
+            int v = active[i];
+            unsigned int dirs = around[v];
+            uint64_t mask = visit[v] & pending;
+
+            visit[v] = 0;
+            if (mask == 0)
+                continue;
+
+            for (; dirs != 0; dirs &= dirs - 1)
+            {
+                /* The queries reaching n for the first time, all on layer d + 1 */
+                int n = v + offset[__builtin_ctz(dirs)];
+                uint64_t fresh = mask & ~seen[n];
+
+                if (fresh == 0)
+                    continue;
+                if (visitNext[n] == 0)
+                    nextActive[numNext++] = n;
+                visitNext[n] |= fresh;
+                seen[n] |= fresh;
+            }
+        }
+
+        /* Retire the queries whose TARGET is on the new layer */
+        done = 0;
+        for (left = pending; left != 0; left &= left - 1)
+        {
+            q = __builtin_ctzll(left);
+            if ((seen[targetIdx[q]] >> q) & 1)
+            {
+                moves[q] = d + 1;
+                done |= (uint64_t) 1 << q;
+            }
+        }
+        pending &= ~done;
+
+        std::swap(visit, visitNext);
+        std::swap(active, nextActive);
+        numActive = numNext;
+    }
+
+    /* Leave `visit` clean for the next batch */
+    for (i = 0; i < numActive; i++)
+        visit[active[i]] = 0;
+}
+
+/*
+ * Number of moves of every SOURCE/TARGET pair, -1 where TARGET cannot be
+ * reached (or a cell is invalid), for any number of pairs, 64 at a time.
+ */
+void bitGridMultiBfs(const BitGrid* grid, const int* sourceIdx, const int* targetIdx, int numQueries,
+                     BfsConnectivity connectivity, int* moves)
+{
+    int nrow = grid->windowSize.nrow, ncol = grid->windowSize.ncol, numElement = nrow * ncol;
+    const int dxs[8] = {-1, 0, 1, -1, 1, -1, 0, 1}, dys[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+    uint8_t* around = (uint8_t*) calloc(numElement, sizeof(uint8_t));
+    uint64_t* seen = (uint64_t*) malloc(numElement * sizeof(uint64_t));
+    uint64_t* visit = (uint64_t*) calloc(numElement, sizeof(uint64_t));
+    uint64_t* visitNext = (uint64_t*) calloc(numElement, sizeof(uint64_t));
+    int* active = (int*) malloc(numElement * sizeof(int));
+    int* nextActive = (int*) malloc(numElement * sizeof(int));
+    int offset[8];
+    int first, x, y, k;
+
+    for (k = 0; k < 8; k++)
+        offset[k] = dxs[k] + dys[k] * ncol;
+    for (y = 0; y < nrow; y++)
+        for (x = 0; x < ncol; x++)
+            for (k = 0; k < 8; k++)
+            {
+                int nx = x + dxs[k], ny = y + dys[k];
+                if (connectivity == BFS_4_CONNECTED && dxs[k] != 0 && dys[k] != 0)
+                    continue;
+                if (nx >= 0 && nx < ncol && ny >= 0 && ny < nrow && isFree(grid, nx, ny))
+                    around[x + y * ncol] |= 1 << k;
+            }
+
+    for (first = 0; first < numQueries; first += 64)
+        multiBfsBatch(grid, around, offset, sourceIdx + first, targetIdx + first, MIN2(numQueries - first, 64),
+                      moves + first, seen, visit, visitNext, active, nextActive);
+
+    free(around);
+    free(seen);
+    free(visit);
+    free(visitNext);
+    free(active);
+    free(nextActive);
+}
@@ -0,0 +1,34 @@
+/*
+ * Bit-parallel breadth-first search: the grid is packed 64 cells per word,
+ * row by row, and a whole BFS layer is grown from the previous one with
+ * shifts, ANDs and ORs, 64 cells at a time.
+ *
+ * bitGridMultiBfs() turns it around for batches of queries (MS-BFS, Then et
+ * al., 2014): every cell holds one bit per query, so a single pass over the
+ * wavefront advances up to 64 searches.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+typedef enum BfsConnectivity
+{
+    BFS_4_CONNECTED,            /* horizontal / vertical moves: Manhattan layers        */
+    BFS_8_CONNECTED             /* the moves of the engines: Chebyshev (king) layers    */
+} BfsConnectivity;
+
+typedef struct BitGrid
+{
+    Grid         windowSize;
+    int          wordsPerRow;
+    uint64_t    *free;          /* bit x % 64 of word x / 64 of a row: cell is UNBLOCKED */
+} BitGrid;
+
+BitGrid* bitGridBuild(const BlockLabels* labels, Grid windowSize);
+void bitGridSetBlocked(BitGrid* grid, int idx, bool blocked);
+void bitGridFree(BitGrid* grid);
+int bitGridBfs(const BitGrid* grid, int sourceIdx, int targetIdx, BfsConnectivity connectivity,
+               int* layer);
+bool bitGridReachable(const BitGrid* grid, int sourceIdx, int targetIdx);
+void bitGridMultiBfs(const BitGrid* grid, const int* sourceIdx, const int* targetIdx, int numQueries,
+                     BfsConnectivity connectivity, int* moves);
@@ -0,0 +1,466 @@
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "blockastar.hpp"
+
+
+/*
+ * A block is expanded with the set of its ring cells whose g went down since
+ * its last expansion (its ingress cells). The LDDB gives the distance from
+ * each of them to every ring cell of the block, which updates the g of the
+ * ring; the ring cells that improved then offer their g to the cells of the
+ * neighbour blocks one move away, queueing those blocks with the smallest
+ * g + h of their new ingress cells as key. A block goes back to the open
+ * list whenever one of its ring cells improves again.
+ *
+ * SOURCE and TARGET need not be on a ring: the distances from SOURCE inside
+ * its block and to TARGET inside its block come from a search of those two
+ * blocks only. The search stops once the smallest key left is no smaller
+ * than the best path to TARGET found so far.
+ */
+
+static inline uint8_t packEntry(OctileCost cost)
+{
+    return (uint8_t) ((cost.straight << 4) | cost.diagonal);
+}
+
+static inline OctileCost unpackEntry(uint8_t entry)
+{
+    OctileCost cost;
+    cost.straight = entry >> 4;
+    cost.diagonal = entry & 0xf;
+    return cost;
+}
+
+static inline OctileCost addCost(OctileCost a, OctileCost b)
+{
+    a.straight += b.straight;
+    a.diagonal += b.diagonal;
+    return a;
+}
+
+/* Local cells of the ring, and the ring position of each local cell (-1 inside) */
+static void ringLayout(int ringCell[BLOCK_RING], int ringIndex[BLOCK_CELLS])
+{
+    int i, n = 0;
+
+    for (i = 0; i < BLOCK_CELLS; i++)
+    {
+        int x = i % BLOCK_SIDE, y = i / BLOCK_SIDE;
+        if (x == 0 || y == 0 || x == BLOCK_SIDE - 1 || y == BLOCK_SIDE - 1)
+        {
+            ringIndex[i] = n;
+            ringCell[n++] = i;
+        }
+        else
+            ringIndex[i] = -1;
+    }
+}
+
+/*
+ * Dijkstra inside one block of layout `config`, from local cell `from`.
+ * `prev` may be NULL. Unreached cells are left with reached[i] false.
+ */
+static void localDistances(int config, int from, OctileCost distance[BLOCK_CELLS],
+                           bool reached[BLOCK_CELLS], int prev[BLOCK_CELLS])
+{
+    float value[BLOCK_CELLS];
+    bool done[BLOCK_CELLS];
+    int i, u, dx, dy;
+
+    for (i = 0; i < BLOCK_CELLS; i++)
+    {
+        value[i] = FLT_MAX;
+        reached[i] = done[i] = false;
+        if (prev != NULL)
+            prev[i] = -1;
+    }
+    if ((config >> from) & 1)
+        return;
+
+    value[from] = 0.0f;
+    distance[from].straight = distance[from].diagonal = 0;
+    reached[from] = true;
+
+    while (true)
+    {
+        for (u = -1, i = 0; i < BLOCK_CELLS; i++)
+            if (reached[i] && !done[i] && (u < 0 || value[i] < value[u]))
+                u = i;
+        if (u < 0)
+            break;
+        done[u] = true;
+
+        for (dy = -1; dy <= 1; dy++)
+            for (dx = -1; dx <= 1; dx++)
+            {
+                int nx = u % BLOCK_SIDE + dx, ny = u / BLOCK_SIDE + dy, n;
+                OctileCost through = distance[u];
+
+                if ((dx == 0 && dy == 0) || nx < 0 || nx >= BLOCK_SIDE || ny < 0 || ny >= BLOCK_SIDE)
+                    continue;
+                n = nx + ny * BLOCK_SIDE;
+                if ((config >> n) & 1)
+                    continue;
+
+                if (dx != 0 && dy != 0)
+                    through.diagonal++;
+                else
+                    through.straight++;
+                if (octileValue(through) < value[n])
+                {
+                    value[n] = octileValue(through);
+                    distance[n] = through;
+                    reached[n] = true;
+                    if (prev != NULL)
+                        prev[n] = u;
+                }
+            }
+    }
+}
+
+/* Every layout of a block, every ring cell: BLOCK_CONFIGS * BLOCK_RING small Dijkstras */
+BlockDatabase* blockDatabaseBuild(void)
+{
+    BlockDatabase* database = (BlockDatabase*) malloc(sizeof(BlockDatabase));
+    int ringCell[BLOCK_RING], ringIndex[BLOCK_CELLS];
+    OctileCost distance[BLOCK_CELLS];
+    bool reached[BLOCK_CELLS];
+    int config, from, to;
+
+    ringLayout(ringCell, ringIndex);
+    database->distance = (uint8_t*) malloc((size_t) BLOCK_CONFIGS * BLOCK_RING * BLOCK_RING);
+
+    for (config = 0; config < BLOCK_CONFIGS; config++)
+        for (from = 0; from < BLOCK_RING; from++)
+        {
+            uint8_t* row = &database->distance[((size_t) config * BLOCK_RING + from) * BLOCK_RING];
+
+            localDistances(config, ringCell[from], distance, reached, NULL);
+            for (to = 0; to < BLOCK_RING; to++)
+                row[to] = reached[ringCell[to]] ? packEntry(distance[ringCell[to]]) : BLOCK_UNREACHABLE;
+        }
+    return database;
+}
+
+void blockDatabaseFree(BlockDatabase* database)
+{
+    if (database == NULL)
+        return;
+    free(database->distance);
+    free(database);
+}
+
+typedef struct BlockSearch
+{
+    const SearchQuery  *query;
+    const uint8_t      *lddb;
+    int                 ncol, nrow, blocksX;
+    int                 ringCell[BLOCK_RING];
+    int                 ringIndex[BLOCK_CELLS];
+
+    float              *g;              /* per cell, FLT_MAX until reached  */
+    OctileCost         *steps;          /* `g` as moves                     */
+    int                *prev;           /* previous cell: same block or one move away */
+
+    int                *config;         /* per block, -1 until first needed */
+    uint16_t           *ingress;        /* per block: local cells improved since its last expansion */
+    float              *key;            /* per block: key in `open`, FLT_MAX when not queued */
+    OpenList            open;
+    SearchStats        *stats;
+} BlockSearch;
+
+static inline int blockOf(const BlockSearch* search, int idx)
+{
+    return (idx % search->ncol) / BLOCK_SIDE + (idx / search->ncol) / BLOCK_SIDE * search->blocksX;
+}
+
+static inline int localOf(const BlockSearch* search, int idx)
+{
+    return (idx % search->ncol) % BLOCK_SIDE + (idx / search->ncol) % BLOCK_SIDE * BLOCK_SIDE;
+}
+
+/* Grid cell of local cell `local` of block `b`, -1 outside of the grid */
+static inline int cellOf(const BlockSearch* search, int b, int local)
+{
+    int x = (b % search->blocksX) * BLOCK_SIDE + local % BLOCK_SIDE;
+    int y = (b / search->blocksX) * BLOCK_SIDE + local / BLOCK_SIDE;
+
+    return (x < search->ncol && y < search->nrow) ? x + y * search->ncol : -1;
+}
+
+/* Layout of block `b`; cells outside of the grid count as BLOCKED */
+static int configOf(BlockSearch* search, int b)
+{
+    int local, idx;
+
+    if (search->config[b] >= 0)
+        return search->config[b];
+
+    search->config[b] = 0;
+    for (local = 0; local < BLOCK_CELLS; local++)
+    {
+        idx = cellOf(search, b, local);
+        if (idx < 0 || search->query->labels[idx] == LBL_BLOCKED)
+            search->config[b] |= 1 << local;
+    }
+    return search->config[b];
+}
+
+/* Offer `idx` the way through `from`; true if the observer aborts */
+static bool offerCell(BlockSearch* search, int idx, int from, OctileCost through)
+{
+    const SearchQuery* query = search->query;
+    float g = octileValue(through), h, key;
+    bool first = (search->g[idx] == FLT_MAX);
+    int b;
+
+    if (g >= search->g[idx])
+        return false;
+
+    search->g[idx] = g;
+    search->steps[idx] = through;
+    search->prev[idx] = from;
+
+    b = blockOf(search, idx);
+    search->ingress[b] |= (uint16_t) (1 << localOf(search, idx));
+    h = octileValue(octileDistance(idx, query->targetIdx, search->ncol));
+    key = g + h;
+    if (key < search->key[b])
+    {
+        search->key[b] = key;
+        openListPush(&search->open, b, key, tieBreakValue(query->tieBreaking, g, h));
+        search->stats->generated++;
+        search->stats->maxOpenSize = MAX2(search->stats->maxOpenSize, (long) search->open.size);
+    }
+    return first && NOTIFY_OBSERVER(query, idx, LBL_TOBEVISITED);
+}
+
+/* Cells strictly between `fromIdx` and `toIdx`, both in block `b`, appended in that order */
+static void appendInBlock(BlockSearch* search, int b, int fromIdx, int toIdx, std::vector<int>& path)
+{
+    OctileCost distance[BLOCK_CELLS];
+    bool reached[BLOCK_CELLS];
+    int prev[BLOCK_CELLS], cells[BLOCK_CELLS];
+    int n = 0, local, fromLocal = localOf(search, fromIdx);
+
+    localDistances(configOf(search, b), fromLocal, distance, reached, prev);
+    for (local = prev[localOf(search, toIdx)]; local != -1 && local != fromLocal; local = prev[local])
+        cells[n++] = cellOf(search, b, local);
+    while (n > 0)
+        path.push_back(cells[--n]);
+}
+
+SearchStatus blockAStarSearch(const SearchQuery *query, SearchResult *result)
+{
+    const BlockDatabase* database = (const BlockDatabase*) query->preprocessed;
+    int sourceIdx = query->sourceIdx, targetIdx = query->targetIdx;
+    int numElement = query->grid.nrow * query->grid.ncol, numBlocks, sourceBlock, targetBlock;
+    OctileCost sourceDistance[BLOCK_CELLS], targetDistance[BLOCK_CELLS], best = {0, 0};
+    bool sourceReached[BLOCK_CELLS], targetReached[BLOCK_CELLS];
+    float bestValue = FLT_MAX;
+    int bestPrev = -1, i, idx;
+    SearchStatus status = SEARCH_NOT_FOUND;
+    BlockSearch search;
+
+    initSearchResult(result);
+    if (database == NULL)
+        return SEARCH_INVALID;
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+
+    search.query = query;
+    search.lddb = database->distance;
+    search.ncol = query->grid.ncol;
+    search.nrow = query->grid.nrow;
+    search.blocksX = (search.ncol + BLOCK_SIDE - 1) / BLOCK_SIDE;
+    numBlocks = search.blocksX * ((search.nrow + BLOCK_SIDE - 1) / BLOCK_SIDE);
+    ringLayout(search.ringCell, search.ringIndex);
+
+    search.g = (float*) malloc(numElement * sizeof(float));
+    search.steps = (OctileCost*) malloc(numElement * sizeof(OctileCost));
+    search.prev = (int*) malloc(numElement * sizeof(int));
+    for (i = 0; i < numElement; i++)
+        search.g[i] = FLT_MAX;
+    search.config = (int*) malloc(numBlocks * sizeof(int));
+    search.ingress = (uint16_t*) calloc(numBlocks, sizeof(uint16_t));
+    search.key = (float*) malloc(numBlocks * sizeof(float));
+    for (i = 0; i < numBlocks; i++)
+    {
+        search.config[i] = -1;
+        search.key[i] = FLT_MAX;
+    }
+    openListInit(&search.open, query->openList, numBlocks);
+    search.stats = &result->stats;
+
+    sourceBlock = blockOf(&search, sourceIdx);
+    targetBlock = blockOf(&search, targetIdx);
+    localDistances(configOf(&search, sourceBlock), localOf(&search, sourceIdx), sourceDistance, sourceReached, NULL);
+    localDistances(configOf(&search, targetBlock), localOf(&search, targetIdx), targetDistance, targetReached, NULL);
+
+    /* SOURCE is the first ingress cell; a path inside the shared block is a first candidate */
+    search.g[sourceIdx] = 0.0f;
+    search.steps[sourceIdx] = sourceDistance[localOf(&search, sourceIdx)];
+    search.prev[sourceIdx] = -1;
+    search.ingress[sourceBlock] = (uint16_t) (1 << localOf(&search, sourceIdx));
+    search.key[sourceBlock] = octileValue(octileDistance(sourceIdx, targetIdx, search.ncol));
+    openListPush(&search.open, sourceBlock, search.key[sourceBlock], 0.0f);
+    if (sourceBlock == targetBlock && sourceReached[localOf(&search, targetIdx)])
+    {
+        best = sourceDistance[localOf(&search, targetIdx)];
+        bestValue = octileValue(best);
+        bestPrev = sourceIdx;
+    }
+
+    while (search.open.size > 0 && openListTopKey(&search.open) < bestValue)
+    {
+        int b = openListPop(&search.open), config = configOf(&search, b);
+        int ingressCells[BLOCK_CELLS], numIngress = 0, r, k;
+        uint16_t ingress = search.ingress[b];
+        bool aborted = false;
+
+        search.ingress[b] = 0;
+        search.key[b] = FLT_MAX;
+        result->stats.expanded++;
+
+        for (i = 0; i < BLOCK_CELLS; i++)
+            if ((ingress >> i) & 1)
+            {
+                ingressCells[numIngress++] = cellOf(&search, b, i);
+                aborted = aborted || NOTIFY_OBSERVER(query, ingressCells[numIngress - 1], LBL_VISITING);
+            }
+        if (aborted)
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+
+        if (b == targetBlock)
+            for (k = 0; k < numIngress; k++)
+            {
+                int local = localOf(&search, ingressCells[k]);
+                if (targetReached[local] &&
+                    search.g[ingressCells[k]] + octileValue(targetDistance[local]) < bestValue)
+                {
+                    best = addCost(search.steps[ingressCells[k]], targetDistance[local]);
+                    bestValue = octileValue(best);
+                    bestPrev = ingressCells[k];
+                }
+            }
+
+        for (r = 0; r < BLOCK_RING && !aborted; r++)
+        {
+            int local = search.ringCell[r], x = cellOf(&search, b, local), from = -1, dx, dy;
+            bool wasIngress = (ingress >> local) & 1;
+            OctileCost through = {0, 0};
+
+            if (x < 0 || ((config >> local) & 1))
+                continue;
+
+            /* Best way across the block from an ingress cell to this ring cell */
+            for (k = 0; k < numIngress; k++)
+            {
+                int y = ingressCells[k];
+                OctileCost d;
+
+                if (y == sourceIdx)
+                {
+                    if (!sourceReached[local])
+                        continue;
+                    d = sourceDistance[local];
+                }
+                else
+                {
+                    uint8_t entry = search.lddb[((size_t) config * BLOCK_RING + search.ringIndex[localOf(&search, y)])
+                                                * BLOCK_RING + r];
+                    if (entry == BLOCK_UNREACHABLE)
+                        continue;
+                    d = unpackEntry(entry);
+                }
+                d = addCost(search.steps[y], d);
+                if (octileValue(d) < search.g[x] && (from < 0 || octileValue(d) < octileValue(through)))
+                {
+                    through = d;
+                    from = y;
+                }
+            }
+            if (from >= 0)
+            {
+                search.g[x] = octileValue(through);
+                search.steps[x] = through;
+                search.prev[x] = from;
+            }
+            else if (!wasIngress)
+                continue;
+
+            /* Out of the block, one move */
+            for (dy = -1; dy <= 1 && !aborted; dy++)
+                for (dx = -1; dx <= 1 && !aborted; dx++)
+                {
+                    int nx = x % search.ncol + dx, ny = x / search.ncol + dy, n;
+                    OctileCost step = search.steps[x];
+
+                    if (nx < 0 || nx >= search.ncol || ny < 0 || ny >= search.nrow)
+                        continue;
+                    n = nx + ny * search.ncol;
+                    if (blockOf(&search, n) == b || query->labels[n] == LBL_BLOCKED)
+                        continue;
+                    if (dx != 0 && dy != 0)
+                        step.diagonal++;
+                    else
+                        step.straight++;
+                    aborted = offerCell(&search, n, x, step);
+                }
+        }
+
+        for (k = 0; k < numIngress && !aborted; k++)
+            aborted = NOTIFY_OBSERVER(query, ingressCells[k], LBL_VISITED);
+        if (aborted)
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+    }
+
+    if (status != SEARCH_ABORTED && bestPrev >= 0)
+    {
+        /*
+         * Back from TARGET: every link is either one move between two blocks
+         * or a way across one block, redone here by a search of that block.
+         */
+        std::vector<int> links, path;
+
+        links.push_back(targetIdx);
+        for (idx = bestPrev; idx != -1; idx = search.prev[idx])
+            if (idx != links.back())
+                links.push_back(idx);
+
+        path.push_back(sourceIdx);
+        for (i = (int) links.size() - 2; i >= 0; i--)
+        {
+            int from = links[i + 1], to = links[i];
+            if (blockOf(&search, from) == blockOf(&search, to))
+                appendInBlock(&search, blockOf(&search, to), from, to, path);
+            path.push_back(to);
+        }
+
+        result->path = (int*) malloc(path.size() * sizeof(int));
+        memcpy(result->path, path.data(), path.size() * sizeof(int));
+        result->pathLen = (int) path.size();
+        result->cost = bestValue;
+        status = SEARCH_FOUND;
+    }
+
+    openListFree(&search.open);
+    free(search.g);
+    free(search.steps);
+    free(search.prev);
+    free(search.config);
+    free(search.ingress);
+    free(search.key);
+    return status;
+}
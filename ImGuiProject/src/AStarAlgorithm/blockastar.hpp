@@ -0,0 +1,33 @@
+/*
+ * Block A* (Yap, Burch, Holte & Schaeffer, 2011): the grid is cut into
+ * BLOCK_SIDE x BLOCK_SIDE blocks and the open list holds blocks instead of
+ * cells. Distances across a block are read from a local distance database
+ * (LDDB) holding, for every possible layout of BLOCKED cells in a block, the
+ * exact distances between the cells of its outer ring.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+#define BLOCK_SIDE              4
+#define BLOCK_CELLS             (BLOCK_SIDE * BLOCK_SIDE)
+#define BLOCK_RING              (4 * BLOCK_SIDE - 4)
+#define BLOCK_CONFIGS           (1 << BLOCK_CELLS)
+
+/* LDDB entry of two ring cells that cannot reach each other inside the block */
+#define BLOCK_UNREACHABLE       0xff
+
+/*
+ * The database does not depend on the map: one table serves every grid.
+ * Entry [config][from][to] packs the OctileCost between two ring cells as
+ * (straight << 4) | diagonal; bit i of `config` is set when local cell i,
+ * (i % BLOCK_SIDE, i / BLOCK_SIDE), is BLOCKED.
+ */
+typedef struct BlockDatabase
+{
+    uint8_t     *distance;      /* BLOCK_CONFIGS * BLOCK_RING * BLOCK_RING entries */
+} BlockDatabase;
+
+BlockDatabase* blockDatabaseBuild(void);
+void blockDatabaseFree(BlockDatabase* database);
+SearchStatus blockAStarSearch(const SearchQuery *query, SearchResult *result);
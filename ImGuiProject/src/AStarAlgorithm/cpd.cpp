@@ -0,0 +1,400 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <queue>
+#include <vector>
+
+#include "astar.hpp"
+#include "cpd.hpp"
+
+
+const int cpdMoveX[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+const int cpdMoveY[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+static const char CPD_MAGIC[4] = {'C', 'P', 'D', '1'};
+
+typedef std::pair<double, int> CpdEntry;
+typedef std::priority_queue<CpdEntry, std::vector<CpdEntry>, std::greater<CpdEntry> > CpdQueue;
+
+typedef struct CpdWorker
+{
+    const BlockLabels              *labels;
+    const Cpd                      *cpd;
+    int                             first;      /* sources first, first + step, ... */
+    int                             step;
+    std::vector<std::vector<uint32_t> > *rows;
+} CpdWorker;
+
+/* DFS numbering of the free cells, one tree per component */
+static void numberNodes(const BlockLabels* labels, Grid windowSize, Cpd* cpd)
+{
+    int numElement = windowSize.nrow * windowSize.ncol, ncol = windowSize.ncol;
+    std::vector<int> stack;
+    int root, k;
+
+    cpd->numNodes = 0;
+    for (root = 0; root < numElement; root++)
+        cpd->nodeOf[root] = -1;
+    for (root = 0; root < numElement; root++)
+    {
+        if (labels[root] == LBL_BLOCKED || cpd->nodeOf[root] != -1)
+            continue;
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            int idx = stack.back(), x = stack.back() % ncol, y = stack.back() / ncol;
+
+            stack.pop_back();
+            if (cpd->nodeOf[idx] != -1)
+                continue;
+            cpd->nodeOf[idx] = cpd->numNodes;
+            cpd->cellOf[cpd->numNodes++] = idx;
+            for (k = 7; k >= 0; k--)
+            {
+                int nx = x + cpdMoveX[k], ny = y + cpdMoveY[k];
+                if (nx >= 0 && nx < ncol && ny >= 0 && ny < windowSize.nrow &&
+                    labels[nx + ny * ncol] != LBL_BLOCKED && cpd->nodeOf[nx + ny * ncol] == -1)
+                    stack.push_back(nx + ny * ncol);
+            }
+        }
+    }
+}
+
+static int lowestMove(uint16_t moves)
+{
+    int k = 0;
+
+    while (!(moves & (1 << k)))
+        k++;
+    return k;
+}
+
+static inline double stepsValue(OctileCost steps)
+{
+    return steps.straight + steps.diagonal * M_SQRT2;
+}
+
+/*
+ * Dijkstra from `sourceIdx`: a cell inherits the first moves of every cell
+ * it is reached from on a shortest path, as a set of directions. Distances
+ * are computed from the move counts, so equal counts give equal doubles
+ * whatever the order of the moves, and two different costs a + b*sqrt(2) of
+ * this grid never get closer than about 1 / (a + b*sqrt(2)), far above the
+ * rounding of a double: ties are exact and any move of a set stays on a
+ * shortest path.
+ *
+ * `steps` and `moves` hold nrow*ncol entries: straight = -1 and
+ * 1 << CPD_NO_MOVE for the cells not reached; the source gets no moves.
+ */
+void cpdFirstMoveSets(const BlockLabels* labels, Grid windowSize, int sourceIdx, OctileCost* steps, uint16_t* moves)
+{
+    int numElement = windowSize.nrow * windowSize.ncol, ncol = windowSize.ncol, idx, k;
+    CpdQueue open;
+
+    for (idx = 0; idx < numElement; idx++)
+    {
+        steps[idx].straight = -1;
+        moves[idx] = 1 << CPD_NO_MOVE;
+    }
+    steps[sourceIdx].straight = steps[sourceIdx].diagonal = 0;
+    moves[sourceIdx] = 0;
+    open.push(CpdEntry(0.0, sourceIdx));
+    while (!open.empty())
+    {
+        CpdEntry top = open.top();
+        int x, y;
+
+        idx = top.second;
+        x = idx % ncol;
+        y = idx / ncol;
+        open.pop();
+        if (top.first > stepsValue(steps[idx]))
+            continue;
+        for (k = 0; k < 8; k++)
+        {
+            int nx = x + cpdMoveX[k], ny = y + cpdMoveY[k], next = nx + ny * ncol;
+            OctileCost through = steps[idx];
+            double candidate;
+
+            if (nx < 0 || nx >= ncol || ny < 0 || ny >= windowSize.nrow || labels[next] == LBL_BLOCKED)
+                continue;
+            if (cpdMoveX[k] != 0 && cpdMoveY[k] != 0)
+                through.diagonal++;
+            else
+                through.straight++;
+            candidate = stepsValue(through);
+            if (steps[next].straight >= 0 && stepsValue(steps[next]) < candidate)
+                continue;
+            if (steps[next].straight >= 0 && stepsValue(steps[next]) == candidate)
+            {
+                moves[next] |= (idx == sourceIdx) ? (1 << k) : moves[idx];
+                continue;
+            }
+            steps[next] = through;
+            moves[next] = (idx == sourceIdx) ? (1 << k) : moves[idx];
+            open.push(CpdEntry(candidate, next));
+        }
+    }
+}
+
+/*
+ * The runs pick, among the sets of cpdFirstMoveSets(), moves that keep them
+ * as long as possible: on open maps most targets have two or three optimal
+ * first moves.
+ */
+static void* cpdWorker(void* arg)
+{
+    CpdWorker* worker = (CpdWorker*) arg;
+    const Cpd* cpd = worker->cpd;
+    int numElement = cpd->windowSize.nrow * cpd->windowSize.ncol;
+    std::vector<OctileCost> steps(numElement);
+    std::vector<uint16_t> moves(numElement);
+    int source, r, runStart;
+    uint16_t common;
+
+    for (source = worker->first; source < cpd->numNodes; source += worker->step)
+    {
+        std::vector<uint32_t>& row = (*worker->rows)[source];
+
+        cpdFirstMoveSets(worker->labels, cpd->windowSize, cpd->cellOf[source], steps.data(), moves.data());
+
+        /*
+         * Runs over the DFS numbers, each as long as its targets share a
+         * move; the source itself fits any run
+         */
+        runStart = 0;
+        common = 0x1ff;
+        for (r = 0; r < cpd->numNodes; r++)
+        {
+            if (r == source)
+                continue;
+            if ((common & moves[cpd->cellOf[r]]) == 0)
+            {
+                row.push_back(((uint32_t) runStart << 4) | lowestMove(common));
+                runStart = r;
+                common = 0x1ff;
+            }
+            common &= moves[cpd->cellOf[r]];
+        }
+        row.push_back(((uint32_t) runStart << 4) | lowestMove(common));
+    }
+    return NULL;
+}
+
+/*
+ * One Dijkstra per free cell, so the build grows with the square of the map
+ * size; the sources are shared out among numThreads workers.
+ */
+Cpd* cpdBuild(const BlockLabels* labels, Grid windowSize, int numThreads)
+{
+    int numElement = windowSize.nrow * windowSize.ncol, numStarted, w, s;
+    std::vector<std::vector<uint32_t> > rows;
+    std::vector<CpdWorker> workers;
+    std::vector<pthread_t> threads;
+    Cpd* cpd = (Cpd*) malloc(sizeof(Cpd));
+    int64_t numRuns = 0;
+
+    cpd->windowSize = windowSize;
+    cpd->nodeOf = (int*) malloc(numElement * sizeof(int));
+    cpd->cellOf = (int*) malloc(MAX2(numElement, 1) * sizeof(int));
+    numberNodes(labels, windowSize, cpd);
+
+    numThreads = MAX2(numThreads, 1);
+    rows.resize(cpd->numNodes);
+    workers.resize(numThreads);
+    threads.resize(numThreads);
+    for (w = 0; w < numThreads; w++)
+    {
+        workers[w].labels = labels;
+        workers[w].cpd = cpd;
+        workers[w].first = w;
+        workers[w].step = numThreads;
+        workers[w].rows = &rows;
+    }
+
+    /* Worker 0, and any worker whose thread could not start, run on this thread */
+    for (numStarted = 1; numStarted < numThreads; numStarted++)
+        if (pthread_create(&threads[numStarted], NULL, cpdWorker, &workers[numStarted]) != 0)
+            break;
+    cpdWorker(&workers[0]);
+    for (w = numStarted; w < numThreads; w++)
+        cpdWorker(&workers[w]);
+    for (w = 1; w < numStarted; w++)
+        pthread_join(threads[w], NULL);
+
+    cpd->rowStart = (int64_t*) malloc((cpd->numNodes + 1) * sizeof(int64_t));
+    for (s = 0; s < cpd->numNodes; s++)
+    {
+        cpd->rowStart[s] = numRuns;
+        numRuns += (int64_t) rows[s].size();
+    }
+    cpd->rowStart[cpd->numNodes] = numRuns;
+    cpd->runs = (uint32_t*) malloc(MAX2(numRuns, (int64_t) 1) * sizeof(uint32_t));
+    for (s = 0; s < cpd->numNodes; s++)
+    {
+        memcpy(cpd->runs + cpd->rowStart[s], rows[s].data(), rows[s].size() * sizeof(uint32_t));
+        std::vector<uint32_t>().swap(rows[s]);
+    }
+    return cpd;
+}
+
+void cpdFree(Cpd* cpd)
+{
+    if (cpd == NULL)
+        return;
+    free(cpd->cellOf);
+    free(cpd->nodeOf);
+    free(cpd->rowStart);
+    free(cpd->runs);
+    free(cpd);
+}
+
+/* Write the database to `path`; 0 on success, -1 on error */
+int cpdSave(const Cpd* cpd, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    int32_t header[3] = {cpd->windowSize.nrow, cpd->windowSize.ncol, cpd->numNodes};
+    size_t numRuns = (size_t) cpd->rowStart[cpd->numNodes];
+    bool ok;
+
+    if (file == NULL)
+        return -1;
+    ok = fwrite(CPD_MAGIC, 1, 4, file) == 4 &&
+         fwrite(header, sizeof(int32_t), 3, file) == 3 &&
+         fwrite(cpd->cellOf, sizeof(int), cpd->numNodes, file) == (size_t) cpd->numNodes &&
+         fwrite(cpd->rowStart, sizeof(int64_t), cpd->numNodes + 1, file) == (size_t) cpd->numNodes + 1 &&
+         fwrite(cpd->runs, sizeof(uint32_t), numRuns, file) == numRuns;
+    return (fclose(file) == 0 && ok) ? 0 : -1;
+}
+
+/*
+ * Read a database written by cpdSave(). NULL if the file cannot be read, or
+ * was built for another grid: the free cells must be exactly those of
+ * `labels`.
+ */
+Cpd* cpdLoad(const char* path, const BlockLabels* labels, Grid windowSize)
+{
+    FILE* file = fopen(path, "rb");
+    int numElement = windowSize.nrow * windowSize.ncol, idx, numFree = 0, n;
+    int32_t header[3];
+    char magic[4];
+    size_t numRuns;
+    Cpd* cpd;
+    bool ok;
+
+    if (file == NULL)
+        return NULL;
+    if (fread(magic, 1, 4, file) != 4 || memcmp(magic, CPD_MAGIC, 4) != 0 ||
+        fread(header, sizeof(int32_t), 3, file) != 3 ||
+        header[0] != windowSize.nrow || header[1] != windowSize.ncol)
+    {
+        fclose(file);
+        return NULL;
+    }
+    for (idx = 0; idx < numElement; idx++)
+        numFree += (labels[idx] != LBL_BLOCKED);
+    if (header[2] != numFree)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    cpd = (Cpd*) malloc(sizeof(Cpd));
+    cpd->windowSize = windowSize;
+    cpd->numNodes = header[2];
+    cpd->cellOf = (int*) malloc(MAX2(cpd->numNodes, 1) * sizeof(int));
+    cpd->nodeOf = (int*) malloc(numElement * sizeof(int));
+    cpd->rowStart = (int64_t*) malloc((cpd->numNodes + 1) * sizeof(int64_t));
+    cpd->runs = NULL;
+    ok = fread(cpd->cellOf, sizeof(int), cpd->numNodes, file) == (size_t) cpd->numNodes &&
+         fread(cpd->rowStart, sizeof(int64_t), cpd->numNodes + 1, file) == (size_t) cpd->numNodes + 1;
+    if (ok)
+    {
+        numRuns = (size_t) cpd->rowStart[cpd->numNodes];
+        cpd->runs = (uint32_t*) malloc(MAX2(numRuns, (size_t) 1) * sizeof(uint32_t));
+        ok = fread(cpd->runs, sizeof(uint32_t), numRuns, file) == numRuns;
+    }
+    fclose(file);
+
+    for (idx = 0; idx < numElement; idx++)
+        cpd->nodeOf[idx] = -1;
+    for (n = 0; ok && n < cpd->numNodes; n++)
+    {
+        idx = cpd->cellOf[n];
+        ok = idx >= 0 && idx < numElement && labels[idx] != LBL_BLOCKED && cpd->nodeOf[idx] == -1;
+        if (ok)
+            cpd->nodeOf[idx] = n;
+    }
+    if (!ok)
+    {
+        cpdFree(cpd);
+        return NULL;
+    }
+    return cpd;
+}
+
+/* Direction of the first move from `fromIdx` toward `toIdx`, CPD_NO_MOVE if unreachable */
+int cpdFirstMove(const Cpd* cpd, int fromIdx, int toIdx)
+{
+    const uint32_t* row = cpd->runs + cpd->rowStart[cpd->nodeOf[fromIdx]];
+    uint32_t target = (uint32_t) cpd->nodeOf[toIdx];
+    int64_t low = 0, high = cpd->rowStart[cpd->nodeOf[fromIdx] + 1] - cpd->rowStart[cpd->nodeOf[fromIdx]] - 1;
+
+    /* Last run starting at or before the target */
+    while (low < high)
+    {
+        int64_t middle = (low + high + 1) / 2;
+        if ((row[middle] >> 4) <= target)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    return (int) (row[low] & 15);
+}
+
+/*
+ * CPD engine of findPath(), with query->preprocessed the cpdBuild() /
+ * cpdLoad() database of the grid. `stats.expanded` counts the lookups.
+ */
+SearchStatus cpdSearch(const SearchQuery *query, SearchResult *result)
+{
+    const Cpd* cpd = (const Cpd*) query->preprocessed;
+    int ncol = query->grid.ncol, current, move, len;
+    std::vector<int> path;
+    OctileCost cost = {0, 0};
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+    if (cpd == NULL || cpd->windowSize.nrow != query->grid.nrow || cpd->windowSize.ncol != ncol)
+        return SEARCH_INVALID;
+
+    current = query->sourceIdx;
+    path.push_back(current);
+    while (current != query->targetIdx)
+    {
+        move = cpdFirstMove(cpd, current, query->targetIdx);
+        result->stats.expanded++;
+        /* Unreachable, or a database of another grid that walks in circles */
+        if (move == CPD_NO_MOVE || (int) path.size() > cpd->numNodes)
+            return SEARCH_NOT_FOUND;
+
+        current += cpdMoveX[move] + cpdMoveY[move] * ncol;
+        if (cpdMoveX[move] != 0 && cpdMoveY[move] != 0)
+            cost.diagonal++;
+        else
+            cost.straight++;
+        path.push_back(current);
+        if (NOTIFY_OBSERVER(query, current, LBL_VISITED))
+            return SEARCH_ABORTED;
+    }
+
+    len = (int) path.size();
+    result->path = (int*) malloc(len * sizeof(int));
+    memcpy(result->path, path.data(), len * sizeof(int));
+    result->pathLen = len;
+    result->cost = octileValue(cost);
+    return SEARCH_FOUND;
+}
@@ -0,0 +1,41 @@
+/*
+ * Compressed Path Database, CPD (Botea, 2011; Strasser, Botea & Harabor,
+ * 2015): the first move of a shortest path from every cell to every other
+ * one, computed once per map. The row of a cell lists the first move toward
+ * each target with targets numbered in DFS order, where nearby cells get
+ * nearby numbers and mostly share their first move, so each row is stored as
+ * runs of equal moves. A query only follows first moves: no open list and no
+ * heuristic, one binary search in a row per cell of the path.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "astar.hpp"
+
+#define CPD_NO_MOVE             8       /* the target is not reachable */
+
+/*
+ * Directions of the first moves, as indices in cpdMoveX / cpdMoveY. A run
+ * is packed as (first target number << 4) | direction.
+ */
+extern const int cpdMoveX[8];
+extern const int cpdMoveY[8];
+
+typedef struct Cpd
+{
+    Grid         windowSize;
+    int          numNodes;      /* free cells                                   */
+    int         *cellOf;        /* cell of each DFS number                      */
+    int         *nodeOf;        /* DFS number of each cell, -1 if blocked       */
+    int64_t     *rowStart;      /* numNodes + 1 offsets into `runs`, per source */
+    uint32_t    *runs;
+} Cpd;
+
+Cpd* cpdBuild(const BlockLabels* labels, Grid windowSize, int numThreads);
+int cpdSave(const Cpd* cpd, const char* path);
+Cpd* cpdLoad(const char* path, const BlockLabels* labels, Grid windowSize);
+void cpdFree(Cpd* cpd);
+int cpdFirstMove(const Cpd* cpd, int fromIdx, int toIdx);
+void cpdFirstMoveSets(const BlockLabels* labels, Grid windowSize, int sourceIdx, OctileCost* steps, uint16_t* moves);
+SearchStatus cpdSearch(const SearchQuery *query, SearchResult *result);
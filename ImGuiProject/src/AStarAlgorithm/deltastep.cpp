@@ -0,0 +1,394 @@
+#include <float.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#include "astar.hpp"
+#include "deltastep.hpp"
+
+
+/*
+ * Distances are packed OctileCosts lowered by compare-and-swap, so threads
+ * relax edges with no lock. Bucket b holds the cells whose distance lies in
+ * [b * delta, (b + 1) * delta); no move is longer than sqrt(2), so only the
+ * buckets from the current one to sqrt(2) / delta ahead are in use at once
+ * and they are kept in a circular array.
+ *
+ * Every phase, the calling thread hands a list of cells to the threads, each
+ * relaxes the edges of its slice of the list and records the cells it
+ * improved; after a barrier the calling thread files them into their bucket
+ * (skipping duplicates) and notifies the observer, so the observer is only
+ * ever called from the calling thread.
+ */
+
+#define UNREACHED               UINT64_MAX
+
+typedef enum DeltaPhase
+{
+    PHASE_LIGHT,                /* relax the edges of weight <= delta */
+    PHASE_HEAVY,                /* relax the edges of weight > delta  */
+    PHASE_EXIT
+} DeltaPhase;
+
+typedef struct IntList
+{
+    int         *items;
+    int          size;
+    int          capacity;
+} IntList;
+
+typedef struct DeltaWorker
+{
+    struct DeltaSearch *search;
+    int                 id;
+    IntList             improved;   /* cells this thread lowered during the phase */
+    char                padding[64];
+} DeltaWorker;
+
+typedef struct DeltaSearch
+{
+    const SearchQuery      *query;
+    float                   delta;
+    std::atomic<uint64_t>  *steps;
+    std::atomic<int>        numWorkers; /* threads taking part in the phases */
+    DeltaWorker            *workers;
+
+    /* Buckets, only touched by the calling thread */
+    IntList                *buckets;
+    int                     numBuckets;
+    long                   *queuedIn;   /* bucket a cell is filed in, -1 if none */
+    long                    numQueued;  /* entries in the buckets, stale ones included */
+
+    /* Phase published by the calling thread before the first barrier */
+    DeltaPhase              phase;
+    const int              *cells;
+    int                     numCells;
+
+    /* Sense-reversing barrier (pthread_barrier_t is missing on macOS) */
+    std::atomic<int>        arrived;
+    std::atomic<int>        sense;
+} DeltaSearch;
+
+static void listAppend(IntList* list, int value)
+{
+    if (list->size == list->capacity)
+    {
+        list->capacity = MAX2(2 * list->capacity, 64);
+        list->items = (int*) realloc(list->items, list->capacity * sizeof(int));
+    }
+    list->items[list->size++] = value;
+}
+
+static void barrierWait(DeltaSearch* search, int* localSense)
+{
+    *localSense = !*localSense;
+    if (search->arrived.fetch_add(1) == search->numWorkers - 1)
+    {
+        search->arrived = 0;
+        search->sense = *localSense;
+    }
+    else
+    {
+        while (search->sense != *localSense)
+            sched_yield();
+    }
+}
+
+static inline float stepsValue(uint64_t packed)
+{
+    return (packed == UNREACHED) ? FLT_MAX : octileValue(unpackSteps(packed));
+}
+
+static inline long bucketOf(const DeltaSearch* search, float distance)
+{
+    return (long) (distance / search->delta);
+}
+
+/* Relax the light or the heavy edges of the cells of this worker's slice */
+static void relaxSlice(DeltaWorker* worker)
+{
+    DeltaSearch* search = worker->search;
+    const SearchQuery* query = search->query;
+    Grid windowSize = query->grid;
+    int i, first, last;
+
+    first = (int) ((long) search->numCells * worker->id / search->numWorkers);
+    last  = (int) ((long) search->numCells * (worker->id + 1) / search->numWorkers);
+
+    for (i = first; i < last; i++)
+    {
+        int padx, pady, idx = search->cells[i];
+        int x = idx % windowSize.ncol, y = idx / windowSize.ncol;
+        OctileCost base = unpackSteps(search->steps[idx].load());
+
+        for (pady = -1; pady <= 1; pady++)
+        {
+            for (padx = -1; padx <= 1; padx++)
+            {
+                int neighbourIdx;
+                float weight = adjDistance(padx, pady);
+                OctileCost steps;
+                uint64_t current;
+                float distance;
+
+                if (weight == 0.0f || (weight <= search->delta) != (search->phase == PHASE_LIGHT) ||
+                    x + padx < 0 || x + padx >= windowSize.ncol ||
+                    y + pady < 0 || y + pady >= windowSize.nrow)
+                    continue;
+
+                neighbourIdx = idx + padx + pady * windowSize.ncol;
+                if (query->labels[neighbourIdx] == LBL_BLOCKED)
+                    continue;
+
+                steps = base;
+                if (padx != 0 && pady != 0)
+                    steps.diagonal++;
+                else
+                    steps.straight++;
+                distance = octileValue(steps);
+
+                current = search->steps[neighbourIdx].load();
+                while (stepsValue(current) > distance &&
+                       !search->steps[neighbourIdx].compare_exchange_weak(current, packSteps(steps)))
+                    ;
+                if (stepsValue(current) > distance)
+                    listAppend(&worker->improved, neighbourIdx);
+            }
+        }
+    }
+}
+
+static void* deltaWorker(void* arg)
+{
+    DeltaWorker* worker = (DeltaWorker*) arg;
+    DeltaSearch* search = worker->search;
+    int localSense = 0;
+
+    while (true)
+    {
+        barrierWait(search, &localSense);
+        if (search->phase == PHASE_EXIT)
+            break;
+        relaxSlice(worker);
+        barrierWait(search, &localSense);
+    }
+    return NULL;
+}
+
+/* File the cells the threads improved in their new bucket. Returns false if the observer aborts. */
+static bool fileImproved(DeltaSearch* search, SearchStats* stats)
+{
+    const SearchQuery* query = search->query;
+    bool aborted = false;
+    int i, w;
+
+    for (w = 0; w < search->numWorkers; w++)
+    {
+        IntList* improved = &search->workers[w].improved;
+        for (i = 0; i < improved->size; i++)
+        {
+            int idx = improved->items[i];
+            long b = bucketOf(search, stepsValue(search->steps[idx].load()));
+
+            if (search->queuedIn[idx] == b)
+                continue;
+            search->queuedIn[idx] = b;
+            listAppend(&search->buckets[b % search->numBuckets], idx);
+            search->numQueued++;
+            stats->generated++;
+            if (!aborted && NOTIFY_OBSERVER(query, idx, LBL_TOBEVISITED))
+                aborted = true;
+        }
+        improved->size = 0;
+    }
+    stats->maxOpenSize = MAX2(stats->maxOpenSize, search->numQueued);
+    return !aborted;
+}
+
+/* Run one phase on every thread, the calling thread being worker 0 */
+static void runPhase(DeltaSearch* search, DeltaPhase phase, const int* cells, int numCells,
+                     int* localSense)
+{
+    search->phase = phase;
+    search->cells = cells;
+    search->numCells = numCells;
+    barrierWait(search, localSense);
+    if (phase != PHASE_EXIT)
+    {
+        relaxSlice(&search->workers[0]);
+        barrierWait(search, localSense);
+    }
+}
+
+/*
+ * Delta-stepping from query->sourceIdx. With `targetIdx` >= 0 it stops as
+ * soon as the distance of that cell is final. Returns the distance of every
+ * cell (malloc'd, FLT_MAX if unreachable), or NULL if the observer aborted.
+ */
+static float* deltaStepping(const SearchQuery* query, float delta, int targetIdx, SearchStats* stats)
+{
+    DeltaSearch search;
+    pthread_t* threads;
+    IntList frontier = {NULL, 0, 0}, settled = {NULL, 0, 0};
+    int i, w, numStarted, localSense = 0;
+    int numThreads = MAX2(query->numThreads, 1);
+    int numElement = query->grid.nrow * query->grid.ncol;
+    long* settledIn;            /* last bucket that settled a cell */
+    long bucket;
+    float* distance = NULL;
+    bool aborted = false;
+    OctileCost zero = {0, 0};
+
+    search.query = query;
+    search.delta = delta;
+    search.steps = new std::atomic<uint64_t>[numElement];
+    search.numWorkers = numThreads;
+    search.workers = (DeltaWorker*) calloc(numThreads, sizeof(DeltaWorker));
+    search.arrived = 0;
+    search.sense = 0;
+    search.numBuckets = (int) (SQRT2 / delta) + 2;
+    search.buckets = (IntList*) calloc(search.numBuckets, sizeof(IntList));
+    search.queuedIn = (long*) malloc(numElement * sizeof(long));
+    settledIn = (long*) malloc(numElement * sizeof(long));
+    for (i = 0; i < numElement; i++)
+    {
+        search.steps[i].store(UNREACHED, std::memory_order_relaxed);
+        search.queuedIn[i] = settledIn[i] = -1;
+    }
+    for (w = 0; w < numThreads; w++)
+    {
+        search.workers[w].search = &search;
+        search.workers[w].id = w;
+    }
+
+    /* A thread that cannot be started is left out of the phases */
+    threads = (pthread_t*) malloc(numThreads * sizeof(pthread_t));
+    for (numStarted = 1; numStarted < numThreads; numStarted++)
+        if (pthread_create(&threads[numStarted], NULL, deltaWorker, &search.workers[numStarted]) != 0)
+            break;
+    search.numWorkers = numStarted;
+
+    search.steps[query->sourceIdx] = packSteps(zero);
+    listAppend(&search.buckets[0], query->sourceIdx);
+    search.queuedIn[query->sourceIdx] = 0;
+    search.numQueued = 1;
+
+    for (bucket = 0; search.numQueued > 0 && !aborted; bucket++)
+    {
+        IntList* current = &search.buckets[bucket % search.numBuckets];
+
+        /* Every cell closer than this bucket is final, TARGET included */
+        if (targetIdx >= 0 && bucket * delta >= stepsValue(search.steps[targetIdx].load()))
+            break;
+
+        settled.size = 0;
+        while (current->size > 0 && !aborted)
+        {
+            /* Take the bucket as the frontier, keeping the cells that still belong to it */
+            frontier.size = 0;
+            for (i = 0; i < current->size; i++)
+            {
+                int idx = current->items[i];
+
+                search.numQueued--;
+                if (search.queuedIn[idx] != bucket)
+                    continue;
+                search.queuedIn[idx] = -1;
+                listAppend(&frontier, idx);
+                if (settledIn[idx] != bucket)
+                {
+                    settledIn[idx] = bucket;
+                    listAppend(&settled, idx);
+                }
+                stats->expanded++;
+                if (!aborted && NOTIFY_OBSERVER(query, idx, LBL_VISITING))
+                    aborted = true;
+            }
+            current->size = 0;
+
+            /* Light edges may refill the current bucket, hence the loop */
+            runPhase(&search, PHASE_LIGHT, frontier.items, frontier.size, &localSense);
+            if (!fileImproved(&search, stats))
+                aborted = true;
+        }
+
+        /* The bucket is final: its heavy edges only reach later buckets */
+        runPhase(&search, PHASE_HEAVY, settled.items, settled.size, &localSense);
+        if (!fileImproved(&search, stats))
+            aborted = true;
+        for (i = 0; i < settled.size && !aborted; i++)
+            if (NOTIFY_OBSERVER(query, settled.items[i], LBL_VISITED))
+                aborted = true;
+    }
+
+    runPhase(&search, PHASE_EXIT, NULL, 0, &localSense);
+    for (w = 1; w < numStarted; w++)
+        pthread_join(threads[w], NULL);
+
+    if (!aborted)
+    {
+        distance = (float*) malloc(numElement * sizeof(float));
+        for (i = 0; i < numElement; i++)
+            distance[i] = stepsValue(search.steps[i].load(std::memory_order_relaxed));
+    }
+
+    for (i = 0; i < search.numBuckets; i++)
+        free(search.buckets[i].items);
+    for (w = 0; w < numThreads; w++)
+        free(search.workers[w].improved.items);
+    free(search.buckets);
+    free(search.queuedIn);
+    free(frontier.items);
+    free(settled.items);
+    free(settledIn);
+    free(threads);
+    free(search.workers);
+    delete[] search.steps;
+
+    return distance;
+}
+
+/*
+ * One-to-all distances from query->sourceIdx (TARGET is ignored), in buckets
+ * of width `delta` relaxed by query->numThreads threads. Returns a malloc'd
+ * array of nrow*ncol distances, FLT_MAX for the unreachable cells, or NULL
+ * if SOURCE is invalid or the observer aborted.
+ */
+float* distanceField(const SearchQuery *query, float delta)
+{
+    SearchStats stats;
+    int numElement = query->grid.nrow * query->grid.ncol;
+
+    if (query->labels == NULL || delta <= 0.0f ||
+        query->sourceIdx < 0 || query->sourceIdx >= numElement ||
+        query->labels[query->sourceIdx] == LBL_BLOCKED)
+        return NULL;
+
+    memset(&stats, 0, sizeof(SearchStats));
+    return deltaStepping(query, delta, -1, &stats);
+}
+
+/* Delta-stepping as a search engine: stops once TARGET is final, then walks back its path */
+SearchStatus deltaSteppingSearch(const SearchQuery *query, SearchResult *result)
+{
+    float* distance;
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+
+    distance = deltaStepping(query, DELTA_STEPPING_WIDTH, query->targetIdx, &result->stats);
+    if (distance == NULL)
+        return SEARCH_ABORTED;
+    if (distance[query->targetIdx] == FLT_MAX)
+    {
+        free(distance);
+        return SEARCH_NOT_FOUND;
+    }
+
+    storeDescentPath(query, distance, result);
+    free(distance);
+    return SEARCH_FOUND;
+}
@@ -0,0 +1,18 @@
+/*
+ * Delta-stepping (Meyer & Sanders, 2003): single-source shortest paths with
+ * the cells kept in buckets of width DELTA_STEPPING_WIDTH, every bucket being
+ * relaxed by query->numThreads threads at once.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+/*
+ * Width of a bucket. With 1, straight moves (cost 1) are the light edges,
+ * relaxed again and again while the bucket keeps refilling, and diagonal
+ * moves (sqrt(2)) the heavy ones, relaxed once when the bucket is done.
+ */
+#define DELTA_STEPPING_WIDTH    1.0f
+
+float* distanceField(const SearchQuery *query, float delta);
+SearchStatus deltaSteppingSearch(const SearchQuery *query, SearchResult *result);
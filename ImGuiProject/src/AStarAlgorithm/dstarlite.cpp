@@ -0,0 +1,397 @@
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "dstarlite.hpp"
+
+
+/*
+ * The search runs backward: g of a cell is its distance to TARGET, so the
+ * distances stay valid while SOURCE moves and only the keys need km. A cell
+ * whose rhs drops below g is overconsistent: its expansion lowers g to rhs
+ * and offers it to the neighbours, as in A*. A cell whose rhs went up
+ * (an obstacle appeared on its shortest path) is underconsistent: its
+ * expansion raises g to infinity, the neighbours that relied on it compute
+ * their rhs again, and the cell comes back later with its new distance.
+ * The run stops once SOURCE is consistent and no queued key is below its own.
+ *
+ * Moves are the 8 neighbours; a move between two cells exists when neither
+ * is BLOCKED, in both directions, so predecessors and successors coincide.
+ */
+
+typedef struct DStarRun
+{
+    DStarLite           *planner;
+    const SearchQuery   *query;         /* NULL when called from dstarLiteToggleCell() */
+    const BlockLabels   *labels;
+    int                  ncol;
+    int                  nrow;
+    SearchStats         *stats;
+    bool                 aborted;
+} DStarRun;
+
+static const OctileCost INFINITE_COST = {INT_MAX, INT_MAX};
+
+static inline bool isInfinite(OctileCost cost)
+{
+    return cost.straight == INT_MAX;
+}
+
+static inline bool sameCost(OctileCost a, OctileCost b)
+{
+    return a.straight == b.straight && a.diagonal == b.diagonal;
+}
+
+static inline OctileCost addCost(OctileCost a, OctileCost b)
+{
+    if (isInfinite(a) || isInfinite(b))
+        return INFINITE_COST;
+    a.straight += b.straight;
+    a.diagonal += b.diagonal;
+    return a;
+}
+
+/*
+ * Exact a < b: the sign of (sa - sb) + (da - db) * sqrt(2) follows from
+ * integers only, since sqrt(2) is irrational the two terms never cancel.
+ */
+static bool costLess(OctileCost a, OctileCost b)
+{
+    long long straight, diagonal;
+
+    if (isInfinite(a) || isInfinite(b))
+        return !isInfinite(a) && isInfinite(b);
+    straight = (long long) a.straight - b.straight;
+    diagonal = (long long) a.diagonal - b.diagonal;
+    if (straight <= 0 && diagonal <= 0)
+        return straight < 0 || diagonal < 0;
+    if (straight >= 0 && diagonal >= 0)
+        return false;
+    if (straight < 0)
+        return straight * straight > 2 * diagonal * diagonal;
+    return 2 * diagonal * diagonal > straight * straight;
+}
+
+static inline OctileCost minCost(OctileCost a, OctileCost b)
+{
+    return costLess(b, a) ? b : a;
+}
+
+/*
+ * Float of a key for the open list. Rounding from a double keeps the order:
+ * equal distances always get equal keys, different ones never swap.
+ */
+static inline float keyValue(OctileCost cost)
+{
+    if (isInfinite(cost))
+        return FLT_MAX;
+    return (float) ((double) cost.straight + (double) cost.diagonal * 1.4142135623730951);
+}
+
+static inline bool keyLess(float a1, float a2, float b1, float b2)
+{
+    return a1 < b1 || (a1 == b1 && a2 < b2);
+}
+
+/* Cost of the move between two neighbour cells, infinite when one of them is BLOCKED */
+static inline OctileCost moveCost(const DStarRun* run, int fromIdx, int toIdx)
+{
+    if (run->labels[fromIdx] == LBL_BLOCKED || run->labels[toIdx] == LBL_BLOCKED)
+        return INFINITE_COST;
+    return octileDistance(fromIdx, toIdx, run->ncol);
+}
+
+/* The (up to) 8 neighbours of `idx`, returns their number */
+static int neighbours(const DStarRun* run, int idx, int around[8])
+{
+    int x = idx % run->ncol, y = idx / run->ncol;
+    int padx, pady, n = 0;
+
+    for (pady = -1; pady <= 1; pady++)
+        for (padx = -1; padx <= 1; padx++)
+        {
+            if ((padx == 0 && pady == 0) ||
+                x + padx < 0 || x + padx >= run->ncol ||
+                y + pady < 0 || y + pady >= run->nrow)
+                continue;
+            around[n++] = idx + padx + pady * run->ncol;
+        }
+    return n;
+}
+
+static void calculateKey(const DStarRun* run, int idx, float* k1, float* k2)
+{
+    const DStarLite* planner = run->planner;
+    OctileCost best = minCost(planner->g[idx], planner->rhs[idx]);
+
+    *k2 = keyValue(best);
+    *k1 = keyValue(addCost(addCost(best, octileDistance(planner->sourceIdx, idx, run->ncol)), planner->km));
+}
+
+/* min(cost + g) over the neighbours of `idx` */
+static OctileCost lookahead(const DStarRun* run, int idx)
+{
+    int around[8], i, n = neighbours(run, idx, around);
+    OctileCost best = INFINITE_COST;
+
+    for (i = 0; i < n; i++)
+        best = minCost(best, addCost(moveCost(run, idx, around[i]), run->planner->g[around[i]]));
+    return best;
+}
+
+/* Queue `idx` with its current key if it is inconsistent, take it out otherwise */
+static void updateVertex(DStarRun* run, int idx)
+{
+    DStarLite* planner = run->planner;
+    float k1, k2;
+
+    if (sameCost(planner->g[idx], planner->rhs[idx]))
+    {
+        openListRemove(&planner->open, idx);
+        return;
+    }
+
+    calculateKey(run, idx, &k1, &k2);
+    openListPush(&planner->open, idx, k1, k2);
+    run->stats->generated++;
+    run->stats->maxOpenSize = MAX2(run->stats->maxOpenSize, (long) planner->open.size);
+    if (run->query != NULL && NOTIFY_OBSERVER(run->query, idx, LBL_TOBEVISITED))
+        run->aborted = true;
+}
+
+/* Forget every distance and root a new search at `targetIdx` */
+static void resetPlanner(DStarRun* run, int targetIdx, int sourceIdx)
+{
+    DStarLite* planner = run->planner;
+    int i, numElement = planner->windowSize.nrow * planner->windowSize.ncol;
+
+    for (i = 0; i < numElement; i++)
+    {
+        planner->g[i] = INFINITE_COST;
+        planner->rhs[i] = INFINITE_COST;
+    }
+    openListFree(&planner->open);
+    openListInit(&planner->open, OPENLIST_HEAP, numElement);
+
+    planner->targetIdx = targetIdx;
+    planner->sourceIdx = sourceIdx;
+    planner->km.straight = 0;
+    planner->km.diagonal = 0;
+    planner->rhs[targetIdx].straight = 0;
+    planner->rhs[targetIdx].diagonal = 0;
+    updateVertex(run, targetIdx);
+}
+
+static void computeShortestPath(DStarRun* run)
+{
+    DStarLite* planner = run->planner;
+    int sourceIdx = planner->sourceIdx, targetIdx = planner->targetIdx;
+    int around[8], i, n, idx;
+    float topK1, topK2, k1, k2, sourceK1, sourceK2;
+
+    while (!run->aborted)
+    {
+        idx = openListTop(&planner->open, &topK1, &topK2);
+        if (idx == -1)
+            break;
+        calculateKey(run, sourceIdx, &sourceK1, &sourceK2);
+        if (!keyLess(topK1, topK2, sourceK1, sourceK2) &&
+            !costLess(planner->g[sourceIdx], planner->rhs[sourceIdx]))
+            break;
+
+        /* Queued before km grew: requeue with its current key first */
+        calculateKey(run, idx, &k1, &k2);
+        if (keyLess(topK1, topK2, k1, k2))
+        {
+            openListPush(&planner->open, idx, k1, k2);
+            continue;
+        }
+
+        run->stats->expanded++;
+        if (run->query != NULL && NOTIFY_OBSERVER(run->query, idx, LBL_VISITING))
+        {
+            run->aborted = true;
+            break;
+        }
+
+        n = neighbours(run, idx, around);
+        if (costLess(planner->rhs[idx], planner->g[idx]))
+        {
+            planner->g[idx] = planner->rhs[idx];
+            openListRemove(&planner->open, idx);
+            for (i = 0; i < n; i++)
+            {
+                OctileCost offer = addCost(moveCost(run, around[i], idx), planner->g[idx]);
+                if (around[i] == targetIdx || !costLess(offer, planner->rhs[around[i]]))
+                    continue;
+                planner->rhs[around[i]] = offer;
+                updateVertex(run, around[i]);
+            }
+        }
+        else
+        {
+            OctileCost previous = planner->g[idx];
+
+            planner->g[idx] = INFINITE_COST;
+            for (i = 0; i < n; i++)
+            {
+                /* Only the neighbours whose rhs came through `idx` have to look again */
+                OctileCost offer = addCost(moveCost(run, around[i], idx), previous);
+                if (around[i] == targetIdx || isInfinite(offer) ||
+                    !sameCost(planner->rhs[around[i]], offer))
+                    continue;
+                planner->rhs[around[i]] = lookahead(run, around[i]);
+                updateVertex(run, around[i]);
+            }
+            if (idx != targetIdx)
+                planner->rhs[idx] = lookahead(run, idx);
+            updateVertex(run, idx);
+        }
+
+        if (run->query != NULL && NOTIFY_OBSERVER(run->query, idx, LBL_VISITED))
+            run->aborted = true;
+    }
+}
+
+DStarLite* dstarLiteCreate(Grid windowSize)
+{
+    int numElement = windowSize.nrow * windowSize.ncol;
+    DStarLite* planner = (DStarLite*) malloc(sizeof(DStarLite));
+
+    planner->windowSize = windowSize;
+    planner->targetIdx = -1;
+    planner->sourceIdx = -1;
+    planner->km.straight = 0;
+    planner->km.diagonal = 0;
+    planner->g = (OctileCost*) malloc(numElement * sizeof(OctileCost));
+    planner->rhs = (OctileCost*) malloc(numElement * sizeof(OctileCost));
+    openListInit(&planner->open, OPENLIST_HEAP, numElement);
+    return planner;
+}
+
+/*
+ * `labels[idx]` was just toggled between BLOCKED and UNBLOCKED: the moves
+ * from and to `idx` appeared or disappeared, so the rhs of the cell and of
+ * its neighbours are computed again. The repair itself waits for the next
+ * dstarLiteSearch().
+ */
+void dstarLiteToggleCell(DStarLite* planner, const BlockLabels* labels, int idx)
+{
+    SearchStats stats = {0, 0, 0};
+    DStarRun run = {planner, NULL, labels, planner->windowSize.ncol, planner->windowSize.nrow, &stats, false};
+    int around[8], i, n;
+
+    if (planner->targetIdx == -1)
+        return;
+
+    n = neighbours(&run, idx, around);
+    for (i = -1; i < n; i++)
+    {
+        int cell = (i == -1) ? idx : around[i];
+        if (cell == planner->targetIdx)
+            continue;
+        planner->rhs[cell] = lookahead(&run, cell);
+        updateVertex(&run, cell);
+    }
+}
+
+void dstarLiteFree(DStarLite* planner)
+{
+    if (planner == NULL)
+        return;
+    openListFree(&planner->open);
+    free(planner->g);
+    free(planner->rhs);
+    free(planner);
+}
+
+/*
+ * D* Lite search of the query. `query->preprocessed` is the DStarLite planner
+ * to continue from, or NULL for a one-shot search with a planner of its own.
+ * The planner is the one piece of preprocessed data a search writes to: it
+ * must not be shared by two searches at once. A new TARGET restarts it from
+ * scratch, a new SOURCE only shifts the keys. The open list is always a heap
+ * ordered by the two-part key, `openList` and `tieBreaking` are not used.
+ */
+SearchStatus dstarLiteSearch(const SearchQuery *query, SearchResult *result)
+{
+    DStarLite* planner = (DStarLite*) query->preprocessed;
+    int sourceIdx = query->sourceIdx, targetIdx = query->targetIdx;
+    int numElement = query->grid.nrow * query->grid.ncol;
+    int around[8], i, n, idx;
+    std::vector<int> path;
+    SearchStatus status = SEARCH_NOT_FOUND;
+    DStarRun run;
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+    if (planner == NULL)
+    {
+        DStarLite* own = dstarLiteCreate(query->grid);
+        SearchQuery oneShot = *query;
+        oneShot.preprocessed = own;
+        status = dstarLiteSearch(&oneShot, result);
+        dstarLiteFree(own);
+        return status;
+    }
+    if (planner->windowSize.nrow != query->grid.nrow || planner->windowSize.ncol != query->grid.ncol)
+        return SEARCH_INVALID;
+
+    run.planner = planner;
+    run.query = query;
+    run.labels = query->labels;
+    run.ncol = query->grid.ncol;
+    run.nrow = query->grid.nrow;
+    run.stats = &result->stats;
+    run.aborted = false;
+
+    if (planner->targetIdx != targetIdx)
+        resetPlanner(&run, targetIdx, sourceIdx);
+    else if (planner->sourceIdx != sourceIdx)
+    {
+        planner->km = addCost(planner->km, octileDistance(planner->sourceIdx, sourceIdx, run.ncol));
+        planner->sourceIdx = sourceIdx;
+    }
+
+    computeShortestPath(&run);
+    if (run.aborted)
+        return SEARCH_ABORTED;
+    if (isInfinite(planner->rhs[sourceIdx]))
+        return SEARCH_NOT_FOUND;
+
+    /* Walk down the distances to TARGET */
+    idx = sourceIdx;
+    path.push_back(idx);
+    while (idx != targetIdx && (int) path.size() <= numElement)
+    {
+        int next = -1;
+        OctileCost best = INFINITE_COST;
+
+        n = neighbours(&run, idx, around);
+        for (i = 0; i < n; i++)
+        {
+            OctileCost through = addCost(moveCost(&run, idx, around[i]), planner->g[around[i]]);
+            if (!costLess(through, best))
+                continue;
+            best = through;
+            next = around[i];
+        }
+        if (next == -1)
+            return SEARCH_NOT_FOUND;
+        idx = next;
+        path.push_back(idx);
+    }
+    if (idx != targetIdx)
+        return SEARCH_NOT_FOUND;
+
+    result->path = (int*) malloc(path.size() * sizeof(int));
+    for (i = 0; i < (int) path.size(); i++)
+        result->path[i] = path[i];
+    result->pathLen = (int) path.size();
+    result->cost = octileValue(planner->rhs[sourceIdx]);
+    return SEARCH_FOUND;
+}
@@ -0,0 +1,34 @@
+/*
+ * D* Lite (Koenig & Likhachev, 2002): an incremental search from TARGET back
+ * to SOURCE. Its DStarLite planner keeps g and rhs of every cell from one run
+ * to the next; when cells are toggled, or SOURCE moves, the next run only
+ * repairs the part of the search tree whose distances changed.
+ */
+#pragma once
+
+#include "astar.hpp"
+#include "openlist.hpp"
+
+/*
+ * g is the distance from a cell to TARGET as of the last expansion of the
+ * cell, rhs its one-step lookahead min(cost + g) over the neighbours. Cells
+ * with g != rhs (inconsistent) wait in `open`, keyed by
+ * (min(g, rhs) + h(SOURCE, cell) + km, min(g, rhs)). The distances are kept
+ * as exact OctileCost: the search stops on a comparison of keys, and a key
+ * summed in another order than the key of SOURCE must still compare equal.
+ */
+typedef struct DStarLite
+{
+    Grid         windowSize;
+    int          targetIdx;     /* root of the search, -1 until the first run      */
+    int          sourceIdx;     /* SOURCE the keys of `open` were computed for     */
+    OctileCost   km;            /* sum of h between the successive SOURCEs         */
+    OctileCost  *g;             /* {INT_MAX, INT_MAX} for an infinite distance     */
+    OctileCost  *rhs;
+    OpenList     open;          /* always an OPENLIST_HEAP, whatever the query says */
+} DStarLite;
+
+DStarLite* dstarLiteCreate(Grid windowSize);
+void dstarLiteToggleCell(DStarLite* planner, const BlockLabels* labels, int idx);
+void dstarLiteFree(DStarLite* planner);
+SearchStatus dstarLiteSearch(const SearchQuery *query, SearchResult *result);
@@ -0,0 +1,112 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "astar.hpp"
+#include "cpd.hpp"
+#include "goalbound.hpp"
+
+
+typedef struct GoalBoundWorker
+{
+    const BlockLabels  *labels;
+    GoalBoundTable     *table;
+    int                 first;      /* sources first, first + step, ... */
+    int                 step;
+} GoalBoundWorker;
+
+/*
+ * A target goes into the box of every optimal first move, not just one of
+ * them: whichever shortest path the search follows, its next move keeps
+ * TARGET in its box. Each worker only writes the boxes of its own sources.
+ */
+static void* goalBoundWorker(void* arg)
+{
+    GoalBoundWorker* worker = (GoalBoundWorker*) arg;
+    GoalBoundTable* table = worker->table;
+    Grid windowSize = table->windowSize;
+    int numElement = windowSize.nrow * windowSize.ncol, ncol = windowSize.ncol;
+    std::vector<OctileCost> steps(numElement);
+    std::vector<uint16_t> moves(numElement);
+    int source, idx, k;
+
+    for (source = worker->first; source < numElement; source += worker->step)
+    {
+        uint16_t* boxes = table->boxes + (size_t) source * 32;
+
+        if (worker->labels[source] == LBL_BLOCKED)
+            continue;
+        cpdFirstMoveSets(worker->labels, windowSize, source, steps.data(), moves.data());
+        for (idx = 0; idx < numElement; idx++)
+        {
+            uint16_t x = idx % ncol, y = idx / ncol;
+
+            if (idx == source || (moves[idx] & (1 << CPD_NO_MOVE)))
+                continue;
+            for (k = 0; k < 8; k++)
+            {
+                uint16_t* box = boxes + k * 4;
+                if (!(moves[idx] & (1 << k)))
+                    continue;
+                box[0] = MIN2(box[0], x);
+                box[1] = MIN2(box[1], y);
+                box[2] = MAX2(box[2], x);
+                box[3] = MAX2(box[3], y);
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * One Dijkstra per free cell, so the build grows with the square of the map
+ * size; the sources are shared out among numThreads workers. Grids are at
+ * most 65536 cells per side.
+ */
+GoalBoundTable* goalBoundBuild(const BlockLabels* labels, Grid windowSize, int numThreads)
+{
+    int numElement = windowSize.nrow * windowSize.ncol, numStarted, w, i;
+    GoalBoundTable* table = (GoalBoundTable*) malloc(sizeof(GoalBoundTable));
+    std::vector<GoalBoundWorker> workers;
+    std::vector<pthread_t> threads;
+
+    table->windowSize = windowSize;
+    table->boxes = (uint16_t*) malloc(MAX2((size_t) numElement * 32, (size_t) 1) * sizeof(uint16_t));
+    for (i = 0; i < numElement * 8; i++)
+    {
+        table->boxes[i * 4] = UINT16_MAX;
+        table->boxes[i * 4 + 1] = UINT16_MAX;
+        table->boxes[i * 4 + 2] = 0;
+        table->boxes[i * 4 + 3] = 0;
+    }
+
+    numThreads = MAX2(numThreads, 1);
+    workers.resize(numThreads);
+    threads.resize(numThreads);
+    for (w = 0; w < numThreads; w++)
+    {
+        workers[w].labels = labels;
+        workers[w].table = table;
+        workers[w].first = w;
+        workers[w].step = numThreads;
+    }
+
+    /* Worker 0, and any worker whose thread could not start, run on this thread */
+    for (numStarted = 1; numStarted < numThreads; numStarted++)
+        if (pthread_create(&threads[numStarted], NULL, goalBoundWorker, &workers[numStarted]) != 0)
+            break;
+    goalBoundWorker(&workers[0]);
+    for (w = numStarted; w < numThreads; w++)
+        goalBoundWorker(&workers[w]);
+    for (w = 1; w < numStarted; w++)
+        pthread_join(threads[w], NULL);
+    return table;
+}
+
+void goalBoundFree(GoalBoundTable* table)
+{
+    if (table == NULL)
+        return;
+    free(table->boxes);
+    free(table);
+}
@@ -0,0 +1,36 @@
+/*
+ * Goal bounding (Rabin & Sturtevant, 2016): for every free cell and each of
+ * its 8 moves, the bounding box of the targets that a shortest path from the
+ * cell reaches through that move. Computed once per map with one Dijkstra per
+ * cell. A search then skips any move whose box does not contain TARGET: no
+ * shortest path to TARGET starts with it, so the result stays optimal.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "astar.hpp"
+
+/*
+ * Moves are numbered as the directions of cpd.hpp. Box k of a cell is
+ * boxes[(idx * 8 + k) * 4 ...] = minX, minY, maxX, maxY; an empty box has
+ * minX > maxX.
+ */
+struct GoalBoundTable
+{
+    Grid         windowSize;
+    uint16_t    *boxes;         /* 8 boxes per cell, 4 entries each */
+};
+
+GoalBoundTable* goalBoundBuild(const BlockLabels* labels, Grid windowSize, int numThreads);
+void goalBoundFree(GoalBoundTable* table);
+
+/* Whether the move (dx, dy) from `idx` may start a shortest path to `targetIdx`; (dx, dy) != (0, 0) */
+static inline bool goalBoundAllows(const GoalBoundTable* table, int idx, int dx, int dy, int targetIdx)
+{
+    static const int direction[9] = {5, 6, 7, 4, -1, 0, 3, 2, 1};
+    const uint16_t* box = table->boxes + ((size_t) idx * 8 + direction[(dy + 1) * 3 + (dx + 1)]) * 4;
+    int x = targetIdx % table->windowSize.ncol, y = targetIdx / table->windowSize.ncol;
+
+    return x >= box[0] && y >= box[1] && x <= box[2] && y <= box[3];
+}
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+
+#include "astar.hpp"
+
+
+/*
+ * Fill `labels` (nrow*ncol, allocated by the caller) with a random grid where
+ * roughly `blockedRatio` of the cells are BLOCKED, and pick two unique
+ * unblocked cells as SOURCE and TARGET. The same seed always gives the same grid.
+ */
+void randomGrid(BlockLabels* labels, Grid windowSize, float blockedRatio, unsigned int seed,
+                int* sourceIdx, int* targetIdx)
+{
+    int idx, numElement;
+    std::mt19937 rng(seed);
+
+    numElement = windowSize.nrow * windowSize.ncol;
+
+    /* Random two unique numbers between 0 and numElement to be source and target: */
+    *sourceIdx = rng() % numElement;
+    *targetIdx = *sourceIdx;
+    while (numElement > 1 && *targetIdx == *sourceIdx)
+        *targetIdx = rng() % numElement;
+
+    for (idx = 0; idx < numElement; idx++)
+    {
+        /* Random a number to be BLOCKED (blockedRatio) or UNBLOCKED (1-blockedRatio - the rest) */
+        int ranNum = rng() % 1000;
+        if (ranNum < 1000 * blockedRatio)
+            labels[idx] = LBL_BLOCKED;
+        else
+            labels[idx] = LBL_UNBLOCKED;
+    }
+
+    labels[*sourceIdx] = LBL_UNBLOCKED;
+    labels[*targetIdx] = LBL_UNBLOCKED;
+}
+
+/* Moving AI terrain: '.', 'G' and 'S' are passable, everything else is BLOCKED */
+static BlockLabels charToLabel(char c)
+{
+    return (c == '.' || c == 'G' || c == 'S') ? LBL_UNBLOCKED : LBL_BLOCKED;
+}
+
+/*
+ * Load a grid from a text file. Two layouts are accepted:
+ *  - the Moving AI benchmark format ("type octile", "height H", "width W",
+ *    "map", then H rows of W characters);
+ *  - bare rows of characters, all of the same length.
+ * On success `*labels` is malloc'd (the caller frees it) and 0 is returned.
+ */
+int loadGridFile(const char* path, BlockLabels** labels, Grid* windowSize)
+{
+    FILE* file;
+    char line[1 << 16];
+    int nrow = 0, ncol = 0, row = 0, col;
+    bool header = false;
+
+    *labels = NULL;
+    file = fopen(path, "r");
+    if (file == NULL)
+        return -1;
+
+    /* First pass: read the header or measure the bare rows */
+    while (fgets(line, sizeof(line), file))
+    {
+        int len = (int) strcspn(line, "\r\n");
+
+        if (strncmp(line, "type", 4) == 0)
+            header = true;
+        if (header)
+        {
+            if (sscanf(line, "height %d", &nrow) == 1 || sscanf(line, "width %d", &ncol) == 1)
+                continue;
+            if (strncmp(line, "map", 3) == 0)
+                break;
+            continue;
+        }
+        if (len == 0)
+            continue;
+        if (ncol == 0)
+            ncol = len;
+        if (len != ncol)
+        {
+            fclose(file);
+            return -1;
+        }
+        nrow++;
+    }
+
+    if (nrow <= 0 || ncol <= 0)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    *labels = (BlockLabels*) malloc(nrow * ncol * sizeof(BlockLabels));
+    if (!header)
+        rewind(file);
+
+    /* Second pass: the rows themselves */
+    while (row < nrow && fgets(line, sizeof(line), file))
+    {
+        int len = (int) strcspn(line, "\r\n");
+
+        if (len == 0)
+            continue;
+        for (col = 0; col < ncol; col++)
+            (*labels)[row * ncol + col] = (col < len) ? charToLabel(line[col]) : LBL_BLOCKED;
+        row++;
+    }
+    fclose(file);
+
+    if (row != nrow)
+    {
+        free(*labels);
+        *labels = NULL;
+        return -1;
+    }
+
+    windowSize->nrow = nrow;
+    windowSize->ncol = ncol;
+    return 0;
+}
@@ -0,0 +1,437 @@
+#include <float.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <random>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "hda.hpp"
+
+
+/*
+ * Each worker owns the cells that hash to it: their Cell in the shared
+ * `listCell` array is only ever read or written by that worker, so the
+ * array needs no synchronization. Workers expand out of order, so a cell
+ * reached again with a smaller g is simply queued again (re-opened).
+ *
+ * A successor owned by another worker is sent to it through the queue of
+ * that (sender, receiver) pair: a single-producer single-consumer list of
+ * chunks, lock-free and unbounded.
+ *
+ * TARGET's owner publishes the best cost found so far (`incumbent`); cells
+ * whose f is not below it are never queued nor expanded. The search is over
+ * when no worker has a cell to expand and no message is in flight. `work`
+ * counts exactly that: a worker adds one while it is active and one for
+ * every message it sends, and removes them when it goes idle or has handled
+ * the message. Only active workers send, so once `work` reaches 0 nothing
+ * can wake up any more, and every cell that could have led to a cheaper
+ * path than the incumbent was expanded: the incumbent is optimal.
+ */
+
+typedef struct HdaMessage
+{
+    int          idx;
+    int          prev;
+    OctileCost   steps;
+} HdaMessage;
+
+typedef struct MessageChunk
+{
+    HdaMessage                  items[HDA_CHUNK];
+    std::atomic<int>            count;  /* items written by the producer so far */
+    std::atomic<MessageChunk*>  next;   /* set once the chunk is full           */
+} MessageChunk;
+
+/* The consumer and producer ends sit on different cache lines */
+typedef struct MessageQueue
+{
+    MessageChunk *head;                 /* consumer: chunk being read   */
+    int           readPos;              /* consumer: next item to read  */
+    char          padding[64];
+    MessageChunk *tail;                 /* producer: chunk being filled */
+    char          padding2[64];
+} MessageQueue;
+
+typedef struct HdaWorker
+{
+    struct HdaSearch   *search;
+    int                 id;
+    OpenList            openList;       /* over the local indices of the owned cells */
+    int                *globalIdx;      /* local index -> cell index                  */
+    bool                active;
+    SearchStats         stats;
+    char                padding[64];
+} HdaWorker;
+
+typedef struct HdaSearch
+{
+    const SearchQuery  *query;
+    int                 numWorkers;
+    Cell               *listCell;
+    int                *localIdx;       /* cell index -> index among its owner's cells */
+    unsigned int       *zobristX;       /* random key of each column of blocks         */
+    unsigned int       *zobristY;       /* random key of each row of blocks            */
+    MessageQueue       *queues;         /* queue from worker i to worker j at j*n+i    */
+    HdaWorker          *workers;
+    std::atomic<long>   work;
+    std::atomic<float>  incumbent;      /* g of TARGET, FLT_MAX until it is reached    */
+    std::atomic<bool>   stop;           /* aborted by the observer                     */
+} HdaSearch;
+
+static MessageChunk* newChunk()
+{
+    MessageChunk* chunk = new MessageChunk;
+    chunk->count = 0;
+    chunk->next = NULL;
+    return chunk;
+}
+
+static void sendMessage(MessageQueue* queue, const HdaMessage* message)
+{
+    MessageChunk* tail = queue->tail;
+    int count = tail->count.load(std::memory_order_relaxed);
+
+    if (count == HDA_CHUNK)
+    {
+        MessageChunk* chunk = newChunk();
+        tail->next.store(chunk, std::memory_order_release);
+        queue->tail = tail = chunk;
+        count = 0;
+    }
+    tail->items[count] = *message;
+    tail->count.store(count + 1, std::memory_order_release);
+}
+
+static bool receiveMessage(MessageQueue* queue, HdaMessage* message)
+{
+    MessageChunk* head = queue->head;
+
+    if (queue->readPos == HDA_CHUNK)
+    {
+        /* The producer never touches a chunk again once `next` is set */
+        MessageChunk* next = head->next.load(std::memory_order_acquire);
+        if (next == NULL)
+            return false;
+        delete head;
+        queue->head = head = next;
+        queue->readPos = 0;
+    }
+    if (queue->readPos >= head->count.load(std::memory_order_acquire))
+        return false;
+    *message = head->items[queue->readPos++];
+    return true;
+}
+
+static inline int ownerOf(const HdaSearch* search, int idx)
+{
+    int ncol = search->query->grid.ncol;
+    unsigned int key = search->zobristX[(idx % ncol) / HDA_BLOCK] ^
+                       search->zobristY[(idx / ncol) / HDA_BLOCK];
+    return (int) (key % (unsigned int) search->numWorkers);
+}
+
+/* A cell owned by `worker` is reached with `steps` from `prev`: keep it if it is better */
+static bool relaxOwned(HdaWorker* worker, int idx, int prev, OctileCost steps)
+{
+    HdaSearch* search = worker->search;
+    const SearchQuery* query = search->query;
+    Cell* cell = &search->listCell[idx];
+    OctileCost total;
+    float g = octileValue(steps);
+
+    if (cell->g <= g)
+        return true;
+
+    cell->g = g;
+    cell->steps = steps;
+    cell->prev = prev;
+
+    if (idx == query->targetIdx)
+    {
+        search->incumbent = g;
+        return true;
+    }
+
+    total = octileDistance(idx, query->targetIdx, query->grid.ncol);
+    cell->h = octileValue(total);
+    total.straight += steps.straight;
+    total.diagonal += steps.diagonal;
+    cell->f = octileValue(total);
+    if (cell->f >= search->incumbent)
+        return true;
+
+    openListPush(&worker->openList, search->localIdx[idx], cell->f,
+                 tieBreakValue(query->tieBreaking, cell->g, cell->h));
+    worker->stats.generated++;
+    worker->stats.maxOpenSize = MAX2(worker->stats.maxOpenSize, (long) worker->openList.size);
+
+    return !NOTIFY_OBSERVER(query, idx, LBL_TOBEVISITED);
+}
+
+/* Expand the best cell of `worker`. Returns false if the observer aborts. */
+static bool expandOne(HdaWorker* worker)
+{
+    HdaSearch* search = worker->search;
+    const SearchQuery* query = search->query;
+    Grid windowSize = query->grid;
+    int padx, pady, mainX, mainY;
+    int mainCellIdx = worker->globalIdx[openListPop(&worker->openList)];
+    OctileCost mainSteps = search->listCell[mainCellIdx].steps;
+
+    if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITING))
+        return false;
+    worker->stats.expanded++;
+
+    mainX = mainCellIdx % windowSize.ncol;
+    mainY = mainCellIdx / windowSize.ncol;
+
+    for (pady = -1; pady <= 1; pady++)
+    {
+        for (padx = -1; padx <= 1; padx++)
+        {
+            HdaMessage message;
+            OctileCost total;
+            int owner, successorIdx;
+
+            if (mainX + padx < 0 || mainX + padx >= windowSize.ncol ||
+                mainY + pady < 0 || mainY + pady >= windowSize.nrow)
+                continue;
+
+            successorIdx = mainCellIdx + padx + pady * windowSize.ncol;
+            if (query->labels[successorIdx] == LBL_BLOCKED || successorIdx == query->sourceIdx)
+                continue;
+
+            message.idx = successorIdx;
+            message.prev = mainCellIdx;
+            message.steps = mainSteps;
+            if (padx != 0 && pady != 0)
+                message.steps.diagonal++;
+            else
+                message.steps.straight++;
+
+            /* Not worth a message if it cannot beat the incumbent */
+            total = octileDistance(successorIdx, query->targetIdx, windowSize.ncol);
+            total.straight += message.steps.straight;
+            total.diagonal += message.steps.diagonal;
+            if (octileValue(total) >= search->incumbent)
+                continue;
+
+            owner = ownerOf(search, successorIdx);
+            if (owner == worker->id)
+            {
+                if (!relaxOwned(worker, successorIdx, mainCellIdx, message.steps))
+                    return false;
+                continue;
+            }
+            search->work++;
+            sendMessage(&search->queues[owner * search->numWorkers + worker->id], &message);
+        }
+    }
+
+    return !NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITED);
+}
+
+static void* hdaWorker(void* arg)
+{
+    HdaWorker* worker = (HdaWorker*) arg;
+    HdaSearch* search = worker->search;
+    int from;
+
+    while (!search->stop)
+    {
+        HdaMessage message;
+
+        for (from = 0; from < search->numWorkers; from++)
+        {
+            MessageQueue* queue = &search->queues[worker->id * search->numWorkers + from];
+            while (receiveMessage(queue, &message))
+            {
+                if (!worker->active)
+                {
+                    /* Count ourselves before the message is uncounted, `work` stays > 0 */
+                    worker->active = true;
+                    search->work++;
+                }
+                if (!relaxOwned(worker, message.idx, message.prev, message.steps))
+                    search->stop = true;
+                search->work--;
+            }
+        }
+
+        if (worker->openList.size > 0 &&
+            openListTopKey(&worker->openList) < search->incumbent)
+        {
+            if (!expandOne(worker))
+                search->stop = true;
+            continue;
+        }
+
+        if (worker->active)
+        {
+            worker->active = false;
+            search->work--;
+        }
+        if (search->work == 0)
+            break;
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+static void initHdaSearch(HdaSearch* search, const SearchQuery* query, int numWorkers)
+{
+    Grid windowSize = query->grid;
+    int i, w, x, y, numElement = windowSize.nrow * windowSize.ncol;
+    int* numOwned;
+    std::mt19937 rng(12345);
+
+    search->query = query;
+    search->numWorkers = numWorkers;
+    search->listCell = initListCell(&windowSize, query->sourceIdx);
+    search->localIdx = (int*) malloc(numElement * sizeof(int));
+    search->zobristX = (unsigned int*) malloc((windowSize.ncol / HDA_BLOCK + 1) * sizeof(unsigned int));
+    search->zobristY = (unsigned int*) malloc((windowSize.nrow / HDA_BLOCK + 1) * sizeof(unsigned int));
+    search->queues = (MessageQueue*) calloc(numWorkers * numWorkers, sizeof(MessageQueue));
+    search->workers = (HdaWorker*) calloc(numWorkers, sizeof(HdaWorker));
+    search->work = numWorkers;
+    search->incumbent = (query->sourceIdx == query->targetIdx) ? 0.0f : FLT_MAX;
+    search->stop = false;
+
+    for (i = 0; i <= windowSize.ncol / HDA_BLOCK; i++)
+        search->zobristX[i] = rng();
+    for (i = 0; i <= windowSize.nrow / HDA_BLOCK; i++)
+        search->zobristY[i] = rng();
+    for (i = 0; i < numWorkers * numWorkers; i++)
+        search->queues[i].head = search->queues[i].tail = newChunk();
+
+    /* Number the cells of each worker, so that its open list only spans those */
+    numOwned = (int*) calloc(numWorkers, sizeof(int));
+    for (y = 0, i = 0; y < windowSize.nrow; y++)
+        for (x = 0; x < windowSize.ncol; x++, i++)
+            search->localIdx[i] = numOwned[(search->zobristX[x / HDA_BLOCK] ^
+                                            search->zobristY[y / HDA_BLOCK]) % numWorkers]++;
+
+    for (w = 0; w < numWorkers; w++)
+    {
+        HdaWorker* worker = &search->workers[w];
+        worker->search = search;
+        worker->id = w;
+        worker->active = true;
+        worker->globalIdx = (int*) malloc(MAX2(numOwned[w], 1) * sizeof(int));
+        openListInit(&worker->openList, query->openList, numOwned[w]);
+    }
+    for (y = 0, i = 0; y < windowSize.nrow; y++)
+        for (x = 0; x < windowSize.ncol; x++, i++)
+            search->workers[(search->zobristX[x / HDA_BLOCK] ^ search->zobristY[y / HDA_BLOCK]) %
+                            numWorkers].globalIdx[search->localIdx[i]] = i;
+    free(numOwned);
+}
+
+static void freeHdaSearch(HdaSearch* search)
+{
+    int i, w;
+
+    for (i = 0; i < search->numWorkers * search->numWorkers; i++)
+    {
+        MessageChunk* chunk = search->queues[i].head;
+        while (chunk != NULL)
+        {
+            MessageChunk* next = chunk->next;
+            delete chunk;
+            chunk = next;
+        }
+    }
+    for (w = 0; w < search->numWorkers; w++)
+    {
+        openListFree(&search->workers[w].openList);
+        free(search->workers[w].globalIdx);
+    }
+    free(search->workers);
+    free(search->queues);
+    free(search->zobristY);
+    free(search->zobristX);
+    free(search->localIdx);
+    free(search->listCell);
+}
+
+/*
+ * HDA* on query->numThreads workers: worker 0 runs in the calling thread,
+ * the others on threads of their own. If a thread cannot be started the
+ * search falls back to astarSearch().
+ *
+ * There are never more workers than online cores: a worker that gets a whole
+ * time slice to itself runs far ahead of the others through its own blocks,
+ * and everything it expands on the way is re-opened later (on one core, two
+ * workers expanded 16 times the cells of A*).
+ */
+SearchStatus hdaSearch(const SearchQuery *query, SearchResult *result)
+{
+    HdaSearch search;
+    pthread_t* threads;
+    SearchStatus status = SEARCH_NOT_FOUND;
+    int w, numStarted, numWorkers = MAX2(query->numThreads, 1);
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    bool aborted;
+
+    if (numCores > 0)
+        numWorkers = MIN2(numWorkers, (int) numCores);
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+
+    initHdaSearch(&search, query, numWorkers);
+    threads = (pthread_t*) malloc(numWorkers * sizeof(pthread_t));
+
+    /* SOURCE goes to its owner's open list before anybody starts */
+    {
+        HdaWorker* owner = &search.workers[ownerOf(&search, query->sourceIdx)];
+        Cell* source = &search.listCell[query->sourceIdx];
+
+        source->h = octileValue(octileDistance(query->sourceIdx, query->targetIdx, query->grid.ncol));
+        source->f = source->h;
+        if (query->sourceIdx != query->targetIdx)
+            openListPush(&owner->openList, search.localIdx[query->sourceIdx], source->f, 0.0f);
+    }
+
+    for (numStarted = 1; numStarted < numWorkers; numStarted++)
+        if (pthread_create(&threads[numStarted], NULL, hdaWorker, &search.workers[numStarted]) != 0)
+            break;
+    if (numStarted < numWorkers)
+        search.stop = true;
+    else
+        hdaWorker(&search.workers[0]);
+    for (w = 1; w < numStarted; w++)
+        pthread_join(threads[w], NULL);
+    free(threads);
+
+    if (numStarted < numWorkers)
+    {
+        freeHdaSearch(&search);
+        return astarSearch(query, result);
+    }
+
+    aborted = search.stop;
+    if (aborted)
+        status = SEARCH_ABORTED;
+    else if (search.incumbent < FLT_MAX)
+    {
+        storePath(search.listCell, query->targetIdx, result);
+        status = SEARCH_FOUND;
+    }
+
+    for (w = 0; w < numWorkers; w++)
+    {
+        result->stats.expanded    += search.workers[w].stats.expanded;
+        result->stats.generated   += search.workers[w].stats.generated;
+        result->stats.maxOpenSize += search.workers[w].stats.maxOpenSize;
+    }
+    freeHdaSearch(&search);
+
+    return status;
+}
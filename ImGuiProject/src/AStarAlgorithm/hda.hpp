@@ -0,0 +1,21 @@
+/*
+ * Hash Distributed A* (Kishimoto, Fukunaga & Botea, 2009): every cell is
+ * owned by one of query->numThreads workers, chosen by hashing it; a worker
+ * expands only the cells it owns and mails the successors it does not own
+ * to their owner.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+/*
+ * Cells are hashed by square blocks of HDA_BLOCK x HDA_BLOCK (abstract
+ * Zobrist hashing): most successors then stay with the worker that generated
+ * them, while the blocks still spread any frontier over all workers.
+ */
+#define HDA_BLOCK               4
+
+/* Messages of a worker to another one are queued in chunks of this size */
+#define HDA_CHUNK               256
+
+SearchStatus hdaSearch(const SearchQuery *query, SearchResult *result);
@@ -0,0 +1,873 @@
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include "astar.hpp"
+#include "headless.hpp"
+#include "jps.hpp"
+#include "deltastep.hpp"
+#include "bitbfs.hpp"
+#include "hpa.hpp"
+#include "blockastar.hpp"
+#include "dstarlite.hpp"
+#include "arastar.hpp"
+#include "rtaa.hpp"
+#include "subgoal.hpp"
+#include "cpd.hpp"
+#include "rsr.hpp"
+#include "goalbound.hpp"
+#include "swamp.hpp"
+#include "alt.hpp"
+
+
+typedef struct HeadlessOptions
+{
+    const char  *mapPath;       /* NULL: generate a grid with randomGrid() */
+    Grid         windowSize;
+    float        blockedRatio;
+    unsigned int seed;
+    int          sourceIdx;     /* -1: taken from the random grid / random pair */
+    int          targetIdx;
+    int          numQueries;
+    SearchAlgorithm algorithm;
+    OpenListKind openList;
+    TieBreaking  tieBreaking;
+    HeuristicKind heuristic;
+    int          numLandmarks;  /* HEURISTIC_ALT */
+    LandmarkSelection selection;
+    int          numThreads;
+    int          clusterSize;   /* HPA* clusters, cells per side */
+    int          numReplans;    /* obstacle changes per pair replanned by D* Lite, 0: none */
+    float        weight;        /* ARA*: first inflation of the heuristic */
+    long         timeBudget;    /* ARA*: microseconds per query to improve the path, 0: none */
+    int          lookahead;     /* RTAA*: expansions per decision */
+    int          numTrials;     /* RTAA*: walks of each pair, learning from the previous ones */
+    const char  *cpdPath;       /* CPD: database file, loaded if it matches the grid, else written */
+    bool         bench;         /* compare the open lists on the same queries */
+    bool         field;         /* one-to-all distances from each SOURCE instead */
+    bool         bfs;           /* unit-cost layers of each pair with the bit-parallel BFS */
+    bool         goalBounds;    /* A* / JPS / JPS+: prune with a goal bounding table, compared without */
+    bool         swamps;        /* A*: skip the dead-end regions, compared without */
+} HeadlessOptions;
+
+static void printUsage(const char* prog)
+{
+    printf("Usage: %s --headless [options]\n"
+           "  --map FILE        load the grid from FILE (Moving AI .map or bare rows of '.'/'@')\n"
+           "  --rows N          number of rows of the random grid (default 1000)\n"
+           "  --cols N          number of columns of the random grid (default 1000)\n"
+           "  --ratio R         blocked ratio of the random grid, in [0, 1] (default 0.3)\n"
+           "  --seed S          seed of the random grid and of the queries (default 1)\n"
+           "  --source IDX      index (x + y * ncol) of SOURCE\n"
+           "  --target IDX      index (x + y * ncol) of TARGET\n"
+           "  --queries N       number of random SOURCE/TARGET pairs to search (default 1)\n"
+           "  --algo NAME       search engine: astar (default), jps, jps-plus, bidir, hda, mq, delta,\n"
+           "                    hpa, block, dstar, ara, rtaa, theta, subgoal, cpd or rsr\n"
+           "  --open KIND       open list: heap (default), set or bucket\n"
+           "  --tie RULE        tie-breaking among equal f: high-g (default), low-h or lifo\n"
+           "  --heuristic H     A* heuristic: octile (default) or alt (landmarks, compared with octile)\n"
+           "  --landmarks N     number of ALT landmarks (default 8)\n"
+           "  --select RULE     ALT landmark selection: farthest (default) or avoid\n"
+           "  --threads N       worker threads of the parallel engines (default 1)\n"
+           "  --cluster N       side of the HPA* clusters, in cells (default 16)\n"
+           "  --weight W        first heuristic weight of ARA* (default 3)\n"
+           "  --budget MS       time ARA* may spend improving each path (default: until optimal)\n"
+           "  --lookahead K     expansions per RTAA* decision (default 64)\n"
+           "  --trials N        walks of each pair by the RTAA* agent, which learns from each (default 1)\n"
+           "  --cpd FILE        CPD database of the map: loaded if it was built for it, else built\n"
+           "                    (on --threads workers) and saved there\n"
+           "  --replans N       walk each path, blocking a cell ahead after every move, N times;\n"
+           "                    D* Lite repairs its plan, A* searches again from scratch\n"
+           "  --bench           search the same queries with every open list and compare\n"
+           "  --field           compute the distance field of each SOURCE (delta-stepping)\n"
+           "  --bfs             bit-parallel BFS of each pair: reachability, 4- and 8-connected moves,\n"
+           "                    then all pairs at once as a multi-source BFS\n"
+           "  --goal-bounds     prune the moves of astar, jps and jps-plus with goal bounding boxes\n"
+           "                    (built on --threads workers), compared with the same search without\n"
+           "  --swamps          astar skips the dead-end regions that hold neither SOURCE nor TARGET,\n"
+           "                    compared with the same search without\n",
+           prog);
+}
+
+bool isHeadlessRun(int argc, char** argv)
+{
+    int i;
+
+    for (i = 1; i < argc; i++)
+        if (strcmp(argv[i], "--headless") == 0)
+            return true;
+    return false;
+}
+
+static int parseOptions(int argc, char** argv, HeadlessOptions* opt)
+{
+    int i;
+
+    opt->mapPath            = NULL;
+    opt->windowSize.nrow    = 1000;
+    opt->windowSize.ncol    = 1000;
+    opt->blockedRatio       = 0.3f;
+    opt->seed               = 1;
+    opt->sourceIdx          = -1;
+    opt->targetIdx          = -1;
+    opt->numQueries         = 1;
+    opt->algorithm          = ALGO_ASTAR;
+    opt->openList           = OPENLIST_HEAP;
+    opt->tieBreaking        = TIE_HIGH_G;
+    opt->heuristic          = HEURISTIC_OCTILE;
+    opt->numLandmarks       = ALT_NUM_LANDMARKS;
+    opt->selection          = LANDMARK_FARTHEST;
+    opt->numThreads         = 1;
+    opt->clusterSize        = HPA_CLUSTER_SIZE;
+    opt->numReplans         = 0;
+    opt->weight             = ARA_INITIAL_WEIGHT;
+    opt->timeBudget         = 0;
+    opt->lookahead          = RTAA_LOOKAHEAD;
+    opt->numTrials          = 1;
+    opt->cpdPath            = NULL;
+    opt->bench              = false;
+    opt->field              = false;
+    opt->bfs                = false;
+    opt->goalBounds         = false;
+    opt->swamps             = false;
+
+    for (i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--headless") == 0)
+            continue;
+        if (strcmp(arg, "--bench") == 0)
+        {
+            opt->bench = true;
+            continue;
+        }
+        if (strcmp(arg, "--field") == 0)
+        {
+            opt->field = true;
+            continue;
+        }
+        if (strcmp(arg, "--bfs") == 0)
+        {
+            opt->bfs = true;
+            continue;
+        }
+        if (strcmp(arg, "--goal-bounds") == 0)
+        {
+            opt->goalBounds = true;
+            continue;
+        }
+        if (strcmp(arg, "--swamps") == 0)
+        {
+            opt->swamps = true;
+            continue;
+        }
+        if (value == NULL)
+            return -1;
+
+        if (strcmp(arg, "--map") == 0)
+            opt->mapPath = value;
+        else if (strcmp(arg, "--rows") == 0)
+            opt->windowSize.nrow = atoi(value);
+        else if (strcmp(arg, "--cols") == 0)
+            opt->windowSize.ncol = atoi(value);
+        else if (strcmp(arg, "--ratio") == 0)
+            opt->blockedRatio = (float) atof(value);
+        else if (strcmp(arg, "--seed") == 0)
+            opt->seed = (unsigned int) strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--source") == 0)
+            opt->sourceIdx = atoi(value);
+        else if (strcmp(arg, "--target") == 0)
+            opt->targetIdx = atoi(value);
+        else if (strcmp(arg, "--queries") == 0)
+            opt->numQueries = atoi(value);
+        else if (strcmp(arg, "--algo") == 0)
+        {
+            if (strcmp(value, "astar") == 0)
+                opt->algorithm = ALGO_ASTAR;
+            else if (strcmp(value, "jps") == 0)
+                opt->algorithm = ALGO_JPS;
+            else if (strcmp(value, "jps-plus") == 0)
+                opt->algorithm = ALGO_JPS_PLUS;
+            else if (strcmp(value, "bidir") == 0)
+                opt->algorithm = ALGO_BIDIRECTIONAL;
+            else if (strcmp(value, "hda") == 0)
+                opt->algorithm = ALGO_HDA;
+            else if (strcmp(value, "mq") == 0)
+                opt->algorithm = ALGO_MULTIQUEUE;
+            else if (strcmp(value, "delta") == 0)
+                opt->algorithm = ALGO_DELTA_STEPPING;
+            else if (strcmp(value, "hpa") == 0)
+                opt->algorithm = ALGO_HPA;
+            else if (strcmp(value, "block") == 0)
+                opt->algorithm = ALGO_BLOCK_ASTAR;
+            else if (strcmp(value, "dstar") == 0)
+                opt->algorithm = ALGO_DSTAR_LITE;
+            else if (strcmp(value, "ara") == 0)
+                opt->algorithm = ALGO_ARA_STAR;
+            else if (strcmp(value, "rtaa") == 0)
+                opt->algorithm = ALGO_RTAA;
+            else if (strcmp(value, "theta") == 0)
+                opt->algorithm = ALGO_LAZY_THETA;
+            else if (strcmp(value, "subgoal") == 0)
+                opt->algorithm = ALGO_SUBGOAL;
+            else if (strcmp(value, "cpd") == 0)
+                opt->algorithm = ALGO_CPD;
+            else if (strcmp(value, "rsr") == 0)
+                opt->algorithm = ALGO_RSR;
+            else
+                return -1;
+        }
+        else if (strcmp(arg, "--open") == 0)
+        {
+            if (strcmp(value, "heap") == 0)
+                opt->openList = OPENLIST_HEAP;
+            else if (strcmp(value, "set") == 0)
+                opt->openList = OPENLIST_SET;
+            else if (strcmp(value, "bucket") == 0)
+                opt->openList = OPENLIST_BUCKET;
+            else
+                return -1;
+        }
+        else if (strcmp(arg, "--threads") == 0)
+            opt->numThreads = atoi(value);
+        else if (strcmp(arg, "--cluster") == 0)
+            opt->clusterSize = atoi(value);
+        else if (strcmp(arg, "--replans") == 0)
+            opt->numReplans = atoi(value);
+        else if (strcmp(arg, "--weight") == 0)
+            opt->weight = (float) atof(value);
+        else if (strcmp(arg, "--budget") == 0)
+            opt->timeBudget = (long) (atof(value) * 1000.0);
+        else if (strcmp(arg, "--lookahead") == 0)
+            opt->lookahead = atoi(value);
+        else if (strcmp(arg, "--trials") == 0)
+            opt->numTrials = atoi(value);
+        else if (strcmp(arg, "--cpd") == 0)
+            opt->cpdPath = value;
+        else if (strcmp(arg, "--landmarks") == 0)
+            opt->numLandmarks = atoi(value);
+        else if (strcmp(arg, "--heuristic") == 0)
+        {
+            if (strcmp(value, "octile") == 0)
+                opt->heuristic = HEURISTIC_OCTILE;
+            else if (strcmp(value, "alt") == 0)
+                opt->heuristic = HEURISTIC_ALT;
+            else
+                return -1;
+        }
+        else if (strcmp(arg, "--select") == 0)
+        {
+            if (strcmp(value, "farthest") == 0)
+                opt->selection = LANDMARK_FARTHEST;
+            else if (strcmp(value, "avoid") == 0)
+                opt->selection = LANDMARK_AVOID;
+            else
+                return -1;
+        }
+        else if (strcmp(arg, "--tie") == 0)
+        {
+            if (strcmp(value, "high-g") == 0)
+                opt->tieBreaking = TIE_HIGH_G;
+            else if (strcmp(value, "low-h") == 0)
+                opt->tieBreaking = TIE_LOW_H;
+            else if (strcmp(value, "lifo") == 0)
+                opt->tieBreaking = TIE_LIFO;
+            else
+                return -1;
+        }
+        else
+            return -1;
+        i++;
+    }
+
+    if (opt->windowSize.nrow <= 0 || opt->windowSize.ncol <= 0 ||
+        opt->blockedRatio < 0.0f || opt->blockedRatio > 1.0f ||
+        opt->numQueries <= 0 || opt->numLandmarks <= 0 || opt->lookahead <= 0)
+        return -1;
+    return 0;
+}
+
+/* Pick a random UNBLOCKED cell, -1 if the grid has none */
+static int randomFreeCell(const BlockLabels* labels, int numElement, std::mt19937& rng)
+{
+    int tries, idx;
+
+    for (tries = 0; tries < 64; tries++)
+    {
+        idx = rng() % numElement;
+        if (labels[idx] != LBL_BLOCKED)
+            return idx;
+    }
+    for (idx = 0; idx < numElement; idx++)
+        if (labels[idx] != LBL_BLOCKED)
+            return idx;
+    return -1;
+}
+
+static const char* openListName(OpenListKind kind)
+{
+    switch (kind)
+    {
+        case OPENLIST_HEAP:     return "heap";
+        case OPENLIST_BUCKET:   return "bucket";
+        default:                return "set";
+    }
+}
+
+static const char* statusName(SearchStatus status)
+{
+    switch (status)
+    {
+        case SEARCH_FOUND:      return "found";
+        case SEARCH_NOT_FOUND:  return "not found";
+        case SEARCH_ABORTED:    return "aborted";
+        default:                return "invalid";
+    }
+}
+
+typedef struct HeadlessTotals
+{
+    int          numFound;
+    long         expanded;
+    long         generated;
+    long         microSecs;
+} HeadlessTotals;
+
+/* Run every SOURCE/TARGET pair of `pairs` with the settings of `base` */
+static void runQueries(const SearchQuery* base, const int* pairs, int numQueries,
+                       bool verbose, HeadlessTotals* totals)
+{
+    int q;
+
+    memset(totals, 0, sizeof(HeadlessTotals));
+    for (q = 0; q < numQueries; q++)
+    {
+        SearchQuery query = *base;
+        SearchResult result;
+        SearchStatus status;
+        long startTime;
+
+        query.sourceIdx = pairs[2 * q];
+        query.targetIdx = pairs[2 * q + 1];
+
+        startTime = getCurrentMicroSecs();
+        status = findPath(&query, &result);
+        startTime = getCurrentMicroSecs() - startTime;
+
+        if (verbose)
+            printf("query %d: source %d target %d: %s, path length %.3f (%d cells), "
+                   "%ld expansions, %ld generated, %.3f ms\n",
+                   q, query.sourceIdx, query.targetIdx, statusName(status),
+                   result.cost, result.pathLen,
+                   result.stats.expanded, result.stats.generated, startTime / 1000.0);
+        if (verbose && status == SEARCH_FOUND && query.algorithm == ALGO_ARA_STAR)
+            printf("query %d: cost <= %.2f x optimal\n", q, result.suboptimality);
+
+        totals->numFound  += (status == SEARCH_FOUND);
+        totals->expanded  += result.stats.expanded;
+        totals->generated += result.stats.generated;
+        totals->microSecs += startTime;
+        freeSearchResult(&result);
+    }
+}
+
+/*
+ * Microbenchmark of the open lists: the very same queries are searched with
+ * each of them. The set and the heap pop the same cells in the same order;
+ * the bucket queue pops each bucket LIFO and so expands a different number
+ * of cells. Lists are therefore compared on their time per expansion.
+ */
+static void benchOpenLists(const SearchQuery* base, const int* pairs, int numQueries)
+{
+    static const OpenListKind kinds[] = {OPENLIST_SET, OPENLIST_HEAP, OPENLIST_BUCKET};
+    HeadlessTotals totals, reference;
+    SearchQuery query = *base;
+    int k;
+
+    for (k = 0; k < (int) (sizeof(kinds) / sizeof(kinds[0])); k++)
+    {
+        query.openList = kinds[k];
+        runQueries(&query, pairs, numQueries, false, &totals);
+        if (k == 0)
+            reference = totals;
+        printf("open list %-6s: %d/%d found, %ld expansions, %ld generated, %.3f ms, "
+               "%.1f expansions/ms (x%.2f)\n",
+               openListName(kinds[k]), totals.numFound, numQueries,
+               totals.expanded, totals.generated, totals.microSecs / 1000.0,
+               totals.expanded * 1000.0 / MAX2(totals.microSecs, 1L),
+               ((double) reference.microSecs / MAX2(reference.expanded, 1L)) /
+               ((double) MAX2(totals.microSecs, 1L) / MAX2(totals.expanded, 1L)));
+    }
+}
+
+/* One-to-all distances from the SOURCE of every pair */
+static void runDistanceFields(const SearchQuery* base, const int* pairs, int numQueries)
+{
+    int i, q, numElement = base->grid.nrow * base->grid.ncol;
+
+    for (q = 0; q < numQueries; q++)
+    {
+        SearchQuery query = *base;
+        int numReached = 0;
+        float farthest = 0.0f;
+        float* distance;
+        long startTime;
+
+        query.sourceIdx = pairs[2 * q];
+        startTime = getCurrentMicroSecs();
+        distance = distanceField(&query, DELTA_STEPPING_WIDTH);
+        startTime = getCurrentMicroSecs() - startTime;
+        if (distance == NULL)
+        {
+            printf("field %d: source %d: invalid\n", q, query.sourceIdx);
+            continue;
+        }
+
+        for (i = 0; i < numElement; i++)
+        {
+            if (distance[i] == FLT_MAX)
+                continue;
+            numReached++;
+            farthest = MAX2(farthest, distance[i]);
+        }
+        printf("field %d: source %d: %d cells reached, farthest %.3f, %.3f ms\n",
+               q, query.sourceIdx, numReached, farthest, startTime / 1000.0);
+        free(distance);
+    }
+}
+
+/*
+ * Unit-cost distance of every pair, with the grid packed once into a BitGrid;
+ * then the same 8-connected pairs again as one multi-source batch.
+ */
+static void runBitBfs(const SearchQuery* base, const int* pairs, int numQueries)
+{
+    BitGrid* grid;
+    long startTime, singleTime = 0;
+    int *sources, *targets, *single, *batch;
+    int q, numMismatch = 0;
+
+    startTime = getCurrentMicroSecs();
+    grid = bitGridBuild(base->labels, base->grid);
+    printf("bit grid packed in %.3f ms\n", (getCurrentMicroSecs() - startTime) / 1000.0);
+
+    sources = (int*) malloc(numQueries * sizeof(int));
+    targets = (int*) malloc(numQueries * sizeof(int));
+    single  = (int*) malloc(numQueries * sizeof(int));
+    batch   = (int*) malloc(numQueries * sizeof(int));
+
+    for (q = 0; q < numQueries; q++)
+    {
+        int sourceIdx = pairs[2 * q], targetIdx = pairs[2 * q + 1];
+        int manhattan;
+        long reachTime, layerTime;
+
+        sources[q] = sourceIdx;
+        targets[q] = targetIdx;
+        single[q] = -1;
+
+        startTime = getCurrentMicroSecs();
+        if (!bitGridReachable(grid, sourceIdx, targetIdx))
+        {
+            printf("bfs %d: %d -> %d: unreachable, %.3f ms\n", q, sourceIdx, targetIdx,
+                   (getCurrentMicroSecs() - startTime) / 1000.0);
+            continue;
+        }
+        reachTime = getCurrentMicroSecs() - startTime;
+
+        startTime = getCurrentMicroSecs();
+        single[q] = bitGridBfs(grid, sourceIdx, targetIdx, BFS_8_CONNECTED, NULL);
+        layerTime = getCurrentMicroSecs() - startTime;
+        singleTime += layerTime;
+        manhattan = bitGridBfs(grid, sourceIdx, targetIdx, BFS_4_CONNECTED, NULL);
+
+        printf("bfs %d: %d -> %d: reachable in %.3f ms, 4-connected %d, 8-connected %d moves in %.3f ms\n",
+               q, sourceIdx, targetIdx, reachTime / 1000.0, manhattan, single[q], layerTime / 1000.0);
+    }
+
+    startTime = getCurrentMicroSecs();
+    bitGridMultiBfs(grid, sources, targets, numQueries, BFS_8_CONNECTED, batch);
+    startTime = getCurrentMicroSecs() - startTime;
+    for (q = 0; q < numQueries; q++)
+        numMismatch += (batch[q] != single[q]);
+    printf("multi-source bfs: %d queries in %.3f ms (%.3f ms one by one), %d mismatches\n",
+           numQueries, startTime / 1000.0, singleTime / 1000.0, numMismatch);
+
+    free(sources);
+    free(targets);
+    free(single);
+    free(batch);
+    bitGridFree(grid);
+}
+
+/*
+ * Dynamic obstacles: SOURCE of each pair walks along its path and, after
+ * every move, a random cell further on the path gets BLOCKED. One DStarLite
+ * planner repairs the plan after each change while A* searches again from
+ * scratch on the same grid. The grid is restored after each pair.
+ */
+static void runReplans(const SearchQuery* base, BlockLabels* labels, const int* pairs, int numQueries,
+                       int numReplans, std::mt19937& rng)
+{
+    DStarLite* planner = dstarLiteCreate(base->grid);
+    std::vector<int> blocked;
+    int q, r, i;
+
+    for (q = 0; q < numQueries; q++)
+    {
+        SearchQuery query = *base, scratch;
+        SearchResult result, reference;
+        SearchStatus status, referenceStatus;
+        long startTime, repairTime = 0, scratchTime = 0, repairExpanded = 0, scratchExpanded = 0;
+        int numMismatch = 0;
+
+        query.sourceIdx = pairs[2 * q];
+        query.targetIdx = pairs[2 * q + 1];
+        query.algorithm = ALGO_DSTAR_LITE;
+        query.preprocessed = planner;
+        scratch = query;
+        scratch.algorithm = ALGO_ASTAR;
+        scratch.preprocessed = NULL;
+
+        startTime = getCurrentMicroSecs();
+        status = findPath(&query, &result);
+        startTime = getCurrentMicroSecs() - startTime;
+        printf("replans %d: %d -> %d: first plan %s, %ld expansions in %.3f ms\n", q, query.sourceIdx,
+               query.targetIdx, statusName(status), result.stats.expanded, startTime / 1000.0);
+
+        blocked.clear();
+        for (r = 0; r < numReplans && status == SEARCH_FOUND && result.pathLen > 3; r++)
+        {
+            int cell = result.path[2 + rng() % (result.pathLen - 3)];
+
+            query.sourceIdx = result.path[1];
+            labels[cell] = LBL_BLOCKED;
+            blocked.push_back(cell);
+            dstarLiteToggleCell(planner, labels, cell);
+            freeSearchResult(&result);
+
+            startTime = getCurrentMicroSecs();
+            status = findPath(&query, &result);
+            repairTime += getCurrentMicroSecs() - startTime;
+            repairExpanded += result.stats.expanded;
+
+            scratch.sourceIdx = query.sourceIdx;
+            startTime = getCurrentMicroSecs();
+            referenceStatus = findPath(&scratch, &reference);
+            scratchTime += getCurrentMicroSecs() - startTime;
+            scratchExpanded += reference.stats.expanded;
+
+            numMismatch += (status != referenceStatus ||
+                            (status == SEARCH_FOUND && ABS(result.cost - reference.cost) > 1e-3f));
+            freeSearchResult(&reference);
+        }
+        freeSearchResult(&result);
+
+        printf("replans %d: %d changes, D* Lite %ld expansions in %.3f ms, "
+               "A* from scratch %ld expansions in %.3f ms (x%.2f), %d mismatches\n",
+               q, r, repairExpanded, repairTime / 1000.0, scratchExpanded, scratchTime / 1000.0,
+               (double) scratchTime / MAX2(repairTime, 1L), numMismatch);
+
+        for (i = 0; i < (int) blocked.size(); i++)
+        {
+            labels[blocked[i]] = LBL_UNBLOCKED;
+            dstarLiteToggleCell(planner, labels, blocked[i]);
+        }
+    }
+    dstarLiteFree(planner);
+}
+
+/*
+ * Real-time agent: each pair is walked `numTrials` times by the RtaaAgent of
+ * `base`, decision by decision, timing each one. The heuristic learned by a
+ * walk makes the next one shorter, down to the cost of the A* path.
+ */
+static void runRealTime(const SearchQuery* base, const int* pairs, int numQueries, int numTrials)
+{
+    RtaaAgent* agent = (RtaaAgent*) base->preprocessed;
+    int* moves = (int*) malloc((agent->lookahead + 1) * sizeof(int));
+    int q, t, i;
+
+    for (q = 0; q < numQueries; q++)
+    {
+        SearchQuery query = *base;
+        SearchResult reference;
+
+        query.sourceIdx = pairs[2 * q];
+        query.targetIdx = pairs[2 * q + 1];
+        query.algorithm = ALGO_ASTAR;
+        query.preprocessed = NULL;
+        if (findPath(&query, &reference) != SEARCH_FOUND)
+        {
+            printf("rtaa %d: %d -> %d: unreachable\n", q, query.sourceIdx, query.targetIdx);
+            continue;
+        }
+
+        for (t = 0; t < numTrials; t++)
+        {
+            SearchStats stats = {0, 0, 0};
+            OctileCost steps = {0, 0};
+            long totalTime = 0, worstTime = 0;
+            int current = query.sourceIdx, numDecisions = 0, numMoves = 0;
+
+            while (current != query.targetIdx && numMoves >= 0)
+            {
+                long startTime = getCurrentMicroSecs();
+                numMoves = rtaaStep(agent, query.labels, current, query.targetIdx, moves, &stats);
+                startTime = getCurrentMicroSecs() - startTime;
+                totalTime += startTime;
+                worstTime = MAX2(worstTime, startTime);
+                numDecisions++;
+
+                for (i = 0; i < numMoves; i++)
+                {
+                    if (moves[i] % query.grid.ncol != current % query.grid.ncol &&
+                        moves[i] / query.grid.ncol != current / query.grid.ncol)
+                        steps.diagonal++;
+                    else
+                        steps.straight++;
+                    current = moves[i];
+                }
+            }
+
+            printf("rtaa %d: %d -> %d: trial %d, walked %.3f (A* %.3f), %d decisions, %ld expansions, "
+                   "%.3f ms, worst decision %.3f ms\n", q, query.sourceIdx, query.targetIdx, t,
+                   octileValue(steps), reference.cost, numDecisions, stats.expanded,
+                   totalTime / 1000.0, worstTime / 1000.0);
+        }
+        freeSearchResult(&reference);
+    }
+    free(moves);
+}
+
+int runHeadless(int argc, char** argv)
+{
+    HeadlessOptions opt;
+    BlockLabels* labels = NULL;
+    int gridSource = -1, gridTarget = -1;
+    int q, numElement;
+    int* pairs;
+    SearchQuery base;
+    HeadlessTotals totals;
+    std::mt19937 rng;
+
+    if (parseOptions(argc, argv, &opt) != 0)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (opt.mapPath)
+    {
+        if (loadGridFile(opt.mapPath, &labels, &opt.windowSize) != 0)
+        {
+            printf("Error: cannot load grid from %s\n", opt.mapPath);
+            return 1;
+        }
+    }
+    else
+    {
+        labels = (BlockLabels*) malloc(opt.windowSize.nrow * opt.windowSize.ncol * sizeof(BlockLabels));
+        randomGrid(labels, opt.windowSize, opt.blockedRatio, opt.seed, &gridSource, &gridTarget);
+    }
+    numElement = opt.windowSize.nrow * opt.windowSize.ncol;
+    rng.seed(opt.seed + 1);
+
+    printf("grid %d x %d%s%s\n", opt.windowSize.nrow, opt.windowSize.ncol,
+           opt.mapPath ? " from " : "", opt.mapPath ? opt.mapPath : "");
+
+    /* The first query uses the grid SOURCE/TARGET, the next ones random free pairs */
+    pairs = (int*) malloc(2 * opt.numQueries * sizeof(int));
+    for (q = 0; q < opt.numQueries; q++)
+    {
+        pairs[2 * q]     = (q == 0 && gridSource >= 0) ? gridSource : randomFreeCell(labels, numElement, rng);
+        pairs[2 * q + 1] = (q == 0 && gridTarget >= 0) ? gridTarget : randomFreeCell(labels, numElement, rng);
+        if (opt.sourceIdx >= 0)
+            pairs[2 * q] = opt.sourceIdx;
+        if (opt.targetIdx >= 0)
+            pairs[2 * q + 1] = opt.targetIdx;
+    }
+
+    initSearchQuery(&base);
+    base.labels   = labels;
+    base.grid     = opt.windowSize;
+    base.algorithm = opt.algorithm;
+    base.openList = opt.openList;
+    base.tieBreaking = opt.tieBreaking;
+    base.heuristic = opt.heuristic;
+    base.numThreads = opt.numThreads;
+    base.weight = opt.weight;
+    base.timeBudget = opt.timeBudget;
+
+    /* Preprocessing is done once per map, not per query */
+    if (opt.algorithm == ALGO_JPS_PLUS)
+    {
+        long startTime = getCurrentMicroSecs();
+        base.preprocessed = jpsPlusBuild(labels, opt.windowSize);
+        printf("JPS+ table built in %.3f ms\n", (getCurrentMicroSecs() - startTime) / 1000.0);
+    }
+    else if (opt.algorithm == ALGO_HPA)
+    {
+        long startTime = getCurrentMicroSecs();
+        HpaGraph* graph = hpaBuild(labels, opt.windowSize, opt.clusterSize);
+        base.preprocessed = graph;
+        printf("HPA* graph built in %.3f ms: %d x %d clusters, %d entrances\n",
+               (getCurrentMicroSecs() - startTime) / 1000.0, graph->clustersX, graph->clustersY, graph->numNodes);
+    }
+    else if (opt.algorithm == ALGO_BLOCK_ASTAR)
+    {
+        long startTime = getCurrentMicroSecs();
+        base.preprocessed = blockDatabaseBuild();
+        printf("Block A* database built in %.3f ms\n", (getCurrentMicroSecs() - startTime) / 1000.0);
+    }
+    else if (opt.algorithm == ALGO_DSTAR_LITE)
+        base.preprocessed = dstarLiteCreate(opt.windowSize);
+    else if (opt.algorithm == ALGO_RTAA)
+        base.preprocessed = rtaaCreate(opt.windowSize, opt.lookahead);
+    else if (opt.algorithm == ALGO_SUBGOAL)
+    {
+        long startTime = getCurrentMicroSecs();
+        SubgoalGraph* graph = subgoalBuild(labels, opt.windowSize);
+        base.preprocessed = graph;
+        printf("subgoal graph built in %.3f ms: %d subgoals, %d edges\n",
+               (getCurrentMicroSecs() - startTime) / 1000.0, graph->numSubgoals, graph->numEdges);
+    }
+    else if (opt.algorithm == ALGO_CPD)
+    {
+        long startTime = getCurrentMicroSecs();
+        Cpd* cpd = opt.cpdPath ? cpdLoad(opt.cpdPath, labels, opt.windowSize) : NULL;
+
+        if (cpd != NULL)
+            printf("CPD loaded from %s in %.3f ms", opt.cpdPath, (getCurrentMicroSecs() - startTime) / 1000.0);
+        else
+        {
+            cpd = cpdBuild(labels, opt.windowSize, opt.numThreads);
+            printf("CPD built in %.3f ms on %d thread(s)", (getCurrentMicroSecs() - startTime) / 1000.0,
+                   opt.numThreads);
+            if (opt.cpdPath && cpdSave(cpd, opt.cpdPath) != 0)
+                printf(", cannot save it to %s", opt.cpdPath);
+        }
+        printf(": %d cells, %ld runs (%.1f per row, %.1f MB)\n", cpd->numNodes, (long) cpd->rowStart[cpd->numNodes],
+               (double) cpd->rowStart[cpd->numNodes] / MAX2(cpd->numNodes, 1),
+               cpd->rowStart[cpd->numNodes] * sizeof(uint32_t) / 1e6);
+        base.preprocessed = cpd;
+    }
+    else if (opt.algorithm == ALGO_RSR)
+    {
+        long startTime = getCurrentMicroSecs();
+        RsrMap* map = rsrBuild(labels, opt.windowSize);
+        int numFree = 0, idx;
+
+        for (idx = 0; idx < opt.windowSize.nrow * opt.windowSize.ncol; idx++)
+            numFree += (labels[idx] != LBL_BLOCKED);
+        base.preprocessed = map;
+        printf("RSR built in %.3f ms: %d rectangles, %.1f%% of the free cells pruned\n",
+               (getCurrentMicroSecs() - startTime) / 1000.0, map->numRects,
+               100.0 * map->numInterior / MAX2(numFree, 1));
+    }
+    if (opt.heuristic == HEURISTIC_ALT)
+    {
+        long startTime = getCurrentMicroSecs();
+        base.landmarks = altBuild(labels, opt.windowSize, opt.numLandmarks, opt.selection, opt.numThreads);
+        printf("ALT table built in %.3f ms: %d landmarks, %d thread(s)\n", (getCurrentMicroSecs() - startTime) / 1000.0,
+               base.landmarks ? base.landmarks->numLandmarks : 0, opt.numThreads);
+    }
+    if (opt.goalBounds)
+    {
+        long startTime = getCurrentMicroSecs();
+        base.goalBounds = goalBoundBuild(labels, opt.windowSize, opt.numThreads);
+        printf("goal bounds built in %.3f ms on %d thread(s) (%.1f MB)\n", (getCurrentMicroSecs() - startTime) / 1000.0,
+               opt.numThreads, (double) opt.windowSize.nrow * opt.windowSize.ncol * 32 * sizeof(uint16_t) / 1e6);
+    }
+    if (opt.swamps)
+    {
+        long startTime = getCurrentMicroSecs();
+        SwampMap* swamps = swampBuild(labels, opt.windowSize);
+        int idx, numFree = 0, numInside = 0;
+
+        for (idx = 0; idx < opt.windowSize.nrow * opt.windowSize.ncol; idx++)
+        {
+            numFree += (labels[idx] != LBL_BLOCKED);
+            numInside += (swamps->region[idx] != -1);
+        }
+        printf("swamps built in %.3f ms: %d regions, %.1f%% of the free cells\n",
+               (getCurrentMicroSecs() - startTime) / 1000.0, swamps->numRegions,
+               100.0 * numInside / MAX2(numFree, 1));
+        base.swamps = swamps;
+    }
+
+    if (opt.numReplans > 0)
+        runReplans(&base, labels, pairs, opt.numQueries, opt.numReplans, rng);
+    else if (opt.bfs)
+        runBitBfs(&base, pairs, opt.numQueries);
+    else if (opt.field)
+        runDistanceFields(&base, pairs, opt.numQueries);
+    else if (opt.bench)
+        benchOpenLists(&base, pairs, opt.numQueries);
+    else if (opt.algorithm == ALGO_RTAA)
+        runRealTime(&base, pairs, opt.numQueries, opt.numTrials);
+    else
+    {
+        runQueries(&base, pairs, opt.numQueries, true, &totals);
+        printf("total: %d/%d found, %ld expansions, %.3f ms\n",
+               totals.numFound, opt.numQueries, totals.expanded, totals.microSecs / 1000.0);
+        if (opt.heuristic == HEURISTIC_ALT)
+        {
+            HeadlessTotals octile;
+            SearchQuery query = base;
+            query.heuristic = HEURISTIC_OCTILE;
+            runQueries(&query, pairs, opt.numQueries, false, &octile);
+            printf("octile heuristic: %d/%d found, %ld expansions (x%.2f), %.3f ms\n",
+                   octile.numFound, opt.numQueries, octile.expanded,
+                   (double) octile.expanded / MAX2(totals.expanded, 1L), octile.microSecs / 1000.0);
+        }
+        if (opt.goalBounds)
+        {
+            HeadlessTotals unbounded;
+            SearchQuery query = base;
+            query.goalBounds = NULL;
+            runQueries(&query, pairs, opt.numQueries, false, &unbounded);
+            printf("without goal bounds: %d/%d found, %ld expansions (x%.2f), %.3f ms\n",
+                   unbounded.numFound, opt.numQueries, unbounded.expanded,
+                   (double) unbounded.expanded / MAX2(totals.expanded, 1L), unbounded.microSecs / 1000.0);
+        }
+        if (opt.swamps)
+        {
+            HeadlessTotals unpruned;
+            SearchQuery query = base;
+            query.swamps = NULL;
+            runQueries(&query, pairs, opt.numQueries, false, &unpruned);
+            printf("without swamps: %d/%d found, %ld expansions (x%.2f), %.3f ms\n",
+                   unpruned.numFound, opt.numQueries, unpruned.expanded,
+                   (double) unpruned.expanded / MAX2(totals.expanded, 1L), unpruned.microSecs / 1000.0);
+        }
+    }
+
+    if (opt.algorithm == ALGO_JPS_PLUS)
+        jpsPlusFree((JpsPlusTable*) base.preprocessed);
+    else if (opt.algorithm == ALGO_HPA)
+        hpaFree((HpaGraph*) base.preprocessed);
+    else if (opt.algorithm == ALGO_BLOCK_ASTAR)
+        blockDatabaseFree((BlockDatabase*) base.preprocessed);
+    else if (opt.algorithm == ALGO_DSTAR_LITE)
+        dstarLiteFree((DStarLite*) base.preprocessed);
+    else if (opt.algorithm == ALGO_RTAA)
+        rtaaFree((RtaaAgent*) base.preprocessed);
+    else if (opt.algorithm == ALGO_SUBGOAL)
+        subgoalFree((SubgoalGraph*) base.preprocessed);
+    else if (opt.algorithm == ALGO_CPD)
+        cpdFree((Cpd*) base.preprocessed);
+    else if (opt.algorithm == ALGO_RSR)
+        rsrFree((RsrMap*) base.preprocessed);
+    altFree((AltTable*) base.landmarks);
+    goalBoundFree((GoalBoundTable*) base.goalBounds);
+    swampFree((SwampMap*) base.swamps);
+    free(pairs);
+    free(labels);
+    return 0;
+}
@@ -0,0 +1,8 @@
+/*
+ * Command-line front end of the AStarAlgorithm binary: `--headless` runs the
+ * searches of libastar at full speed without creating any window.
+ */
+#pragma once
+
+bool isHeadlessRun(int argc, char** argv);
+int runHeadless(int argc, char** argv);
@@ -0,0 +1,676 @@
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "astar.hpp"
+#include "hpa.hpp"
+
+
+/*
+ * Every cluster owns the transitions to the clusters after it: across its
+ * east and south sides and across its south-east and south-west corners. A
+ * transition is a single move between two open cells on both sides of the
+ * border. Along a side, every maximal run of facing open pairs gets one or
+ * two straight transitions. A diagonal move across the border only gets its
+ * own transition when no facing pair next to it is open, and a corner one
+ * when both cells around the corner are BLOCKED: in the other cases the move
+ * is already covered by a straight transition one step away, so the graph
+ * stays small and still connects every pair of connected cells.
+ *
+ * The entrances (nodes) of a cluster are the cells of the transitions on its
+ * four sides, sorted by index; `intra` holds their pairwise distances when
+ * moving only inside the cluster.
+ */
+typedef struct HpaTransition
+{
+    int          from;          /* cell of the owning cluster           */
+    int          to;            /* cell of the cluster across           */
+    float        cost;          /* one move: 1 or SQRT2                 */
+} HpaTransition;
+
+struct HpaCluster
+{
+    int                         x0, y0, x1, y1;     /* cells [x0, x1) x [y0, y1)     */
+    std::vector<HpaTransition>  border;
+    std::vector<int>            nodes;
+    std::vector<float>          intra;              /* nodes^2, FLT_MAX when apart   */
+    int                         firstNode;          /* search id of nodes[0]         */
+};
+
+typedef std::pair<float, int> HpaEntry;
+typedef std::priority_queue<HpaEntry, std::vector<HpaEntry>, std::greater<HpaEntry> > HpaQueue;
+
+static inline bool isOpen(const BlockLabels* labels, int idx)
+{
+    return labels[idx] != LBL_BLOCKED;
+}
+
+static inline int clusterOf(const HpaGraph* graph, int idx)
+{
+    int ncol = graph->windowSize.ncol;
+    return (idx / ncol) / graph->clusterSize * graph->clustersX + (idx % ncol) / graph->clusterSize;
+}
+
+/* Position of `cell` among the entrances of `cluster`, -1 if it is not one */
+static inline int nodeIndex(const HpaCluster& cluster, int cell)
+{
+    std::vector<int>::const_iterator it = std::lower_bound(cluster.nodes.begin(), cluster.nodes.end(), cell);
+    return (it != cluster.nodes.end() && *it == cell) ? (int) (it - cluster.nodes.begin()) : -1;
+}
+
+static void addTransition(std::vector<HpaTransition>& border, int from, int to, float cost)
+{
+    HpaTransition transition;
+    transition.from = from;
+    transition.to = to;
+    transition.cost = cost;
+    border.push_back(transition);
+}
+
+/*
+ * Transitions of one side: cell `i` of the side is aStart + i * stride in the
+ * owning cluster, facing bStart + i * stride across the border.
+ */
+static void addSideTransitions(const BlockLabels* labels, int aStart, int bStart, int stride, int length,
+                               std::vector<HpaTransition>& border)
+{
+    int i, start;
+
+#define SIDE_A(i)       (aStart + (i) * stride)
+#define SIDE_B(i)       (bStart + (i) * stride)
+#define FACING_OPEN(i)  (isOpen(labels, SIDE_A(i)) && isOpen(labels, SIDE_B(i)))
+
+    for (i = 0; i < length; )
+    {
+        if (!FACING_OPEN(i))
+        {
+            i++;
+            continue;
+        }
+        for (start = i; i < length && FACING_OPEN(i); i++)
+            ;
+        if (i - start < HPA_LONG_ENTRANCE)
+            addTransition(border, SIDE_A((start + i - 1) / 2), SIDE_B((start + i - 1) / 2), 1.0f);
+        else
+        {
+            addTransition(border, SIDE_A(start), SIDE_B(start), 1.0f);
+            addTransition(border, SIDE_A(i - 1), SIDE_B(i - 1), 1.0f);
+        }
+    }
+
+    for (i = 0; i + 1 < length; i++)
+    {
+        if (FACING_OPEN(i) || FACING_OPEN(i + 1))
+            continue;
+        if (isOpen(labels, SIDE_A(i)) && isOpen(labels, SIDE_B(i + 1)))
+            addTransition(border, SIDE_A(i), SIDE_B(i + 1), SQRT2);
+        if (isOpen(labels, SIDE_A(i + 1)) && isOpen(labels, SIDE_B(i)))
+            addTransition(border, SIDE_A(i + 1), SIDE_B(i), SQRT2);
+    }
+
+#undef SIDE_A
+#undef SIDE_B
+#undef FACING_OPEN
+}
+
+static void computeBorder(HpaGraph* graph, const BlockLabels* labels, int c)
+{
+    HpaCluster& cluster = graph->clusters[c];
+    int ncol = graph->windowSize.ncol;
+    int cx = c % graph->clustersX, cy = c / graph->clustersX;
+    bool east = cx + 1 < graph->clustersX, west = cx > 0, south = cy + 1 < graph->clustersY;
+    int x0 = cluster.x0, y0 = cluster.y0, x1 = cluster.x1, y1 = cluster.y1;
+
+    cluster.border.clear();
+    if (east)
+        addSideTransitions(labels, (x1 - 1) + y0 * ncol, x1 + y0 * ncol, ncol, y1 - y0, cluster.border);
+    if (south)
+        addSideTransitions(labels, x0 + (y1 - 1) * ncol, x0 + y1 * ncol, 1, x1 - x0, cluster.border);
+
+    if (east && south &&
+        isOpen(labels, (x1 - 1) + (y1 - 1) * ncol) && isOpen(labels, x1 + y1 * ncol) &&
+        !isOpen(labels, x1 + (y1 - 1) * ncol) && !isOpen(labels, (x1 - 1) + y1 * ncol))
+        addTransition(cluster.border, (x1 - 1) + (y1 - 1) * ncol, x1 + y1 * ncol, SQRT2);
+    if (west && south &&
+        isOpen(labels, x0 + (y1 - 1) * ncol) && isOpen(labels, (x0 - 1) + y1 * ncol) &&
+        !isOpen(labels, (x0 - 1) + (y1 - 1) * ncol) && !isOpen(labels, x0 + y1 * ncol))
+        addTransition(cluster.border, x0 + (y1 - 1) * ncol, (x0 - 1) + y1 * ncol, SQRT2);
+}
+
+/*
+ * The clusters before `c` whose borders may end in `c`: west, north-west,
+ * north and north-east. Returns how many were stored in `before`.
+ */
+static int clustersBefore(const HpaGraph* graph, int c, int before[4])
+{
+    int cx = c % graph->clustersX, cy = c / graph->clustersX, n = 0;
+
+    if (cx > 0)
+        before[n++] = c - 1;
+    if (cy > 0)
+    {
+        if (cx > 0)
+            before[n++] = c - graph->clustersX - 1;
+        before[n++] = c - graph->clustersX;
+        if (cx + 1 < graph->clustersX)
+            before[n++] = c - graph->clustersX + 1;
+    }
+    return n;
+}
+
+/* Collect the entrances of `c` from the borders around it; true if they changed */
+static bool rebuildNodes(HpaGraph* graph, int c)
+{
+    HpaCluster& cluster = graph->clusters[c];
+    std::vector<int> nodes;
+    int before[4], numBefore, b;
+    size_t t;
+
+    for (t = 0; t < cluster.border.size(); t++)
+        nodes.push_back(cluster.border[t].from);
+    numBefore = clustersBefore(graph, c, before);
+    for (b = 0; b < numBefore; b++)
+    {
+        const std::vector<HpaTransition>& border = graph->clusters[before[b]].border;
+        for (t = 0; t < border.size(); t++)
+            if (clusterOf(graph, border[t].to) == c)
+                nodes.push_back(border[t].to);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+    if (nodes == cluster.nodes)
+        return false;
+    cluster.nodes.swap(nodes);
+    return true;
+}
+
+/* Working memory of localDijkstra(), kept from one call to the next */
+typedef struct HpaScratch
+{
+    std::vector<float>          value;
+    std::vector<int>            prev;
+    std::vector<OctileCost>     steps;
+    std::vector<HpaEntry>       heap;
+} HpaScratch;
+
+/*
+ * Dijkstra from `sourceIdx` without leaving `cluster`, stopping once
+ * `stopIdx` is settled (-1: the whole cluster). `scratch->value` and
+ * `scratch->prev` are indexed by cell inside the cluster,
+ * (x - x0) + (y - y0) * width.
+ */
+static void localDijkstra(const HpaGraph* graph, const BlockLabels* labels, const HpaCluster& cluster,
+                          int sourceIdx, int stopIdx, HpaScratch* scratch)
+{
+    int ncol = graph->windowSize.ncol;
+    int width = cluster.x1 - cluster.x0, height = cluster.y1 - cluster.y0;
+    int source = (sourceIdx % ncol - cluster.x0) + (sourceIdx / ncol - cluster.y0) * width;
+    int stop = (stopIdx < 0) ? -1 : (stopIdx % ncol - cluster.x0) + (stopIdx / ncol - cluster.y0) * width;
+    std::vector<float>& value = scratch->value;
+    std::vector<HpaEntry>& heap = scratch->heap;
+    std::greater<HpaEntry> later;
+
+    value.assign(width * height, FLT_MAX);
+    scratch->prev.assign(width * height, -1);
+    scratch->steps.resize(width * height);
+    heap.clear();
+
+    scratch->steps[source].straight = scratch->steps[source].diagonal = 0;
+    value[source] = 0.0f;
+    heap.push_back(HpaEntry(0.0f, source));
+
+    while (!heap.empty())
+    {
+        HpaEntry top = heap.front();
+        int u = top.second, ux = u % width, uy = u / width, dx, dy;
+
+        std::pop_heap(heap.begin(), heap.end(), later);
+        heap.pop_back();
+        if (top.first > value[u])
+            continue;
+        if (u == stop)
+            break;
+
+        for (dy = -1; dy <= 1; dy++)
+            for (dx = -1; dx <= 1; dx++)
+            {
+                int nx = ux + dx, ny = uy + dy, n;
+                OctileCost through;
+                float v;
+
+                if ((dx == 0 && dy == 0) || nx < 0 || nx >= width || ny < 0 || ny >= height ||
+                    !isOpen(labels, (cluster.x0 + nx) + (cluster.y0 + ny) * ncol))
+                    continue;
+
+                n = nx + ny * width;
+                through = scratch->steps[u];
+                if (dx != 0 && dy != 0)
+                    through.diagonal++;
+                else
+                    through.straight++;
+                v = octileValue(through);
+                if (v < value[n])
+                {
+                    value[n] = v;
+                    scratch->steps[n] = through;
+                    scratch->prev[n] = u;
+                    heap.push_back(HpaEntry(v, n));
+                    std::push_heap(heap.begin(), heap.end(), later);
+                }
+            }
+    }
+}
+
+static inline float localValue(const HpaGraph* graph, const HpaCluster& cluster,
+                               const std::vector<float>& value, int idx)
+{
+    int ncol = graph->windowSize.ncol;
+    return value[(idx % ncol - cluster.x0) + (idx / ncol - cluster.y0) * (cluster.x1 - cluster.x0)];
+}
+
+/* Pairwise distances of the entrances of `c`, one Dijkstra per entrance */
+static void computeIntra(HpaGraph* graph, const BlockLabels* labels, int c)
+{
+    HpaCluster& cluster = graph->clusters[c];
+    int n = (int) cluster.nodes.size(), i, j;
+    HpaScratch scratch;
+
+    cluster.intra.assign(n * n, FLT_MAX);
+    for (i = 0; i < n; i++)
+    {
+        cluster.intra[i * n + i] = 0.0f;
+        if (i + 1 == n)
+            break;
+        localDijkstra(graph, labels, cluster, cluster.nodes[i], -1, &scratch);
+        for (j = i + 1; j < n; j++)
+            cluster.intra[i * n + j] = cluster.intra[j * n + i] =
+                localValue(graph, cluster, scratch.value, cluster.nodes[j]);
+    }
+}
+
+static void numberNodes(HpaGraph* graph)
+{
+    int c;
+
+    graph->numNodes = 0;
+    for (c = 0; c < graph->clustersX * graph->clustersY; c++)
+    {
+        graph->clusters[c].firstNode = graph->numNodes;
+        graph->numNodes += (int) graph->clusters[c].nodes.size();
+    }
+}
+
+/*
+ * Build the abstract graph of a grid: transitions, entrances and, for every
+ * cluster, the distances between its entrances. `clusterSize` <= 0 picks
+ * HPA_CLUSTER_SIZE. Clusters of the last row / column may be smaller.
+ */
+HpaGraph* hpaBuild(const BlockLabels* labels, Grid windowSize, int clusterSize)
+{
+    HpaGraph* graph = (HpaGraph*) malloc(sizeof(HpaGraph));
+    int c, numClusters;
+
+    graph->windowSize = windowSize;
+    graph->clusterSize = (clusterSize > 0) ? clusterSize : HPA_CLUSTER_SIZE;
+    graph->clustersX = (windowSize.ncol + graph->clusterSize - 1) / graph->clusterSize;
+    graph->clustersY = (windowSize.nrow + graph->clusterSize - 1) / graph->clusterSize;
+    numClusters = graph->clustersX * graph->clustersY;
+    graph->clusters = new HpaCluster[numClusters];
+
+    for (c = 0; c < numClusters; c++)
+    {
+        HpaCluster& cluster = graph->clusters[c];
+        cluster.x0 = (c % graph->clustersX) * graph->clusterSize;
+        cluster.y0 = (c / graph->clustersX) * graph->clusterSize;
+        cluster.x1 = MIN2(cluster.x0 + graph->clusterSize, windowSize.ncol);
+        cluster.y1 = MIN2(cluster.y0 + graph->clusterSize, windowSize.nrow);
+    }
+    for (c = 0; c < numClusters; c++)
+        computeBorder(graph, labels, c);
+    for (c = 0; c < numClusters; c++)
+    {
+        rebuildNodes(graph, c);
+        computeIntra(graph, labels, c);
+    }
+    numberNodes(graph);
+    return graph;
+}
+
+/*
+ * Keep the graph in sync after the BLOCKED state of `idx` was flipped in
+ * `labels`. Only the distances of its own cluster change, unless `idx` lies
+ * on the outer ring of its cluster: then the borders around it are redone,
+ * and the neighbour clusters whose entrances changed recompute theirs too.
+ */
+void hpaToggleCell(HpaGraph* graph, const BlockLabels* labels, int idx)
+{
+    int ncol = graph->windowSize.ncol, x = idx % ncol, y = idx / ncol;
+    int c = clusterOf(graph, idx), cx = c % graph->clustersX, cy = c / graph->clustersX;
+    const HpaCluster& cluster = graph->clusters[c];
+    int nx, ny;
+
+    if (x != cluster.x0 && x != cluster.x1 - 1 && y != cluster.y0 && y != cluster.y1 - 1)
+    {
+        computeIntra(graph, labels, c);
+        return;
+    }
+
+    for (ny = MAX2(cy - 1, 0); ny <= MIN2(cy + 1, graph->clustersY - 1); ny++)
+        for (nx = MAX2(cx - 1, 0); nx <= MIN2(cx + 1, graph->clustersX - 1); nx++)
+            computeBorder(graph, labels, nx + ny * graph->clustersX);
+    for (ny = MAX2(cy - 1, 0); ny <= MIN2(cy + 1, graph->clustersY - 1); ny++)
+        for (nx = MAX2(cx - 1, 0); nx <= MIN2(cx + 1, graph->clustersX - 1); nx++)
+        {
+            int n = nx + ny * graph->clustersX;
+            if (rebuildNodes(graph, n) || n == c)
+                computeIntra(graph, labels, n);
+        }
+    numberNodes(graph);
+}
+
+void hpaFree(HpaGraph* graph)
+{
+    if (graph == NULL)
+        return;
+    delete[] graph->clusters;
+    free(graph);
+}
+
+static bool isValidGraph(const SearchQuery *query)
+{
+    const HpaGraph* graph = (const HpaGraph*) query->preprocessed;
+
+    return (graph != NULL &&
+            graph->windowSize.nrow == query->grid.nrow &&
+            graph->windowSize.ncol == query->grid.ncol);
+}
+
+/*
+ * State of one abstract search. Entrances use their HpaCluster::firstNode
+ * based id, SOURCE and TARGET the two ids after them. The arrays are
+ * calloc()ed, so only the pages of the nodes the search reaches are ever
+ * touched, however large the map.
+ */
+typedef struct HpaSearch
+{
+    const SearchQuery  *query;
+    const HpaGraph     *graph;
+    float              *g;
+    int                *prev;
+    int                *cell;
+    char               *state;          /* 0: new, 1: open, 2: closed */
+    HpaQueue            open;
+    SearchStats        *stats;
+} HpaSearch;
+
+/* Offer `id` (at `cellIdx`) the way through `from`; true if the observer aborts */
+static bool relaxNode(HpaSearch* search, int from, int id, int cellIdx, float cost)
+{
+    const SearchQuery* query = search->query;
+    float g = search->g[from] + cost;
+    bool entrance = (id < search->graph->numNodes);
+
+    if (search->state[id] == 2 || (search->state[id] == 1 && g >= search->g[id]))
+        return false;
+
+    search->g[id] = g;
+    search->prev[id] = from;
+    search->cell[id] = cellIdx;
+    search->open.push(HpaEntry(g + octileValue(octileDistance(cellIdx, query->targetIdx, query->grid.ncol)), id));
+    search->stats->generated++;
+    search->stats->maxOpenSize = MAX2(search->stats->maxOpenSize, (long) search->open.size());
+    if (search->state[id] == 0)
+    {
+        search->state[id] = 1;
+        if (entrance && NOTIFY_OBSERVER(query, cellIdx, LBL_TOBEVISITED))
+            return true;
+    }
+    return false;
+}
+
+/*
+ * A* on the abstract graph. SOURCE and TARGET are linked to the entrances of
+ * their clusters (and to each other when they share one) by a Dijkstra
+ * inside the cluster. On success `result->path` holds the waypoints only:
+ * SOURCE, the entrances crossed and TARGET, each one in the same cluster as
+ * the next or one move away from it; hpaRefineSegment() turns a pair into
+ * cells when it is needed. The observer sees the entrances only.
+ */
+SearchStatus hpaAbstractSearch(const SearchQuery *query, SearchResult *result)
+{
+    const HpaGraph* graph = (const HpaGraph*) query->preprocessed;
+    int sourceIdx = query->sourceIdx, targetIdx = query->targetIdx;
+    SearchStatus status = SEARCH_NOT_FOUND;
+    HpaScratch scratch;
+    std::vector<float> sourceValue, targetValue;
+    int sourceCluster, targetCluster, sourceId, targetId, numIds, len, id;
+    HpaSearch search;
+
+    initSearchResult(result);
+    if (!isValidQuery(query) || !isValidGraph(query))
+        return SEARCH_INVALID;
+
+    sourceCluster = clusterOf(graph, sourceIdx);
+    targetCluster = clusterOf(graph, targetIdx);
+    localDijkstra(graph, query->labels, graph->clusters[sourceCluster], sourceIdx, -1, &scratch);
+    sourceValue.swap(scratch.value);
+    localDijkstra(graph, query->labels, graph->clusters[targetCluster], targetIdx, -1, &scratch);
+    targetValue.swap(scratch.value);
+
+    sourceId = graph->numNodes;
+    targetId = graph->numNodes + 1;
+    numIds = graph->numNodes + 2;
+    search.query = query;
+    search.graph = graph;
+    search.g     = (float*) calloc(numIds, sizeof(float));
+    search.prev  = (int*) calloc(numIds, sizeof(int));
+    search.cell  = (int*) calloc(numIds, sizeof(int));
+    search.state = (char*) calloc(numIds, sizeof(char));
+    search.stats = &result->stats;
+
+    search.g[sourceId] = 0.0f;
+    search.prev[sourceId] = -1;
+    search.cell[sourceId] = sourceIdx;
+    search.state[sourceId] = 1;
+    search.open.push(HpaEntry(octileValue(octileDistance(sourceIdx, targetIdx, query->grid.ncol)), sourceId));
+
+    while (!search.open.empty())
+    {
+        int u = search.open.top().second, i, j, b, n, numBefore, before[4];
+        const HpaCluster* cluster;
+        bool aborted = false;
+        size_t t;
+
+        search.open.pop();
+        if (search.state[u] == 2)
+            continue;
+        search.state[u] = 2;
+        result->stats.expanded++;
+
+        if (u == targetId)
+        {
+            status = SEARCH_FOUND;
+            break;
+        }
+        if (u != sourceId && NOTIFY_OBSERVER(query, search.cell[u], LBL_VISITING))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+
+        if (u == sourceId)
+        {
+            cluster = &graph->clusters[sourceCluster];
+            for (i = 0; i < (int) cluster->nodes.size() && !aborted; i++)
+            {
+                float cost = localValue(graph, *cluster, sourceValue, cluster->nodes[i]);
+                if (cost < FLT_MAX)
+                    aborted = relaxNode(&search, u, cluster->firstNode + i, cluster->nodes[i], cost);
+            }
+            if (sourceCluster == targetCluster && !aborted &&
+                localValue(graph, *cluster, sourceValue, targetIdx) < FLT_MAX)
+                aborted = relaxNode(&search, u, targetId, targetIdx,
+                                    localValue(graph, *cluster, sourceValue, targetIdx));
+        }
+        else
+        {
+            int c = clusterOf(graph, search.cell[u]);
+
+            cluster = &graph->clusters[c];
+            n = (int) cluster->nodes.size();
+            i = u - cluster->firstNode;
+
+            /* Across the cluster */
+            for (j = 0; j < n && !aborted; j++)
+                if (j != i && cluster->intra[i * n + j] < FLT_MAX)
+                    aborted = relaxNode(&search, u, cluster->firstNode + j, cluster->nodes[j],
+                                        cluster->intra[i * n + j]);
+
+            /* Across the borders, owned by this cluster or by one before it */
+            for (t = 0; t < cluster->border.size() && !aborted; t++)
+                if (cluster->border[t].from == search.cell[u])
+                {
+                    const HpaCluster& other = graph->clusters[clusterOf(graph, cluster->border[t].to)];
+                    aborted = relaxNode(&search, u, other.firstNode + nodeIndex(other, cluster->border[t].to),
+                                        cluster->border[t].to, cluster->border[t].cost);
+                }
+            numBefore = clustersBefore(graph, c, before);
+            for (b = 0; b < numBefore && !aborted; b++)
+            {
+                const HpaCluster& other = graph->clusters[before[b]];
+                for (t = 0; t < other.border.size() && !aborted; t++)
+                    if (other.border[t].to == search.cell[u])
+                        aborted = relaxNode(&search, u, other.firstNode + nodeIndex(other, other.border[t].from),
+                                            other.border[t].from, other.border[t].cost);
+            }
+
+            if (c == targetCluster && !aborted &&
+                localValue(graph, *cluster, targetValue, search.cell[u]) < FLT_MAX)
+                aborted = relaxNode(&search, u, targetId, targetIdx,
+                                    localValue(graph, *cluster, targetValue, search.cell[u]));
+        }
+
+        if (aborted || (u != sourceId && NOTIFY_OBSERVER(query, search.cell[u], LBL_VISITED)))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+    }
+
+    if (status == SEARCH_FOUND)
+    {
+        /* Waypoints from TARGET back to SOURCE, then reversed; an entrance on SOURCE / TARGET is dropped */
+        len = 0;
+        for (id = targetId; id != -1; id = search.prev[id])
+            len++;
+        result->path = (int*) malloc(len * sizeof(int));
+        result->pathLen = 0;
+        for (id = targetId; id != -1; id = search.prev[id])
+            if (result->pathLen == 0 || result->path[result->pathLen - 1] != search.cell[id])
+                result->path[result->pathLen++] = search.cell[id];
+        std::reverse(result->path, result->path + result->pathLen);
+        result->cost = search.g[targetId];
+    }
+
+    free(search.g);
+    free(search.prev);
+    free(search.cell);
+    free(search.state);
+    return status;
+}
+
+/*
+ * Cells from `fromIdx` to `toIdx`, two consecutive waypoints of
+ * hpaAbstractSearch(), both ends included, in a malloc()ed `*cells`.
+ * Returns their number, or -1 when the pair is not a segment of the graph
+ * (or the grid changed since).
+ */
+int hpaRefineSegment(const SearchQuery *query, int fromIdx, int toIdx, int** cells)
+{
+    const HpaGraph* graph = (const HpaGraph*) query->preprocessed;
+    const HpaCluster* cluster;
+    int ncol = query->grid.ncol, width, len, k, u;
+    HpaScratch scratch;
+
+    *cells = NULL;
+    if (!isValidGraph(query))
+        return -1;
+
+    if (clusterOf(graph, fromIdx) != clusterOf(graph, toIdx))
+    {
+        if (ABS(fromIdx % ncol - toIdx % ncol) > 1 || ABS(fromIdx / ncol - toIdx / ncol) > 1)
+            return -1;
+        *cells = (int*) malloc(2 * sizeof(int));
+        (*cells)[0] = fromIdx;
+        (*cells)[1] = toIdx;
+        return 2;
+    }
+
+    cluster = &graph->clusters[clusterOf(graph, fromIdx)];
+    width = cluster->x1 - cluster->x0;
+    localDijkstra(graph, query->labels, *cluster, fromIdx, toIdx, &scratch);
+    if (localValue(graph, *cluster, scratch.value, toIdx) == FLT_MAX)
+        return -1;
+
+    u = (toIdx % ncol - cluster->x0) + (toIdx / ncol - cluster->y0) * width;
+    for (len = 1; scratch.prev[u] != -1; u = scratch.prev[u])
+        len++;
+    *cells = (int*) malloc(len * sizeof(int));
+    u = (toIdx % ncol - cluster->x0) + (toIdx / ncol - cluster->y0) * width;
+    for (k = len - 1; k >= 0; k--, u = scratch.prev[u])
+        (*cells)[k] = (cluster->x0 + u % width) + (cluster->y0 + u / width) * ncol;
+    return len;
+}
+
+/*
+ * HPA* as an engine of findPath(): the abstract search, then every segment
+ * refined so that `result->path` holds all the cells like the other engines.
+ * `stats` count the abstract search only. The path is near-optimal: it is
+ * the shortest one through the entrances of the graph.
+ */
+SearchStatus hpaSearch(const SearchQuery *query, SearchResult *result)
+{
+    std::vector<int> path;
+    OctileCost cost = {0, 0};
+    SearchStatus status;
+    int k, i, len, *segment;
+
+    status = hpaAbstractSearch(query, result);
+    if (status != SEARCH_FOUND)
+        return status;
+
+    path.push_back(result->path[0]);
+    for (k = 1; k < result->pathLen; k++)
+    {
+        len = hpaRefineSegment(query, result->path[k - 1], result->path[k], &segment);
+        if (len < 0)
+        {
+            freeSearchResult(result);
+            return SEARCH_NOT_FOUND;
+        }
+        for (i = 1; i < len; i++)
+        {
+            int dx = segment[i] % query->grid.ncol - segment[i - 1] % query->grid.ncol;
+            int dy = segment[i] / query->grid.ncol - segment[i - 1] / query->grid.ncol;
+            if (dx != 0 && dy != 0)
+                cost.diagonal++;
+            else
+                cost.straight++;
+            path.push_back(segment[i]);
+        }
+        free(segment);
+    }
+
+    free(result->path);
+    result->path = (int*) malloc(path.size() * sizeof(int));
+    memcpy(result->path, path.data(), path.size() * sizeof(int));
+    result->pathLen = (int) path.size();
+    result->cost = octileValue(cost);
+    return SEARCH_FOUND;
+}
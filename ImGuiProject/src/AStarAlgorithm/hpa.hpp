@@ -0,0 +1,36 @@
+/*
+ * Near-optimal Hierarchical Path-Finding, HPA* (Botea, Mueller & Schaeffer,
+ * 2004): the grid is cut into clusters of HpaGraph::clusterSize cells
+ * square, queries are answered on a small graph of cluster entrances and the
+ * abstract path is turned into cells one segment at a time.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+#define HPA_CLUSTER_SIZE        16
+
+/*
+ * A run of open cells along a cluster side gets one entrance in its middle,
+ * or one at each end from this length on.
+ */
+#define HPA_LONG_ENTRANCE       6
+
+typedef struct HpaCluster HpaCluster;
+
+typedef struct HpaGraph
+{
+    Grid         windowSize;
+    int          clusterSize;
+    int          clustersX;     /* clusters per row of the grid  */
+    int          clustersY;     /* clusters per column           */
+    int          numNodes;      /* entrances of all the clusters */
+    HpaCluster  *clusters;      /* clustersX * clustersY, row by row */
+} HpaGraph;
+
+HpaGraph* hpaBuild(const BlockLabels* labels, Grid windowSize, int clusterSize);
+void hpaToggleCell(HpaGraph* graph, const BlockLabels* labels, int idx);
+void hpaFree(HpaGraph* graph);
+SearchStatus hpaAbstractSearch(const SearchQuery *query, SearchResult *result);
+int hpaRefineSegment(const SearchQuery *query, int fromIdx, int toIdx, int** cells);
+SearchStatus hpaSearch(const SearchQuery *query, SearchResult *result);
@@ -0,0 +1,486 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "jps.hpp"
+#include "goalbound.hpp"
+
+
+/*
+ * The moves of astarSearch() are the rules JPS has to respect: a diagonal
+ * move only needs its destination to be unblocked, it may cut the corner of
+ * (or squeeze between) blocked cells. This is the setting of the original
+ * JPS paper, so its forced neighbour rules apply unchanged:
+ *
+ *  - moving straight along (dx, 0), a blocked cell beside the current one,
+ *    at (x, y +- 1), forces the diagonal (dx, +-1);
+ *  - moving diagonally along (dx, dy), a blocked (x - dx, y) forces
+ *    (-dx, dy) and a blocked (x, y - dy) forces (dx, -dy).
+ *
+ * A forced move is only worth it when its destination is unblocked; the
+ * jump in that direction fails immediately otherwise.
+ */
+typedef struct JpsGrid
+{
+    const BlockLabels  *labels;
+    int                 nrow;
+    int                 ncol;
+    int                 targetIdx;
+    const JpsPlusTable *table;      /* JPS+: jumps are looked up instead of scanned */
+} JpsGrid;
+
+/* Order of the 8 entries of a cell in JpsPlusTable: straight ones first */
+static const int JPS_DIRECTIONS[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1},
+                                         {1, 1}, {-1, 1}, {1, -1}, {-1, -1}};
+
+static inline int directionIndex(int dx, int dy)
+{
+    static const int index[9] = {7, 3, 6, 1, -1, 0, 5, 2, 4};
+    return index[(dy + 1) * 3 + (dx + 1)];
+}
+
+static inline bool isFree(const JpsGrid* grid, int x, int y)
+{
+    return (x >= 0 && x < grid->ncol &&
+            y >= 0 && y < grid->nrow &&
+            grid->labels[x + y * grid->ncol] != LBL_BLOCKED);
+}
+
+static bool hasForcedNeighbour(const JpsGrid* grid, int x, int y, int dx, int dy)
+{
+    if (dx != 0 && dy != 0)
+        return (!isFree(grid, x - dx, y) && isFree(grid, x - dx, y + dy)) ||
+               (!isFree(grid, x, y - dy) && isFree(grid, x + dx, y - dy));
+    if (dx != 0)
+        return (!isFree(grid, x, y + 1) && isFree(grid, x + dx, y + 1)) ||
+               (!isFree(grid, x, y - 1) && isFree(grid, x + dx, y - 1));
+    return (!isFree(grid, x + 1, y) && isFree(grid, x + 1, y + dy)) ||
+           (!isFree(grid, x - 1, y) && isFree(grid, x - 1, y + dy));
+}
+
+/*
+ * Walk from (x, y) along (dx, dy) until a jump point is found: TARGET, a
+ * cell with a forced neighbour or, moving diagonally, a cell from which a
+ * straight jump finds one. Returns its index and the number of moves in
+ * `*distance`, or -1 when the walk runs into a BLOCKED cell or the border.
+ */
+static int jump(const JpsGrid* grid, int x, int y, int dx, int dy, int* distance)
+{
+    int idx, n = 0, unused;
+
+    while (true)
+    {
+        x += dx;
+        y += dy;
+        n++;
+
+        if (!isFree(grid, x, y))
+            return -1;
+
+        idx = x + y * grid->ncol;
+        if (idx == grid->targetIdx || hasForcedNeighbour(grid, x, y, dx, dy))
+            break;
+
+        if (dx != 0 && dy != 0 &&
+            (jump(grid, x, y, dx, 0, &unused) != -1 ||
+             jump(grid, x, y, 0, dy, &unused) != -1))
+            break;
+    }
+
+    *distance = n;
+    return idx;
+}
+
+/*
+ * JPS+ counterpart of jump(): read the jump off the table and only look for
+ * TARGET on the way. Moving diagonally towards the quadrant of TARGET, the
+ * cell from which TARGET is straight ahead is a jump point as well.
+ */
+static int lookupJump(const JpsGrid* grid, int x, int y, int dx, int dy, int* distance)
+{
+    int entry = grid->table->distance[(x + y * grid->ncol) * 8 + directionIndex(dx, dy)];
+    int tx = grid->targetIdx % grid->ncol, ty = grid->targetIdx / grid->ncol;
+    int freeMoves = (entry > 0) ? entry : -entry;
+    int toTarget = -1;
+
+    if (dx != 0 && dy != 0)
+    {
+        if ((tx - x) * dx > 0 && (ty - y) * dy > 0)
+            toTarget = MIN2((tx - x) * dx, (ty - y) * dy);
+    }
+    else if (dx != 0)
+    {
+        if (ty == y && (tx - x) * dx > 0)
+            toTarget = (tx - x) * dx;
+    }
+    else if (tx == x && (ty - y) * dy > 0)
+        toTarget = (ty - y) * dy;
+
+    if (toTarget != -1 && toTarget <= freeMoves)
+        *distance = toTarget;
+    else if (entry > 0)
+        *distance = entry;
+    else
+        return -1;
+
+    return (x + *distance * dx) + (y + *distance * dy) * grid->ncol;
+}
+
+/* Directions worth jumping to from (x, y), entered along (dx, dy) ((0, 0) at SOURCE) */
+static int prunedDirections(const JpsGrid* grid, int x, int y, int dx, int dy, int dirs[8][2])
+{
+    int n = 0;
+
+    if (dx == 0 && dy == 0)
+    {
+        for (dy = -1; dy <= 1; dy++)
+            for (dx = -1; dx <= 1; dx++)
+                if (dx != 0 || dy != 0)
+                {
+                    dirs[n][0] = dx; dirs[n][1] = dy; n++;
+                }
+        return n;
+    }
+
+    /* The natural neighbour first, then the forced ones */
+    dirs[n][0] = dx; dirs[n][1] = dy; n++;
+    if (dx != 0 && dy != 0)
+    {
+        dirs[n][0] = dx; dirs[n][1] = 0;  n++;
+        dirs[n][0] = 0;  dirs[n][1] = dy; n++;
+        if (!isFree(grid, x - dx, y))
+        {
+            dirs[n][0] = -dx; dirs[n][1] = dy; n++;
+        }
+        if (!isFree(grid, x, y - dy))
+        {
+            dirs[n][0] = dx; dirs[n][1] = -dy; n++;
+        }
+    }
+    else if (dx != 0)
+    {
+        if (!isFree(grid, x, y + 1))
+        {
+            dirs[n][0] = dx; dirs[n][1] = 1; n++;
+        }
+        if (!isFree(grid, x, y - 1))
+        {
+            dirs[n][0] = dx; dirs[n][1] = -1; n++;
+        }
+    }
+    else
+    {
+        if (!isFree(grid, x + 1, y))
+        {
+            dirs[n][0] = 1; dirs[n][1] = dy; n++;
+        }
+        if (!isFree(grid, x - 1, y))
+        {
+            dirs[n][0] = -1; dirs[n][1] = dy; n++;
+        }
+    }
+    return n;
+}
+
+/*
+ * Same contract as astarSearch(), but only jump points enter the open list
+ * and reach the observer. The path handed back is expanded cell by cell.
+ * With a `table` the jumps come from JPS+ lookups instead of grid scans.
+ */
+static SearchStatus jumpPointSearch(const SearchQuery *query, SearchResult *result,
+                                    const JpsPlusTable* table)
+{
+    Grid windowSize = query->grid;
+    int sourceIdx = query->sourceIdx, targetIdx = query->targetIdx;
+    int numElement = windowSize.nrow * windowSize.ncol;
+    SearchStatus status = SEARCH_NOT_FOUND;
+    JpsGrid grid = {query->labels, windowSize.nrow, windowSize.ncol, targetIdx, table};
+    const GoalBoundTable* bounds = query->goalBounds;
+
+    Cell* listCell;
+    BlockLabels* state;         /* LBL_UNBLOCKED, LBL_TOBEVISITED or LBL_VISITED */
+    OpenList openList;
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+    if (bounds != NULL &&
+        (bounds->windowSize.nrow != windowSize.nrow || bounds->windowSize.ncol != windowSize.ncol))
+        return SEARCH_INVALID;
+
+    listCell = initListCell(&windowSize, sourceIdx);
+    state = (BlockLabels*) calloc(numElement, sizeof(BlockLabels));
+    openListInit(&openList, query->openList, numElement);
+
+    listCell[sourceIdx].h = octileValue(octileDistance(sourceIdx, targetIdx, windowSize.ncol));
+    listCell[sourceIdx].f = listCell[sourceIdx].h;
+    openListPush(&openList, sourceIdx, listCell[sourceIdx].f, 0.0f);
+    state[sourceIdx] = LBL_TOBEVISITED;
+
+    while (openList.size > 0)
+    {
+        int d, numDirs, dirs[8][2];
+        int mainX, mainY, dx = 0, dy = 0;
+        int mainCellIdx = openListPop(&openList);
+        Cell* mainCell = &listCell[mainCellIdx];
+
+        if (mainCellIdx == targetIdx)
+        {
+            storePath(listCell, targetIdx, result);
+            expandPath(result, windowSize.ncol);
+            status = SEARCH_FOUND;
+            break;
+        }
+
+        if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITING))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+        state[mainCellIdx] = LBL_VISITED;
+        result->stats.expanded++;
+
+        mainX = mainCellIdx % windowSize.ncol;
+        mainY = mainCellIdx / windowSize.ncol;
+        if (mainCell->prev != -1)
+        {
+            int px = mainCell->prev % windowSize.ncol, py = mainCell->prev / windowSize.ncol;
+            dx = (mainX > px) - (mainX < px);
+            dy = (mainY > py) - (mainY < py);
+        }
+
+        numDirs = prunedDirections(&grid, mainX, mainY, dx, dy, dirs);
+        for (d = 0; d < numDirs; d++)
+        {
+            int distance, jumpIdx;
+            float successor_f, successor_g, successor_h;
+            OctileCost steps, total;
+            Cell* successorCell;
+
+            /*
+             * Goal bounding: the canonical shortest path JPS follows starts with
+             * one of the optimal first moves, whose boxes all hold TARGET
+             */
+            if (bounds != NULL && !goalBoundAllows(bounds, mainCellIdx, dirs[d][0], dirs[d][1], targetIdx))
+                continue;
+            if (table)
+                jumpIdx = lookupJump(&grid, mainX, mainY, dirs[d][0], dirs[d][1], &distance);
+            else
+                jumpIdx = jump(&grid, mainX, mainY, dirs[d][0], dirs[d][1], &distance);
+            if (jumpIdx == -1 || state[jumpIdx] == LBL_VISITED)
+                continue;
+
+            steps = mainCell->steps;
+            if (dirs[d][0] != 0 && dirs[d][1] != 0)
+                steps.diagonal += distance;
+            else
+                steps.straight += distance;
+            total = octileDistance(jumpIdx, targetIdx, windowSize.ncol);
+            successor_h = octileValue(total);
+            total.straight += steps.straight;
+            total.diagonal += steps.diagonal;
+            successor_g = octileValue(steps);
+            successor_f = octileValue(total);
+
+            successorCell = &listCell[jumpIdx];
+            if (successorCell->g > successor_g)
+            {
+                successorCell->f = successor_f;
+                successorCell->g = successor_g;
+                successorCell->h = successor_h;
+                successorCell->steps = steps;
+                successorCell->prev = mainCellIdx;
+
+                state[jumpIdx] = LBL_TOBEVISITED;
+                openListPush(&openList, jumpIdx, successor_f,
+                             tieBreakValue(query->tieBreaking, successor_g, successor_h));
+                result->stats.generated++;
+                result->stats.maxOpenSize = MAX2(result->stats.maxOpenSize, (long) openList.size);
+
+                if (NOTIFY_OBSERVER(query, jumpIdx, LBL_TOBEVISITED))
+                {
+                    status = SEARCH_ABORTED;
+                    goto done;
+                }
+            }
+        }
+
+        if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITED))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+    }
+
+done:
+    openListFree(&openList);
+    free(state);
+    free(listCell);
+
+    return status;
+}
+
+SearchStatus jpsSearch(const SearchQuery *query, SearchResult *result)
+{
+    return jumpPointSearch(query, result, NULL);
+}
+
+/* JPS+ query on the table of query->preprocessed (see jpsPlusBuild()) */
+SearchStatus jpsPlusSearch(const SearchQuery *query, SearchResult *result)
+{
+    const JpsPlusTable* table = (const JpsPlusTable*) query->preprocessed;
+
+    if (table == NULL ||
+        table->windowSize.nrow != query->grid.nrow ||
+        table->windowSize.ncol != query->grid.ncol)
+    {
+        initSearchResult(result);
+        return SEARCH_INVALID;
+    }
+    return jumpPointSearch(query, result, table);
+}
+
+/*
+ * Entry `d` of (x, y) from the cell one move ahead, whose entries (and the
+ * straight ones, for a diagonal `d`) must be up to date.
+ */
+static int computeEntry(const JpsGrid* grid, int* distance, int x, int y, int d)
+{
+    int dx = JPS_DIRECTIONS[d][0], dy = JPS_DIRECTIONS[d][1];
+    int nx = x + dx, ny = y + dy, next, entry;
+
+    if (!isFree(grid, nx, ny))
+        return 0;
+    next = nx + ny * grid->ncol;
+    if (hasForcedNeighbour(grid, nx, ny, dx, dy))
+        return 1;
+    if (dx != 0 && dy != 0 &&
+        (distance[next * 8 + directionIndex(dx, 0)] > 0 ||
+         distance[next * 8 + directionIndex(0, dy)] > 0))
+        return 1;
+
+    entry = distance[next * 8 + d];
+    return (entry > 0) ? entry + 1 : entry - 1;
+}
+
+/*
+ * Build the JPS+ table of a grid in 8 sweeps, each visiting the cells so that
+ * the one ahead in its direction is always done first. O(8 * nrow * ncol).
+ */
+JpsPlusTable* jpsPlusBuild(const BlockLabels* labels, Grid windowSize)
+{
+    JpsPlusTable* table;
+    JpsGrid grid = {labels, windowSize.nrow, windowSize.ncol, -1, NULL};
+    int d, i, j, numElement = windowSize.nrow * windowSize.ncol;
+
+    table = (JpsPlusTable*) malloc(sizeof(JpsPlusTable));
+    table->windowSize = windowSize;
+    table->distance = (int*) calloc(numElement * 8, sizeof(int));
+
+    for (d = 0; d < 8; d++)
+    {
+        int dx = JPS_DIRECTIONS[d][0], dy = JPS_DIRECTIONS[d][1];
+
+        for (i = 0; i < windowSize.nrow; i++)
+        {
+            int y = (dy > 0) ? windowSize.nrow - 1 - i : i;
+            for (j = 0; j < windowSize.ncol; j++)
+            {
+                int x = (dx > 0) ? windowSize.ncol - 1 - j : j;
+                if (labels[x + y * windowSize.ncol] != LBL_BLOCKED)
+                    table->distance[(x + y * windowSize.ncol) * 8 + d] =
+                        computeEntry(&grid, table->distance, x, y, d);
+            }
+        }
+    }
+
+    return table;
+}
+
+/*
+ * Recompute entry `d` of `seed`, then of the cells behind it, until one comes
+ * out unchanged: the cells further back only depend on that one. The cells
+ * whose entry changed are appended to `changed`.
+ */
+static void patchRay(const JpsGrid* grid, int* distance, int seed, int d, std::vector<int>* changed)
+{
+    int dx = JPS_DIRECTIONS[d][0], dy = JPS_DIRECTIONS[d][1];
+    int x = seed % grid->ncol, y = seed / grid->ncol;
+
+    while (isFree(grid, x, y))
+    {
+        int idx = x + y * grid->ncol;
+        int entry = computeEntry(grid, distance, x, y, d);
+
+        if (entry == distance[idx * 8 + d])
+            break;
+        distance[idx * 8 + d] = entry;
+        if (changed)
+            changed->push_back(idx);
+        x -= dx;
+        y -= dy;
+    }
+}
+
+/* Patch direction `d` from every seed, the seeds furthest along `d` first */
+static void patchDirection(const JpsGrid* grid, int* distance, std::vector<int>& seeds, int d,
+                           std::vector<int>* changed)
+{
+    int dx = JPS_DIRECTIONS[d][0], dy = JPS_DIRECTIONS[d][1], ncol = grid->ncol;
+
+    std::sort(seeds.begin(), seeds.end(), [dx, dy, ncol](int a, int b) {
+        return dx * (a % ncol) + dy * (a / ncol) > dx * (b % ncol) + dy * (b / ncol);
+    });
+    for (int seed : seeds)
+        patchRay(grid, distance, seed, d, changed);
+}
+
+/*
+ * Keep the table in sync after the BLOCKED state of `idx` was flipped in
+ * `labels`. The toggle changes which cells are free and which have forced
+ * neighbours, all within the 3x3 block around `idx`; the straight entries of
+ * the cells just behind that block are recomputed, then the diagonal ones
+ * behind the block and behind every cell whose straight entries changed.
+ * Each ray stops as soon as an entry is unchanged, so a toggle costs about
+ * the length of the rays it really alters instead of a full rebuild.
+ */
+void jpsPlusToggleCell(JpsPlusTable* table, const BlockLabels* labels, int idx)
+{
+    JpsGrid grid = {labels, table->windowSize.nrow, table->windowSize.ncol, -1, NULL};
+    int d, ox, oy, x = idx % grid.ncol, y = idx / grid.ncol;
+    std::vector<int> changed, seeds;
+
+    if (labels[idx] == LBL_BLOCKED)
+        for (d = 0; d < 8; d++)
+            table->distance[idx * 8 + d] = 0;
+
+    for (d = 0; d < 8; d++)
+    {
+        int dx = JPS_DIRECTIONS[d][0], dy = JPS_DIRECTIONS[d][1];
+
+        seeds.clear();
+        for (oy = -1; oy <= 1; oy++)
+            for (ox = -1; ox <= 1; ox++)
+                if (isFree(&grid, x + ox - dx, y + oy - dy))
+                    seeds.push_back((x + ox - dx) + (y + oy - dy) * grid.ncol);
+
+        /* Diagonal jumps stop where a straight jump succeeds */
+        if (dx != 0 && dy != 0)
+            for (int cell : changed)
+                if (isFree(&grid, cell % grid.ncol - dx, cell / grid.ncol - dy))
+                    seeds.push_back(cell - dx - dy * grid.ncol);
+
+        patchDirection(&grid, table->distance, seeds, d, (dx != 0 && dy != 0) ? NULL : &changed);
+    }
+}
+
+void jpsPlusFree(JpsPlusTable* table)
+{
+    if (table == NULL)
+        return;
+    free(table->distance);
+    free(table);
+}
@@ -0,0 +1,26 @@
+/*
+ * Jump Point Search (Harabor & Grastien, 2011) on the uniform-cost,
+ * 8-connected grid of libastar.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+/*
+ * JPS+: the jumps of every unblocked cell, precomputed for the 8 directions.
+ * An entry > 0 is the number of moves to the next jump point in that
+ * direction; an entry <= 0 is minus the number of unblocked cells before the
+ * border or a BLOCKED cell. TARGET is not part of the table, queries find it
+ * on the fly, so one table serves every SOURCE/TARGET pair of a map.
+ */
+typedef struct JpsPlusTable
+{
+    Grid         windowSize;
+    int         *distance;      /* 8 entries per cell, in the order of JPS_DIRECTIONS */
+} JpsPlusTable;
+
+SearchStatus jpsSearch(const SearchQuery *query, SearchResult *result);
+JpsPlusTable* jpsPlusBuild(const BlockLabels* labels, Grid windowSize);
+void jpsPlusToggleCell(JpsPlusTable* table, const BlockLabels* labels, int idx);
+void jpsPlusFree(JpsPlusTable* table);
+SearchStatus jpsPlusSearch(const SearchQuery *query, SearchResult *result);
@@ -18,6 +18,19 @@
 #include <unistd.h>
 #include <string>
 #include "utils.hpp"
+#include "headless.hpp"
+#include "jps.hpp"
+#include "hpa.hpp"
+#include "dstarlite.hpp"
+#include "alt.hpp"
+#include "blockastar.hpp"
+#include "arastar.hpp"
+#include "rtaa.hpp"
+#include "subgoal.hpp"
+#include "cpd.hpp"
+#include "rsr.hpp"
+#include "goalbound.hpp"
+#include "swamp.hpp"
 
 
 extern int   sourceIdx, targetIdx;
@@ -31,6 +44,10 @@ extern float fontS;
 
 int main(int argc, char** argv)
 {
+    // Batch mode: no window, no ImGui context, searches at full speed
+    if (isHeadlessRun(argc, argv))
+        return runHeadless(argc, argv);
+
     // Setup SDL
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER) != 0)
     {
@@ -85,10 +102,52 @@ int main(int argc, char** argv)
     ThreadState t_state = THREAD_INITIALIZED;
     pthread_t thread_id;
     bool show_config_window = false;
-    ThreadSearchingState shared;
+    ThreadSearchingState shared = {};
     char resultMsg[50];
     bool show_warning_init_new_state = false;
     float blockedRatio = 0.3;
+    int algorithmIdx = ALGO_ASTAR;
+    const char* algorithmNames[] = {"A*", "Jump Point Search", "JPS+ (precomputed jumps)",
+                                    "Bidirectional A*", "HDA* (hash distributed)",
+                                    "MultiQueue parallel A*", "Delta-stepping (parallel SSSP)",
+                                    "HPA* (hierarchical clusters)", "Block A* (4x4 LDDB)",
+                                    "D* Lite (incremental)", "ARA* (anytime)",
+                                    "RTAA* (real-time agent)", "Lazy Theta* (any-angle)",
+                                    "Subgoal graph (SUB)", "CPD (first-move database)",
+                                    "RSR (empty rectangles)"};
+    JpsPlusTable* jpsPlus = NULL;   /* built on the first JPS+ run, patched on toggles */
+    bool jpsPlusStale = false;      /* the grid was replaced: rebuild before next use */
+    HpaGraph* hpa = NULL;           /* same life cycle as jpsPlus */
+    bool hpaStale = false;
+    SubgoalGraph* subgoalGraph = NULL;  /* built on the first subgoal run, rebuilt after toggles */
+    bool subgoalStale = false;
+    Cpd* cpd = NULL;                /* one Dijkstra per cell: built on the first CPD run, rebuilt after toggles */
+    bool cpdStale = false;
+    RsrMap* rsrMap = NULL;          /* built on the first RSR run, rebuilt after toggles */
+    bool rsrStale = false;
+    BlockDatabase* blockDatabase = NULL;    /* map independent: built once, on first use */
+    DStarLite* dstarLite = NULL;    /* kept between runs, the next run repairs the toggles */
+    bool dstarLiteStale = false;
+    RtaaAgent* rtaaAgent = NULL;    /* learns its heuristic over the runs to the same TARGET */
+    bool rtaaStale = false;
+    int rtaaLookahead = RTAA_LOOKAHEAD;
+    int openListIdx = OPENLIST_HEAP;
+    const char* openListNames[] = {"Indexed 4-ary heap", "std::set (legacy)", "Bucket queue"};
+    int tieBreakingIdx = TIE_HIGH_G;
+    const char* tieBreakingNames[] = {"Prefer high g", "Prefer low h", "LIFO"};
+    int heuristicIdx = HEURISTIC_OCTILE;
+    const char* heuristicNames[] = {"Octile", "ALT landmarks"};
+    AltTable* altTable = NULL;      /* built on the first ALT run */
+    bool altStale = false;
+    bool goalBounding = false;      /* prune the moves of A* and JPS with goalBounds */
+    GoalBoundTable* goalBounds = NULL;  /* built on the first run with pruning, rebuilt after toggles */
+    bool goalBoundsStale = false;
+    bool swampPruning = false;      /* A* skips the dead-ends holding neither SOURCE nor TARGET */
+    SwampMap* swamps = NULL;        /* built on the first run with pruning, rebuilt after toggles */
+    bool swampsStale = false;
+    int numThreads = 1;             /* worker threads of the parallel engines */
+    float araWeight = ARA_INITIAL_WEIGHT;
+    int araBudget = 0;              /* milliseconds, 0: improve until optimal */
     resultMsg[0] = 0;
 
     windowSize.nrow = nrow;
@@ -181,6 +240,22 @@ int main(int argc, char** argv)
 
                     if (ImGui::Selectable(name, true, ImGuiSelectableFlags_None, ImVec2(blockSize, blockSize)))
                     {
+                        /*
+                         * D* Lite is made to replan after a change: toggling a cell once its run is done
+                         * clears the run and lets EXECUTE repair the previous plan.
+                         */
+                        if ((t_state == THREAD_FINISHED || t_state == THREAD_EXITED) &&
+                            algorithmIdx == ALGO_DSTAR_LITE && choosingOpt == CHOOSE_BLOCKED_UNBLOCKED)
+                        {
+                            pthread_mutex_lock(&mutex);
+                            if (t_state == THREAD_FINISHED)
+                                pthread_join(thread_id, NULL);
+                            t_state = THREAD_INITIALIZED;
+                            for (int i = 0; i < windowSize.nrow * windowSize.ncol; i++)
+                                if (labels[i] != LBL_BLOCKED) labels[i] = LBL_UNBLOCKED;
+                            pthread_mutex_unlock(&mutex);
+                            resultMsg[0] = 0;
+                        }
                         /* Once the previous execution finish, we forbid modify block state by clicking on them */
                         if (t_state == THREAD_FINISHED ||
                             t_state == THREAD_EXITED)
@@ -204,6 +279,30 @@ int main(int argc, char** argv)
                                     break;
                                 case CHOOSE_BLOCKED_UNBLOCKED:
                                     labels[idx] = (BlockLabels) (LBL_BLOCKED + LBL_UNBLOCKED - (int)labels[idx]);
+                                    /* A running search may be reading the table: only patch it while idle */
+                                    if (jpsPlus && t_state == THREAD_INITIALIZED)
+                                        jpsPlusToggleCell(jpsPlus, labels, idx);
+                                    else
+                                        jpsPlusStale = true;
+                                    if (hpa && t_state == THREAD_INITIALIZED)
+                                        hpaToggleCell(hpa, labels, idx);
+                                    else
+                                        hpaStale = true;
+                                    subgoalStale = true;
+                                    cpdStale = true;
+                                    rsrStale = true;
+                                    goalBoundsStale = true;
+                                    swampsStale = true;
+                                    if (dstarLite && t_state == THREAD_INITIALIZED)
+                                        dstarLiteToggleCell(dstarLite, labels, idx);
+                                    else
+                                        dstarLiteStale = true;
+                                    /* A new wall only makes distances longer: landmark bounds and learned h still hold */
+                                    if (labels[idx] == LBL_UNBLOCKED)
+                                    {
+                                        altStale = true;
+                                        rtaaStale = true;
+                                    }
                                     if (idx == sourceIdx)
                                         sourceIdx = -1;
                                     else if (idx == targetIdx)
@@ -265,11 +364,14 @@ int main(int argc, char** argv)
             if (t_state == THREAD_FINISHED ||
                 t_state == THREAD_EXITED)
             {
-                if (shared.listCell != NULL)
+                if (shared.result.pathLen > 0)
                 {
                     /* print the path from TARGET to SOURCE */
-                    endExec(shared.listCell, windowSize);
-                    sprintf(resultMsg, "\tEXECUTION DONE.\t");
+                    endExec(&shared.result, windowSize);
+                    if (shared.result.suboptimality > 1.0f)
+                        sprintf(resultMsg, "\tDONE, cost <= %.2f x optimal.\t", shared.result.suboptimality);
+                    else
+                        sprintf(resultMsg, "\tEXECUTION DONE.\t");
                 }
                 else
                     sprintf(resultMsg, "\tNOT FOUND ANY DIRECTION.\t");
@@ -285,6 +387,16 @@ int main(int argc, char** argv)
                 pthread_mutex_lock(&mutex);
                 t_state = THREAD_INITIALIZED;
                 initLabels(&labels, &windowSize);
+                jpsPlusStale = true;
+                hpaStale = true;
+                subgoalStale = true;
+                cpdStale = true;
+                rsrStale = true;
+                goalBoundsStale = true;
+                swampsStale = true;
+                dstarLiteStale = true;
+                altStale = true;
+                rtaaStale = true;
                 pthread_mutex_unlock(&mutex);
                 resultMsg[0] = 0;
                 show_warning_init_new_state = false;
@@ -349,6 +461,16 @@ int main(int argc, char** argv)
                                     pthread_mutex_unlock(&mutex);
                                 }
                             RandomGrid(&labels, &windowSize, blockedRatio);
+                            jpsPlusStale = true;
+                            hpaStale = true;
+                            subgoalStale = true;
+                            cpdStale = true;
+                            rsrStale = true;
+                            goalBoundsStale = true;
+                            swampsStale = true;
+                            dstarLiteStale = true;
+                            altStale = true;
+                            rtaaStale = true;
                         show_config_window = false;
                         }
                     show_warning_init_new_state = false;
@@ -366,12 +488,94 @@ int main(int argc, char** argv)
             if (ImGui::Button("EXECUTE", BUTTON_SIZE) &&
                 t_state == THREAD_INITIALIZED)
             {
+                if (algorithmIdx == ALGO_JPS_PLUS && (jpsPlus == NULL || jpsPlusStale))
+                {
+                    jpsPlusFree(jpsPlus);
+                    jpsPlus = jpsPlusBuild(labels, windowSize);
+                    jpsPlusStale = false;
+                }
+                if (algorithmIdx == ALGO_HPA && (hpa == NULL || hpaStale))
+                {
+                    hpaFree(hpa);
+                    hpa = hpaBuild(labels, windowSize, HPA_CLUSTER_SIZE);
+                    hpaStale = false;
+                }
+                if (algorithmIdx == ALGO_SUBGOAL && (subgoalGraph == NULL || subgoalStale))
+                {
+                    subgoalFree(subgoalGraph);
+                    subgoalGraph = subgoalBuild(labels, windowSize);
+                    subgoalStale = false;
+                }
+                if (algorithmIdx == ALGO_CPD && (cpd == NULL || cpdStale))
+                {
+                    cpdFree(cpd);
+                    cpd = cpdBuild(labels, windowSize, numThreads);
+                    cpdStale = false;
+                }
+                if (algorithmIdx == ALGO_RSR && (rsrMap == NULL || rsrStale))
+                {
+                    rsrFree(rsrMap);
+                    rsrMap = rsrBuild(labels, windowSize);
+                    rsrStale = false;
+                }
+                if (algorithmIdx == ALGO_BLOCK_ASTAR && blockDatabase == NULL)
+                    blockDatabase = blockDatabaseBuild();
+                if (algorithmIdx == ALGO_DSTAR_LITE && (dstarLite == NULL || dstarLiteStale))
+                {
+                    dstarLiteFree(dstarLite);
+                    dstarLite = dstarLiteCreate(windowSize);
+                    dstarLiteStale = false;
+                }
+                if (algorithmIdx == ALGO_RTAA && (rtaaAgent == NULL || rtaaStale))
+                {
+                    rtaaFree(rtaaAgent);
+                    rtaaAgent = rtaaCreate(windowSize, rtaaLookahead);
+                    rtaaStale = false;
+                }
+                if (rtaaAgent)
+                    rtaaAgent->lookahead = rtaaLookahead;
+                if (heuristicIdx == HEURISTIC_ALT && (altTable == NULL || altStale))
+                {
+                    altFree(altTable);
+                    altTable = altBuild(labels, windowSize, ALT_NUM_LANDMARKS, LANDMARK_FARTHEST, numThreads);
+                    altStale = false;
+                }
+                if (goalBounding && (goalBounds == NULL || goalBoundsStale))
+                {
+                    goalBoundFree(goalBounds);
+                    goalBounds = goalBoundBuild(labels, windowSize, numThreads);
+                    goalBoundsStale = false;
+                }
+                if (swampPruning && (swamps == NULL || swampsStale))
+                {
+                    swampFree(swamps);
+                    swamps = swampBuild(labels, windowSize);
+                    swampsStale = false;
+                }
+                shared.preprocessed = (algorithmIdx == ALGO_JPS_PLUS) ? (const void*) jpsPlus :
+                                      (algorithmIdx == ALGO_HPA) ? (const void*) hpa :
+                                      (algorithmIdx == ALGO_BLOCK_ASTAR) ? (const void*) blockDatabase :
+                                      (algorithmIdx == ALGO_DSTAR_LITE) ? (const void*) dstarLite :
+                                      (algorithmIdx == ALGO_RTAA) ? (const void*) rtaaAgent :
+                                      (algorithmIdx == ALGO_SUBGOAL) ? (const void*) subgoalGraph :
+                                      (algorithmIdx == ALGO_CPD) ? (const void*) cpd :
+                                      (algorithmIdx == ALGO_RSR) ? (const void*) rsrMap : NULL;
                 shared.labels = labels;
                 shared.windowSize.nrow = windowSize.nrow;
                 shared.windowSize.ncol = windowSize.ncol;
                 t_state = THREAD_RUNNING;
                 shared.state = &t_state;
-                shared.listCell = NULL;
+                shared.algorithm = (SearchAlgorithm) algorithmIdx;
+                shared.openList = (OpenListKind) openListIdx;
+                shared.tieBreaking = (TieBreaking) tieBreakingIdx;
+                shared.heuristic = (HeuristicKind) heuristicIdx;
+                shared.landmarks = altTable;
+                shared.goalBounds = goalBounding ? goalBounds : NULL;
+                shared.swamps = swampPruning ? swamps : NULL;
+                shared.numThreads = numThreads;
+                shared.weight = araWeight;
+                shared.timeBudget = araBudget * 1000L;
+                freeSearchResult(&shared.result);
                 int err = pthread_create(&thread_id,
                                          NULL,
                                          execAStar,
@@ -412,6 +616,16 @@ int main(int argc, char** argv)
         }
         /* Continuously parse a float from slider in range of 0.1f to 500.0f */
         ImGui::SliderFloat("Steps/sec", &stepPerSecs, 0.1f, 500.0f);
+        ImGui::Combo("Algorithm", &algorithmIdx, algorithmNames, IM_ARRAYSIZE(algorithmNames));
+        ImGui::Combo("Open list", &openListIdx, openListNames, IM_ARRAYSIZE(openListNames));
+        ImGui::Combo("Tie breaking", &tieBreakingIdx, tieBreakingNames, IM_ARRAYSIZE(tieBreakingNames));
+        ImGui::Combo("Heuristic", &heuristicIdx, heuristicNames, IM_ARRAYSIZE(heuristicNames));
+        ImGui::Checkbox("Goal bounding", &goalBounding);
+        ImGui::Checkbox("Dead-end pruning", &swampPruning);
+        ImGui::SliderInt("Threads", &numThreads, 1, 8);
+        ImGui::SliderFloat("ARA* weight", &araWeight, 1.0f, 5.0f);
+        ImGui::SliderInt("ARA* budget (ms)", &araBudget, 0, 5000);
+        ImGui::SliderInt("RTAA* lookahead", &rtaaLookahead, 1, 1024);
 
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
         ImGui::End();
@@ -442,6 +656,18 @@ int main(int argc, char** argv)
     }
 
     // Cleanup
+    freeSearchResult(&shared.result);
+    jpsPlusFree(jpsPlus);
+    hpaFree(hpa);
+    blockDatabaseFree(blockDatabase);
+    dstarLiteFree(dstarLite);
+    altFree(altTable);
+    goalBoundFree(goalBounds);
+    swampFree(swamps);
+    rtaaFree(rtaaAgent);
+    subgoalFree(subgoalGraph);
+    cpdFree(cpd);
+    rsrFree(rsrMap);
     ImGui_ImplOpenGL2_Shutdown();
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
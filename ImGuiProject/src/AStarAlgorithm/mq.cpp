@@ -0,0 +1,387 @@
+#include <float.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "mq.hpp"
+
+
+/*
+ * All workers share one array of g values, each cell's g being a packed
+ * OctileCost updated by compare-and-swap: a successor is queued only by the
+ * worker whose CAS lowered its g. Heaps keep duplicates instead of doing a
+ * decrease-key; an entry whose key is larger than the current f of its cell
+ * is stale and dropped when popped.
+ *
+ * The best cost of TARGET so far is its own g; entries and successors whose
+ * f is not below it are dropped. `work` counts the queued entries plus the
+ * expansions in progress: a push adds one, and an entry removes its one when
+ * it is dropped or its expansion (including all of its pushes) is complete.
+ * When `work` reaches 0 nothing is left to produce new entries, and every
+ * entry with f below the final g of TARGET was expanded with the g it was
+ * queued with, so that g is optimal.
+ *
+ * Since g is updated without the `prev` link, which a CAS could not keep in
+ * step with it, the path is rebuilt afterwards by storeDescentPath().
+ */
+
+#define UNREACHED               UINT64_MAX
+
+/* One heap of the MultiQueue, with its lock and the key of its top entry */
+typedef struct MqHeap
+{
+    std::atomic<bool>   locked;
+    std::atomic<float>  topKey;         /* FLT_MAX when empty            */
+    HeapEntry          *entries;        /* 4-ary min-heap of `size`      */
+    int                 size;
+    int                 capacity;
+    unsigned int        stamp;
+    char                padding[64];
+} MqHeap;
+
+typedef struct MqSearch
+{
+    const SearchQuery      *query;
+    std::atomic<uint64_t>  *steps;      /* g of each cell, UNREACHED if none */
+    MqHeap                 *heaps;
+    int                     numHeaps;
+    std::atomic<long>       work;
+    std::atomic<bool>       stop;       /* aborted by the observer           */
+} MqSearch;
+
+typedef struct MqWorker
+{
+    MqSearch               *search;
+    unsigned int            random;     /* xorshift state                     */
+    SearchStats             stats;
+    char                    padding[64];
+} MqWorker;
+
+static inline unsigned int nextRandom(MqWorker* worker)
+{
+    unsigned int x = worker->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    worker->random = x;
+    return x;
+}
+
+static bool tryLock(MqHeap* heap)
+{
+    return !heap->locked.load(std::memory_order_relaxed) &&
+           !heap->locked.exchange(true, std::memory_order_acquire);
+}
+
+static void unlock(MqHeap* heap)
+{
+    heap->topKey.store((heap->size > 0) ? heap->entries[0].key : FLT_MAX, std::memory_order_relaxed);
+    heap->locked.store(false, std::memory_order_release);
+}
+
+static void heapPush(MqHeap* heap, float key, float tie, int idx)
+{
+    HeapEntry entry = {key, tie, heap->stamp++, idx};
+    int slot = heap->size++;
+
+    if (heap->size > heap->capacity)
+    {
+        heap->capacity = MAX2(2 * heap->capacity, 64);
+        heap->entries = (HeapEntry*) realloc(heap->entries, heap->capacity * sizeof(HeapEntry));
+    }
+    while (slot > 0)
+    {
+        int parent = (slot - 1) / HEAP_ARITY;
+        if (!entryLess(entry, heap->entries[parent]))
+            break;
+        heap->entries[slot] = heap->entries[parent];
+        slot = parent;
+    }
+    heap->entries[slot] = entry;
+}
+
+static HeapEntry heapPop(MqHeap* heap)
+{
+    HeapEntry top = heap->entries[0], entry;
+    int slot = 0;
+
+    entry = heap->entries[--heap->size];
+    while (heap->size > 0)
+    {
+        int child, best, first = slot * HEAP_ARITY + 1;
+        int last = MIN2(first + HEAP_ARITY, heap->size);
+
+        if (first >= heap->size)
+            break;
+        best = first;
+        for (child = first + 1; child < last; child++)
+            if (entryLess(heap->entries[child], heap->entries[best]))
+                best = child;
+        if (!entryLess(heap->entries[best], entry))
+            break;
+        heap->entries[slot] = heap->entries[best];
+        slot = best;
+    }
+    if (heap->size > 0)
+        heap->entries[slot] = entry;
+    return top;
+}
+
+static void mqPush(MqWorker* worker, float key, float tie, int idx)
+{
+    MqSearch* search = worker->search;
+    MqHeap* heap;
+
+    search->work++;
+    do
+        heap = &search->heaps[nextRandom(worker) % search->numHeaps];
+    while (!tryLock(heap));
+    heapPush(heap, key, tie, idx);
+    unlock(heap);
+}
+
+/* Pop from the better of two random heaps. Returns false if none was found. */
+static bool mqPop(MqWorker* worker, HeapEntry* entry)
+{
+    MqSearch* search = worker->search;
+    int attempt, h;
+
+    for (attempt = 0; attempt < 4; attempt++)
+    {
+        MqHeap* a = &search->heaps[nextRandom(worker) % search->numHeaps];
+        MqHeap* b = &search->heaps[nextRandom(worker) % search->numHeaps];
+        MqHeap* heap = (b->topKey < a->topKey) ? b : a;
+
+        if (heap->topKey == FLT_MAX || !tryLock(heap))
+            continue;
+        if (heap->size > 0)
+        {
+            *entry = heapPop(heap);
+            unlock(heap);
+            return true;
+        }
+        unlock(heap);
+    }
+
+    /* Few entries left: look at every heap before giving up */
+    for (h = 0; h < search->numHeaps; h++)
+    {
+        MqHeap* heap = &search->heaps[h];
+        if (heap->topKey == FLT_MAX || !tryLock(heap))
+            continue;
+        if (heap->size > 0)
+        {
+            *entry = heapPop(heap);
+            unlock(heap);
+            return true;
+        }
+        unlock(heap);
+    }
+    return false;
+}
+
+static inline float bestTargetCost(MqSearch* search)
+{
+    uint64_t packed = search->steps[search->query->targetIdx].load(std::memory_order_relaxed);
+    return (packed == UNREACHED) ? FLT_MAX : octileValue(unpackSteps(packed));
+}
+
+static inline float fValue(OctileCost steps, int idx, const SearchQuery* query)
+{
+    OctileCost total = octileDistance(idx, query->targetIdx, query->grid.ncol);
+    total.straight += steps.straight;
+    total.diagonal += steps.diagonal;
+    return octileValue(total);
+}
+
+/* Expand the cell of `entry` unless it is stale. Returns false if the observer aborts. */
+static bool expandEntry(MqWorker* worker, const HeapEntry* entry)
+{
+    MqSearch* search = worker->search;
+    const SearchQuery* query = search->query;
+    Grid windowSize = query->grid;
+    int padx, pady, mainX, mainY, mainCellIdx = entry->idx;
+    OctileCost mainSteps = unpackSteps(search->steps[mainCellIdx].load());
+
+    if (fValue(mainSteps, mainCellIdx, query) < entry->key || entry->key >= bestTargetCost(search))
+        return true;
+
+    if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITING))
+        return false;
+    worker->stats.expanded++;
+
+    mainX = mainCellIdx % windowSize.ncol;
+    mainY = mainCellIdx / windowSize.ncol;
+
+    for (pady = -1; pady <= 1; pady++)
+    {
+        for (padx = -1; padx <= 1; padx++)
+        {
+            OctileCost steps;
+            uint64_t current;
+            float successor_f, successor_g;
+            int successorIdx;
+
+            if (mainX + padx < 0 || mainX + padx >= windowSize.ncol ||
+                mainY + pady < 0 || mainY + pady >= windowSize.nrow)
+                continue;
+
+            successorIdx = mainCellIdx + padx + pady * windowSize.ncol;
+            if (query->labels[successorIdx] == LBL_BLOCKED || successorIdx == query->sourceIdx)
+                continue;
+
+            steps = mainSteps;
+            if (padx != 0 && pady != 0)
+                steps.diagonal++;
+            else
+                steps.straight++;
+            successor_g = octileValue(steps);
+            successor_f = fValue(steps, successorIdx, query);
+            if (successor_f >= bestTargetCost(search))
+                continue;
+
+            /* Lower the shared g, unless another worker got there first with a better one */
+            current = search->steps[successorIdx].load();
+            do
+            {
+                if (current != UNREACHED && octileValue(unpackSteps(current)) <= successor_g)
+                    break;
+            }
+            while (!search->steps[successorIdx].compare_exchange_weak(current, packSteps(steps)));
+            if (current != UNREACHED && octileValue(unpackSteps(current)) <= successor_g)
+                continue;
+
+            /* TARGET is never expanded, its g is the incumbent */
+            if (successorIdx == query->targetIdx)
+                continue;
+
+            mqPush(worker, successor_f, tieBreakValue(query->tieBreaking, successor_g,
+                                                      successor_f - successor_g), successorIdx);
+            worker->stats.generated++;
+            worker->stats.maxOpenSize = MAX2(worker->stats.maxOpenSize, search->work.load());
+
+            if (NOTIFY_OBSERVER(query, successorIdx, LBL_TOBEVISITED))
+                return false;
+        }
+    }
+
+    return !NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITED);
+}
+
+static void* mqWorker(void* arg)
+{
+    MqWorker* worker = (MqWorker*) arg;
+    MqSearch* search = worker->search;
+    HeapEntry entry;
+
+    while (!search->stop)
+    {
+        if (mqPop(worker, &entry))
+        {
+            if (!expandEntry(worker, &entry))
+                search->stop = true;
+            search->work--;
+            continue;
+        }
+        if (search->work == 0)
+            break;
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+/*
+ * MultiQueue A* on query->numThreads workers (never more than the online
+ * cores: a worker preempted while holding a heap would stall the pops of
+ * the others). query->openList does not apply, the heaps are built in.
+ */
+SearchStatus multiQueueSearch(const SearchQuery *query, SearchResult *result)
+{
+    MqSearch search;
+    MqWorker* workers;
+    pthread_t* threads;
+    SearchStatus status = SEARCH_NOT_FOUND;
+    int i, numStarted, numElement = query->grid.nrow * query->grid.ncol;
+    int numWorkers = MAX2(query->numThreads, 1);
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    OctileCost zero = {0, 0};
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+    if (numCores > 0)
+        numWorkers = MIN2(numWorkers, (int) numCores);
+
+    search.query = query;
+    search.steps = new std::atomic<uint64_t>[numElement];
+    search.numHeaps = MQ_FACTOR * numWorkers;
+    search.heaps = new MqHeap[search.numHeaps];
+    search.work = 0;
+    search.stop = false;
+    for (i = 0; i < numElement; i++)
+        search.steps[i].store(UNREACHED, std::memory_order_relaxed);
+    for (i = 0; i < search.numHeaps; i++)
+    {
+        search.heaps[i].locked = false;
+        search.heaps[i].topKey = FLT_MAX;
+        search.heaps[i].entries = NULL;
+        search.heaps[i].size = 0;
+        search.heaps[i].capacity = 0;
+        search.heaps[i].stamp = 0;
+    }
+
+    workers = (MqWorker*) calloc(numWorkers, sizeof(MqWorker));
+    threads = (pthread_t*) malloc(numWorkers * sizeof(pthread_t));
+    for (i = 0; i < numWorkers; i++)
+    {
+        workers[i].search = &search;
+        workers[i].random = 2463534242u + 7919u * i;
+    }
+
+    search.steps[query->sourceIdx] = packSteps(zero);
+    if (query->sourceIdx != query->targetIdx)
+        mqPush(&workers[0], fValue(zero, query->sourceIdx, query), 0.0f, query->sourceIdx);
+
+    for (numStarted = 1; numStarted < numWorkers; numStarted++)
+        if (pthread_create(&threads[numStarted], NULL, mqWorker, &workers[numStarted]) != 0)
+            break;
+    mqWorker(&workers[0]);
+    for (i = 1; i < numStarted; i++)
+        pthread_join(threads[i], NULL);
+
+    if (search.stop)
+        status = SEARCH_ABORTED;
+    else if (bestTargetCost(&search) < FLT_MAX)
+    {
+        float* distance = (float*) malloc(numElement * sizeof(float));
+        for (i = 0; i < numElement; i++)
+        {
+            uint64_t packed = search.steps[i].load(std::memory_order_relaxed);
+            distance[i] = (packed == UNREACHED) ? FLT_MAX : octileValue(unpackSteps(packed));
+        }
+        storeDescentPath(query, distance, result);
+        free(distance);
+        status = SEARCH_FOUND;
+    }
+
+    for (i = 0; i < numWorkers; i++)
+    {
+        result->stats.expanded    += workers[i].stats.expanded;
+        result->stats.generated   += workers[i].stats.generated;
+        result->stats.maxOpenSize  = MAX2(result->stats.maxOpenSize, workers[i].stats.maxOpenSize);
+    }
+    for (i = 0; i < search.numHeaps; i++)
+        free(search.heaps[i].entries);
+    delete[] search.heaps;
+    delete[] search.steps;
+    free(threads);
+    free(workers);
+
+    return status;
+}
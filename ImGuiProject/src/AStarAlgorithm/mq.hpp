@@ -0,0 +1,14 @@
+/*
+ * Parallel A* on a MultiQueue (Rihani, Sanders & Dementiev, 2015): the open
+ * list is MQ_FACTOR * numThreads sequential heaps, each behind a try-lock.
+ * A push goes to a random heap, a pop takes the better top of two random
+ * heaps, so the workers almost never wait on each other and the cells popped
+ * are close to, though not exactly, the global best ones.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+#define MQ_FACTOR               2
+
+SearchStatus multiQueueSearch(const SearchQuery *query, SearchResult *result);
@@ -0,0 +1,368 @@
+#include <float.h>
+#include <stdlib.h>
+#include <set>
+
+#include "openlist.hpp"
+
+
+struct HeapEntryOrder
+{
+    bool operator()(const HeapEntry& a, const HeapEntry& b) const
+    {
+        return entryLess(a, b);
+    }
+};
+
+typedef std::set<HeapEntry, HeapEntryOrder> EntrySet;
+
+
+/*
+ * OPENLIST_HEAP: position-indexed 4-ary min-heap.
+ * `entries[0..size)` is the heap, `position[idx]` tells where cell `idx` sits
+ * in it so that a queued cell can be found and moved up in O(log n).
+ */
+static void heapPlace(OpenList* list, int slot, HeapEntry entry)
+{
+    list->entries[slot] = entry;
+    list->position[entry.idx] = slot;
+}
+
+static void heapSiftUp(OpenList* list, int slot)
+{
+    HeapEntry entry = list->entries[slot];
+
+    while (slot > 0)
+    {
+        int parent = (slot - 1) / HEAP_ARITY;
+        if (!entryLess(entry, list->entries[parent]))
+            break;
+        heapPlace(list, slot, list->entries[parent]);
+        slot = parent;
+    }
+    heapPlace(list, slot, entry);
+}
+
+static void heapSiftDown(OpenList* list, int slot)
+{
+    HeapEntry entry = list->entries[slot];
+
+    while (true)
+    {
+        int child, best, first = slot * HEAP_ARITY + 1;
+        int last = MIN2(first + HEAP_ARITY, list->size);
+
+        if (first >= list->size)
+            break;
+        best = first;
+        for (child = first + 1; child < last; child++)
+            if (entryLess(list->entries[child], list->entries[best]))
+                best = child;
+        if (!entryLess(list->entries[best], entry))
+            break;
+        heapPlace(list, slot, list->entries[best]);
+        slot = best;
+    }
+    heapPlace(list, slot, entry);
+}
+
+/*
+ * OPENLIST_BUCKET: circular array of buckets over the integer keys
+ * round(key * BUCKET_SCALE). Queued keys always lie in [cursor, maxKey] and
+ * that window never covers more than `numBuckets` keys, so bucket `k & mask`
+ * holds key `k` only. Push is O(1); pop moves `cursor` forward over empty
+ * buckets, which is O(1) amortized as long as keys popped are monotone (A*
+ * with a consistent heuristic); a smaller key just moves the cursor back.
+ */
+static long bucketKey(float key)
+{
+    return (long) ((double) key * BUCKET_SCALE + 0.5);
+}
+
+static void bucketInsert(OpenList* list, int idx, long k)
+{
+    int* head = &list->bucketHead[k & (list->numBuckets - 1)];
+
+    list->link[2 * idx]     = *head;
+    list->link[2 * idx + 1] = -1;
+    if (*head != -1)
+        list->link[2 * *head + 1] = idx;
+    *head = idx;
+}
+
+static void bucketRemove(OpenList* list, int idx, long k)
+{
+    int next = list->link[2 * idx], prev = list->link[2 * idx + 1];
+
+    if (prev != -1)
+        list->link[2 * prev] = next;
+    else
+        list->bucketHead[k & (list->numBuckets - 1)] = next;
+    if (next != -1)
+        list->link[2 * next + 1] = prev;
+}
+
+/* Make room for `span` consecutive keys, re-hashing every queued cell */
+static void bucketGrow(OpenList* list, long span)
+{
+    int b, idx, oldNumBuckets = list->numBuckets;
+    int* oldHead = list->bucketHead;
+
+    while (list->numBuckets < span)
+        list->numBuckets *= 2;
+    list->bucketHead = (int*) malloc(list->numBuckets * sizeof(int));
+    for (b = 0; b < list->numBuckets; b++)
+        list->bucketHead[b] = -1;
+
+    for (b = 0; b < oldNumBuckets; b++)
+    {
+        idx = oldHead[b];
+        while (idx != -1)
+        {
+            int next = list->link[2 * idx];
+            bucketInsert(list, idx, bucketKey(list->entries[idx].key));
+            idx = next;
+        }
+    }
+    free(oldHead);
+}
+
+static void bucketPush(OpenList* list, HeapEntry entry)
+{
+    int idx = entry.idx;
+    long k = bucketKey(entry.key);
+
+    if (list->position[idx] != -1)
+    {
+        bucketRemove(list, idx, bucketKey(list->entries[idx].key));
+        list->size--;
+    }
+
+    if (list->size == 0)
+    {
+        list->cursor = k;
+        list->maxKey = k;
+    }
+    else
+    {
+        long low = MIN2(list->cursor, k), high = MAX2(list->maxKey, k);
+        if (high - low >= list->numBuckets)
+            bucketGrow(list, high - low + 1);
+        list->cursor = low;
+        list->maxKey = high;
+    }
+
+    bucketInsert(list, idx, k);
+    list->entries[idx] = entry;
+    list->position[idx] = 1;
+    list->size++;
+}
+
+static int bucketPop(OpenList* list)
+{
+    int idx, mask = list->numBuckets - 1;
+
+    while (list->bucketHead[list->cursor & mask] == -1)
+        list->cursor++;
+
+    idx = list->bucketHead[list->cursor & mask];
+    bucketRemove(list, idx, list->cursor);
+    list->position[idx] = -1;
+    list->size--;
+    return idx;
+}
+
+void openListInit(OpenList* list, OpenListKind kind, int numElement)
+{
+    int i;
+
+    list->kind     = kind;
+    list->size     = 0;
+    list->position = (int*) malloc(numElement * sizeof(int));
+    list->entries  = (HeapEntry*) malloc(numElement * sizeof(HeapEntry));
+    list->set      = (kind == OPENLIST_SET) ? new EntrySet() : NULL;
+    list->stamp    = 0;
+    list->bucketHead = NULL;
+    list->link       = NULL;
+    list->numBuckets = 0;
+    list->cursor     = 0;
+    list->maxKey     = 0;
+
+    for (i = 0; i < numElement; i++)
+        list->position[i] = -1;
+
+    if (kind == OPENLIST_BUCKET)
+    {
+        list->numBuckets = 1;
+        list->link = (int*) malloc(2 * numElement * sizeof(int));
+        list->bucketHead = (int*) malloc(sizeof(int));
+        list->bucketHead[0] = -1;
+        bucketGrow(list, (long) (BUCKET_SPAN * BUCKET_SCALE) + 1);
+    }
+}
+
+void openListFree(OpenList* list)
+{
+    free(list->position);
+    free(list->entries);
+    delete (EntrySet*) list->set;
+    free(list->bucketHead);
+    free(list->link);
+    list->bucketHead = NULL;
+    list->link     = NULL;
+    list->position = NULL;
+    list->entries  = NULL;
+    list->set      = NULL;
+}
+
+/*
+ * Queue `idx` with `key`, or replace its entry if it is already queued.
+ * The caller only re-pushes a cell when its g got smaller.
+ */
+void openListPush(OpenList* list, int idx, float key, float tie)
+{
+    HeapEntry entry = {key, tie, list->stamp++, idx};
+
+    if (list->kind == OPENLIST_BUCKET)
+    {
+        bucketPush(list, entry);
+        return;
+    }
+
+    if (list->kind == OPENLIST_SET)
+    {
+        /*
+         * The key of an element must not change while it is inside the set:
+         * take the old entry out first. `entries` is indexed by cell here.
+         */
+        EntrySet* set = (EntrySet*) list->set;
+        if (list->position[idx] != -1)
+        {
+            set->erase(list->entries[idx]);
+            list->size--;
+        }
+        set->insert(entry);
+        list->entries[idx] = entry;
+        list->position[idx] = 1;
+        list->size++;
+        return;
+    }
+
+    if (list->position[idx] != -1)
+    {
+        /* The new entry may sort either way once the tie changes */
+        int slot = list->position[idx];
+        list->entries[slot] = entry;
+        heapSiftUp(list, slot);
+        heapSiftDown(list, list->position[idx]);
+        return;
+    }
+
+    heapPlace(list, list->size, entry);
+    list->size++;
+    heapSiftUp(list, list->size - 1);
+}
+
+/* Remove and return the cell with the smallest key, -1 if the list is empty. */
+int openListPop(OpenList* list)
+{
+    int idx;
+
+    if (list->size == 0)
+        return -1;
+
+    if (list->kind == OPENLIST_BUCKET)
+        return bucketPop(list);
+
+    if (list->kind == OPENLIST_SET)
+    {
+        EntrySet* set = (EntrySet*) list->set;
+        idx = set->begin()->idx;
+        set->erase(set->begin());
+        list->position[idx] = -1;
+        list->size--;
+        return idx;
+    }
+
+    idx = list->entries[0].idx;
+    list->position[idx] = -1;
+    list->size--;
+    if (list->size > 0)
+    {
+        heapPlace(list, 0, list->entries[list->size]);
+        heapSiftDown(list, 0);
+    }
+    return idx;
+}
+
+/* Smallest key of the list (without removing it), FLT_MAX if the list is empty. */
+float openListTopKey(OpenList* list)
+{
+    if (list->size == 0)
+        return FLT_MAX;
+
+    if (list->kind == OPENLIST_BUCKET)
+    {
+        int mask = list->numBuckets - 1;
+        while (list->bucketHead[list->cursor & mask] == -1)
+            list->cursor++;
+        return list->entries[list->bucketHead[list->cursor & mask]].key;
+    }
+
+    if (list->kind == OPENLIST_SET)
+        return ((EntrySet*) list->set)->begin()->key;
+
+    return list->entries[0].key;
+}
+
+/*
+ * Cell with the smallest key (without removing it), -1 if the list is empty.
+ * Its key and tie are stored in `key` / `tie`.
+ */
+int openListTop(OpenList* list, float* key, float* tie)
+{
+    HeapEntry entry;
+
+    if (list->size == 0)
+        return -1;
+
+    if (list->kind == OPENLIST_BUCKET)
+    {
+        int mask = list->numBuckets - 1;
+        while (list->bucketHead[list->cursor & mask] == -1)
+            list->cursor++;
+        entry = list->entries[list->bucketHead[list->cursor & mask]];
+    }
+    else if (list->kind == OPENLIST_SET)
+        entry = *((EntrySet*) list->set)->begin();
+    else
+        entry = list->entries[0];
+
+    *key = entry.key;
+    *tie = entry.tie;
+    return entry.idx;
+}
+
+/* Take `idx` out of the list; nothing happens if it is not queued. */
+void openListRemove(OpenList* list, int idx)
+{
+    int slot = list->position[idx];
+
+    if (slot == -1)
+        return;
+
+    if (list->kind == OPENLIST_BUCKET)
+        bucketRemove(list, idx, bucketKey(list->entries[idx].key));
+    else if (list->kind == OPENLIST_SET)
+        ((EntrySet*) list->set)->erase(list->entries[idx]);
+    list->position[idx] = -1;
+    list->size--;
+
+    /* Heap: the last entry fills the hole and may have to go either way */
+    if (list->kind == OPENLIST_HEAP && slot < list->size)
+    {
+        HeapEntry last = list->entries[list->size];
+        heapPlace(list, slot, last);
+        heapSiftUp(list, slot);
+        heapSiftDown(list, list->position[last.idx]);
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * Open lists of libastar. All of them hold cell indices ordered by a float
+ * key (f), and each cell is queued at most once: pushing a queued cell again
+ * replaces its entry (decrease-key), it never leaves a duplicate behind.
+ *
+ * Equal keys are ordered by `tie` (smaller first), then by `stamp`, the push
+ * counter (larger, i.e. more recent, first). The caller fills `tie` from its
+ * TieBreaking policy, so no perturbation of the key is ever needed.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+#define HEAP_ARITY              4
+
+/*
+ * OPENLIST_BUCKET quantizes keys to multiples of 1/BUCKET_SCALE. Octile
+ * costs are a + b*sqrt(2), so two different f values of a grid closer than
+ * that are practically never seen; the path found is optimal up to
+ * 1/BUCKET_SCALE. Between the smallest and the largest f of the open list
+ * there are at most 2*sqrt(2) (one step, plus the heuristic change of that
+ * step), which bounds the number of buckets in use at once.
+ */
+#define BUCKET_SCALE            4096
+#define BUCKET_SPAN             (2 * SQRT2)
+
+typedef struct HeapEntry
+{
+    float        key;
+    float        tie;
+    unsigned int stamp;
+    int          idx;
+} HeapEntry;
+
+/* Strict order of the entries: key, then tie, then the most recent push */
+static inline bool entryLess(const HeapEntry& a, const HeapEntry& b)
+{
+    if (a.key != b.key)
+        return a.key < b.key;
+    if (a.tie != b.tie)
+        return a.tie < b.tie;
+    return a.stamp > b.stamp;
+}
+
+typedef struct OpenList
+{
+    OpenListKind kind;
+    int          size;
+    int         *position;      /* slot of each cell in `entries`, -1 when not queued */
+    HeapEntry   *entries;       /* OPENLIST_HEAP: nrow*ncol slots, allocated once    */
+    void        *set;           /* OPENLIST_SET: std::set<HeapEntry>                 */
+    unsigned int stamp;         /* number of pushes so far                           */
+
+    /*
+     * OPENLIST_BUCKET: cells of one bucket are a doubly linked list in `link`.
+     * A bucket is popped from its head, so ties inside it are always LIFO.
+     */
+    int         *bucketHead;    /* first cell of each bucket, -1 if empty            */
+    int         *link;          /* next / prev cell of `idx` at 2*idx / 2*idx+1      */
+    int          numBuckets;    /* power of two, bucket of key k is k & (n-1)        */
+    long         cursor;        /* no queued key is smaller than this one            */
+    long         maxKey;        /* no queued key is larger than this one             */
+} OpenList;
+
+
+void openListInit(OpenList* list, OpenListKind kind, int numElement);
+void openListFree(OpenList* list);
+void openListPush(OpenList* list, int idx, float key, float tie);
+int openListPop(OpenList* list);
+float openListTopKey(OpenList* list);
+int openListTop(OpenList* list, float* key, float* tie);
+void openListRemove(OpenList* list, int idx);
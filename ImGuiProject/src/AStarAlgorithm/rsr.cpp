@@ -0,0 +1,317 @@
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "rsr.hpp"
+
+
+/*
+ * Why the border is enough: a move of this grid only needs its destination
+ * to be free, and every cell next to a rectangle but outside it is on its
+ * border, so a shortest path enters and leaves each rectangle through
+ * border cells (or starts / ends inside). Between two border cells p and q
+ * of one rectangle, the octile distance is reached by:
+ *
+ *  - q on the side of p: moves along that side;
+ *  - q on the opposite side, at most `depth` (the rows between the two
+ *    sides) away along it: one macro edge straight to q;
+ *  - q on the opposite side, further along: moves along the side of p,
+ *    then the macro edge of a full diagonal;
+ *  - q on a neighbouring side: the diagonal from p, or from a cell along
+ *    the side of p, that ends on that side, then moves along it.
+ *
+ * Each edge is as long as the octile distance of its ends, so A* with the
+ * octile heuristic still finds a shortest path.
+ */
+
+static inline bool isOpen(const BlockLabels* labels, const int* rectOf, Grid windowSize, int x, int y)
+{
+    return x >= 0 && x < windowSize.ncol && y >= 0 && y < windowSize.nrow &&
+           labels[x + y * windowSize.ncol] != LBL_BLOCKED && rectOf[x + y * windowSize.ncol] == -1;
+}
+
+static inline int interiorOf(int w, int h)
+{
+    return (w > 2 && h > 2) ? (w - 2) * (h - 2) : 0;
+}
+
+/*
+ * The rectangle with its top left corner at (x, y) that has the largest
+ * interior: each width is tried, with the height the columns so far allow.
+ * Without any interior the cell stays on its own, as a strip would only
+ * cut the rectangles of the rows below. Returns its width and height in
+ * *w and *h.
+ */
+static void growRect(const BlockLabels* labels, const int* rectOf, Grid windowSize, int x, int y, int* w, int* h)
+{
+    int width, height = windowSize.nrow - y, run;
+
+    *w = 1;
+    *h = 1;
+    for (width = 1; isOpen(labels, rectOf, windowSize, x + width - 1, y); width++)
+    {
+        for (run = 1; run < height && isOpen(labels, rectOf, windowSize, x + width - 1, y + run); run++)
+            ;
+        height = run;
+        if (interiorOf(width, height) > interiorOf(*w, *h))
+        {
+            *w = width;
+            *h = height;
+        }
+    }
+}
+
+/*
+ * Cells are taken in row order; each one left out so far is the top left
+ * corner of a new rectangle.
+ */
+RsrMap* rsrBuild(const BlockLabels* labels, Grid windowSize)
+{
+    int numElement = windowSize.nrow * windowSize.ncol, ncol = windowSize.ncol;
+    RsrMap* map = (RsrMap*) malloc(sizeof(RsrMap));
+    std::vector<int> rects;
+    int idx, i, j;
+
+    map->windowSize = windowSize;
+    map->numInterior = 0;
+    map->rectOf = (int*) malloc(MAX2(numElement, 1) * sizeof(int));
+    map->interior = (bool*) calloc(MAX2(numElement, 1), sizeof(bool));
+    for (idx = 0; idx < numElement; idx++)
+        map->rectOf[idx] = -1;
+
+    for (idx = 0; idx < numElement; idx++)
+    {
+        int x = idx % ncol, y = idx / ncol, w, h, rect = (int) rects.size() / 4;
+
+        if (labels[idx] == LBL_BLOCKED || map->rectOf[idx] != -1)
+            continue;
+        growRect(labels, map->rectOf, windowSize, x, y, &w, &h);
+
+        for (j = y; j < y + h; j++)
+            for (i = x; i < x + w; i++)
+            {
+                map->rectOf[i + j * ncol] = rect;
+                map->interior[i + j * ncol] = (i > x && i < x + w - 1 && j > y && j < y + h - 1);
+            }
+        rects.push_back(x);
+        rects.push_back(y);
+        rects.push_back(x + w - 1);
+        rects.push_back(y + h - 1);
+        map->numInterior += interiorOf(w, h);
+    }
+
+    map->numRects = (int) rects.size() / 4;
+    map->rects = (int*) malloc(MAX2(rects.size(), (size_t) 1) * sizeof(int));
+    if (!rects.empty())
+        memcpy(map->rects, rects.data(), rects.size() * sizeof(int));
+    return map;
+}
+
+void rsrFree(RsrMap* map)
+{
+    if (map == NULL)
+        return;
+    free(map->rectOf);
+    free(map->interior);
+    free(map->rects);
+    free(map);
+}
+
+/* Cell at `along` on a side of a rectangle that is a row (`row`) or a column */
+static inline int sideCell(bool row, int along, int across, int ncol)
+{
+    return row ? along + across * ncol : across + along * ncol;
+}
+
+/*
+ * Macro edges from the cell at `along` on the side `from` of a rectangle
+ * whose opposite side is `to`; both sides run from `low` to `high`.
+ */
+static void crossRect(bool row, int along, int from, int to, int low, int high, int ncol, std::vector<int>* out)
+{
+    int depth = ABS(to - from), step = (to > from) ? 1 : -1, a, k;
+
+    for (a = MAX2(low, along - depth); a <= MIN2(high, along + depth); a++)
+        out->push_back(sideCell(row, a, to, ncol));
+
+    /* The diagonals that end on a neighbouring side before the opposite one */
+    k = along - low;
+    if (k >= 1 && k < depth)
+        out->push_back(sideCell(row, low, from + k * step, ncol));
+    k = high - along;
+    if (k >= 1 && k < depth)
+        out->push_back(sideCell(row, high, from + k * step, ncol));
+}
+
+/* Successors of `idx`, in no particular order and maybe repeated */
+static void rsrSuccessors(const RsrMap* map, const BlockLabels* labels, int idx, int targetIdx,
+                          std::vector<int>* out)
+{
+    Grid windowSize = map->windowSize;
+    int ncol = windowSize.ncol, x = idx % ncol, y = idx / ncol, i, j;
+    const int* rect = map->rects + 4 * map->rectOf[idx];
+    int left = rect[0], top = rect[1], right = rect[2], bottom = rect[3];
+
+    if (map->rectOf[targetIdx] == map->rectOf[idx])
+        out->push_back(targetIdx);
+
+    /* Only SOURCE is expanded inside a rectangle: it reaches the whole border */
+    if (map->interior[idx])
+    {
+        for (i = left; i <= right; i++)
+        {
+            out->push_back(i + top * ncol);
+            out->push_back(i + bottom * ncol);
+        }
+        for (j = top + 1; j < bottom; j++)
+        {
+            out->push_back(left + j * ncol);
+            out->push_back(right + j * ncol);
+        }
+        return;
+    }
+
+    for (j = -1; j <= 1; j++)
+    {
+        for (i = -1; i <= 1; i++)
+        {
+            int nx = x + i, ny = y + j;
+
+            if ((i == 0 && j == 0) || nx < 0 || nx >= ncol || ny < 0 || ny >= windowSize.nrow ||
+                labels[nx + ny * ncol] == LBL_BLOCKED || map->interior[nx + ny * ncol])
+                continue;
+            out->push_back(nx + ny * ncol);
+        }
+    }
+
+    /* Without an interior, the moves above already reach every cell */
+    if (right - left < 2 || bottom - top < 2)
+        return;
+    if (y == top)
+        crossRect(true, x, top, bottom, left, right, ncol, out);
+    if (y == bottom)
+        crossRect(true, x, bottom, top, left, right, ncol, out);
+    if (x == left)
+        crossRect(false, y, left, right, top, bottom, ncol, out);
+    if (x == right)
+        crossRect(false, y, right, left, top, bottom, ncol, out);
+}
+
+/*
+ * RSR engine of findPath(), with query->preprocessed the rsrBuild() map of
+ * the grid: A* over the border cells and the macro edges between them.
+ * Paths are optimal.
+ */
+SearchStatus rsrSearch(const SearchQuery *query, SearchResult *result)
+{
+    const RsrMap* map = (const RsrMap*) query->preprocessed;
+    Grid windowSize = query->grid;
+    int numElement = windowSize.nrow * windowSize.ncol;
+    int sourceIdx = query->sourceIdx, targetIdx = query->targetIdx;
+    SearchStatus status = SEARCH_NOT_FOUND;
+    std::vector<int> successors;
+
+    Cell* listCell;
+    BlockLabels* state;         /* LBL_UNBLOCKED, LBL_TOBEVISITED or LBL_VISITED */
+    OpenList openList;
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+    if (map == NULL || map->windowSize.nrow != windowSize.nrow || map->windowSize.ncol != windowSize.ncol)
+        return SEARCH_INVALID;
+
+    listCell = initListCell(&windowSize, sourceIdx);
+    state = (BlockLabels*) calloc(numElement, sizeof(BlockLabels));
+    openListInit(&openList, query->openList, numElement);
+    successors.reserve(64);
+
+    listCell[sourceIdx].h = octileValue(octileDistance(sourceIdx, targetIdx, windowSize.ncol));
+    listCell[sourceIdx].f = listCell[sourceIdx].h;
+    openListPush(&openList, sourceIdx, listCell[sourceIdx].f, 0.0f);
+    state[sourceIdx] = LBL_TOBEVISITED;
+
+    while (openList.size > 0)
+    {
+        int mainCellIdx = openListPop(&openList), i;
+        Cell* mainCell = &listCell[mainCellIdx];
+
+        if (mainCellIdx == targetIdx)
+        {
+            storePath(listCell, targetIdx, result);
+            expandPath(result, windowSize.ncol);
+            status = SEARCH_FOUND;
+            break;
+        }
+
+        if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITING))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+        state[mainCellIdx] = LBL_VISITED;
+        result->stats.expanded++;
+
+        successors.clear();
+        rsrSuccessors(map, query->labels, mainCellIdx, targetIdx, &successors);
+        for (i = 0; i < (int) successors.size(); i++)
+        {
+            int successorIdx = successors[i];
+            float successor_f, successor_g, successor_h;
+            OctileCost steps, total;
+            Cell* successorCell;
+
+            if (successorIdx == mainCellIdx || state[successorIdx] == LBL_VISITED)
+                continue;
+
+            steps = octileDistance(mainCellIdx, successorIdx, windowSize.ncol);
+            steps.straight += mainCell->steps.straight;
+            steps.diagonal += mainCell->steps.diagonal;
+            successor_g = octileValue(steps);
+
+            /* Most macro edges reach cells queued more cheaply already: h is only needed after */
+            successorCell = &listCell[successorIdx];
+            if (successorCell->g > successor_g)
+            {
+                total = octileDistance(successorIdx, targetIdx, windowSize.ncol);
+                successor_h = octileValue(total);
+                total.straight += steps.straight;
+                total.diagonal += steps.diagonal;
+                successor_f = octileValue(total);
+
+                successorCell->f = successor_f;
+                successorCell->g = successor_g;
+                successorCell->h = successor_h;
+                successorCell->steps = steps;
+                successorCell->prev = mainCellIdx;
+
+                state[successorIdx] = LBL_TOBEVISITED;
+                openListPush(&openList, successorIdx, successor_f,
+                             tieBreakValue(query->tieBreaking, successor_g, successor_h));
+                result->stats.generated++;
+                result->stats.maxOpenSize = MAX2(result->stats.maxOpenSize, (long) openList.size);
+
+                if (NOTIFY_OBSERVER(query, successorIdx, LBL_TOBEVISITED))
+                {
+                    status = SEARCH_ABORTED;
+                    goto done;
+                }
+            }
+        }
+
+        if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITED))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+    }
+
+done:
+    openListFree(&openList);
+    free(state);
+    free(listCell);
+
+    return status;
+}
@@ -0,0 +1,26 @@
+/*
+ * Rectangular Symmetry Reduction, RSR (Harabor, Botea & Kilby, 2011): the
+ * free cells are cut once per map into empty rectangles. Inside an empty
+ * rectangle every octile path between two of its cells is free, so a
+ * search never needs the interior: it only expands the cells on the border
+ * of each rectangle, which reach the far sides through macro edges, and the
+ * interior cells holding SOURCE or TARGET.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+typedef struct RsrMap
+{
+    Grid         windowSize;
+    int          numRects;
+    int          numInterior;   /* free cells that are never expanded           */
+    int         *rectOf;        /* rectangle of each cell, -1 if blocked        */
+    bool        *interior;      /* cells off the border of their rectangle      */
+    int         *rects;         /* 4 per rectangle: left, top, right, bottom,
+                                   all inclusive                                */
+} RsrMap;
+
+RsrMap* rsrBuild(const BlockLabels* labels, Grid windowSize);
+void rsrFree(RsrMap* map);
+SearchStatus rsrSearch(const SearchQuery *query, SearchResult *result);
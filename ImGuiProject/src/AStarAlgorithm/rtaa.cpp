@@ -0,0 +1,236 @@
+#include <float.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "bitbfs.hpp"
+#include "rtaa.hpp"
+
+
+/*
+ * One decision is an A* from the agent, stopped after `lookahead`
+ * expansions (or when TARGET tops the open list). With `best` the top of the
+ * open list, every closed cell s learns h(s) = f(best) - g(s): the distance
+ * to TARGET through the frontier can be no shorter, and since it is never
+ * below the previous h, h stays admissible and consistent as long as cells
+ * are only ever blocked. The agent then walks the local path to `best`.
+ */
+
+static float learnedH(const RtaaAgent* agent, int idx)
+{
+    if (agent->h[idx] >= 0.0f)
+        return agent->h[idx];
+    return octileValue(octileDistance(idx, agent->targetIdx, agent->windowSize.ncol));
+}
+
+RtaaAgent* rtaaCreate(Grid windowSize, int lookahead)
+{
+    int idx, numElement = windowSize.nrow * windowSize.ncol;
+    RtaaAgent* agent = (RtaaAgent*) malloc(sizeof(RtaaAgent));
+
+    agent->windowSize = windowSize;
+    agent->targetIdx = -1;
+    agent->lookahead = MAX2(lookahead, 1);
+    agent->h = (float*) malloc(numElement * sizeof(float));
+    agent->decision = 0;
+    agent->seen = (unsigned int*) calloc(numElement, sizeof(unsigned int));
+    agent->g = (float*) malloc(numElement * sizeof(float));
+    agent->prev = (int*) malloc(numElement * sizeof(int));
+    agent->closed = NULL;
+    agent->capacity = 0;
+    openListInit(&agent->open, OPENLIST_HEAP, numElement);
+    for (idx = 0; idx < numElement; idx++)
+        agent->h[idx] = -1.0f;
+    return agent;
+}
+
+void rtaaFree(RtaaAgent* agent)
+{
+    if (agent == NULL)
+        return;
+    openListFree(&agent->open);
+    free(agent->h);
+    free(agent->seen);
+    free(agent->g);
+    free(agent->prev);
+    free(agent->closed);
+    free(agent);
+}
+
+/*
+ * Plan one decision of the agent standing on `currentIdx`. The cells to walk
+ * through, `currentIdx` excluded, are written to `moves`, which must hold
+ * lookahead + 1 cells; returns their number, or -1 when the local search ran
+ * out of cells: TARGET cannot be reached. Only a component smaller than the
+ * lookahead is seen that way, in a larger one the agent would wander forever,
+ * so check reachability first. A new TARGET forgets what was learned, the
+ * only step that costs more than the lookahead.
+ */
+int rtaaStep(RtaaAgent* agent, const BlockLabels* labels, int currentIdx, int targetIdx,
+             int* moves, SearchStats* stats)
+{
+    Grid windowSize = agent->windowSize;
+    int numElement = windowSize.nrow * windowSize.ncol;
+    int numClosed = 0, numMoves, i, idx, bestIdx;
+    float bestKey, bestTie;
+
+    /* A decision that expands nothing never moves the agent */
+    agent->lookahead = MAX2(agent->lookahead, 1);
+    if (targetIdx != agent->targetIdx)
+    {
+        for (idx = 0; idx < numElement; idx++)
+            agent->h[idx] = -1.0f;
+        agent->targetIdx = targetIdx;
+    }
+    if (agent->capacity < agent->lookahead)
+    {
+        agent->capacity = agent->lookahead;
+        agent->closed = (int*) realloc(agent->closed, agent->capacity * sizeof(int));
+    }
+    if (currentIdx == targetIdx)
+        return 0;
+
+    agent->decision++;
+    agent->seen[currentIdx] = agent->decision;
+    agent->g[currentIdx] = 0.0f;
+    agent->prev[currentIdx] = -1;
+    openListPush(&agent->open, currentIdx, learnedH(agent, currentIdx), 0.0f);
+
+    while (agent->open.size > 0 && numClosed < agent->lookahead)
+    {
+        int padx, pady, mainX, mainY, mainCellIdx;
+
+        if (openListTop(&agent->open, &bestKey, &bestTie) == targetIdx)
+            break;
+        mainCellIdx = openListPop(&agent->open);
+        agent->closed[numClosed++] = mainCellIdx;
+        stats->expanded++;
+
+        mainX = mainCellIdx % windowSize.ncol;
+        mainY = mainCellIdx / windowSize.ncol;
+        for (pady = -1; pady <= 1; pady++)
+        {
+            for (padx = -1; padx <= 1; padx++)
+            {
+                int successorIdx = mainCellIdx + padx + pady * windowSize.ncol;
+                float successor_g;
+
+                if ((padx == 0 && pady == 0) ||
+                    mainX + padx < 0 || mainX + padx >= windowSize.ncol ||
+                    mainY + pady < 0 || mainY + pady >= windowSize.nrow ||
+                    labels[successorIdx] == LBL_BLOCKED)
+                    continue;
+
+                successor_g = agent->g[mainCellIdx] + adjDistance(padx, pady);
+                if (agent->seen[successorIdx] == agent->decision && agent->g[successorIdx] <= successor_g)
+                    continue;
+
+                /* A cell reached again after its expansion keeps its first, shorter g */
+                if (agent->seen[successorIdx] == agent->decision && agent->open.position[successorIdx] == -1)
+                    continue;
+                agent->seen[successorIdx] = agent->decision;
+                agent->g[successorIdx] = successor_g;
+                agent->prev[successorIdx] = mainCellIdx;
+                openListPush(&agent->open, successorIdx, successor_g + learnedH(agent, successorIdx), -successor_g);
+                stats->generated++;
+                stats->maxOpenSize = MAX2(stats->maxOpenSize, (long) agent->open.size);
+            }
+        }
+    }
+
+    if (agent->open.size == 0)
+        return -1;
+    bestIdx = openListTop(&agent->open, &bestKey, &bestTie);
+    bestKey = agent->g[bestIdx] + learnedH(agent, bestIdx);
+
+    for (i = 0; i < numClosed; i++)
+        agent->h[agent->closed[i]] = bestKey - agent->g[agent->closed[i]];
+    while (agent->open.size > 0)
+        openListPop(&agent->open);
+
+    numMoves = 0;
+    for (idx = bestIdx; idx != currentIdx; idx = agent->prev[idx])
+        numMoves++;
+    i = numMoves;
+    for (idx = bestIdx; idx != currentIdx; idx = agent->prev[idx])
+        moves[--i] = idx;
+    return numMoves;
+}
+
+/*
+ * Walk the agent from SOURCE to TARGET, one decision after the other. The
+ * path is the trajectory of the agent, loops included, and the expansions
+ * those of all decisions. With query->preprocessed set to an RtaaAgent the
+ * learned heuristic is kept for the next run, otherwise it starts from the
+ * octile distance with RTAA_LOOKAHEAD expansions per decision.
+ */
+SearchStatus rtaaSearch(const SearchQuery *query, SearchResult *result)
+{
+    RtaaAgent* agent = (RtaaAgent*) query->preprocessed;
+    std::vector<int> trajectory;
+    OctileCost steps = {0, 0};
+    BitGrid* bitGrid;
+    SearchStatus status = SEARCH_FOUND;
+    int* moves;
+    int current, i, numMoves;
+    bool reachable;
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+    if (agent != NULL && (agent->windowSize.nrow != query->grid.nrow ||
+                          agent->windowSize.ncol != query->grid.ncol))
+        return SEARCH_INVALID;
+
+    /* The agent cannot tell an unreachable TARGET from a large maze: ask first */
+    bitGrid = bitGridBuild(query->labels, query->grid);
+    reachable = bitGridReachable(bitGrid, query->sourceIdx, query->targetIdx);
+    bitGridFree(bitGrid);
+    if (!reachable)
+        return SEARCH_NOT_FOUND;
+
+    if (agent == NULL)
+        agent = rtaaCreate(query->grid, RTAA_LOOKAHEAD);
+    moves = (int*) malloc((MAX2(agent->lookahead, 1) + 1) * sizeof(int));
+
+    current = query->sourceIdx;
+    trajectory.push_back(current);
+    while (current != query->targetIdx && status == SEARCH_FOUND)
+    {
+        numMoves = rtaaStep(agent, query->labels, current, query->targetIdx, moves, &result->stats);
+        if (numMoves < 0)
+        {
+            status = SEARCH_NOT_FOUND;
+            break;
+        }
+        for (i = 0; i < numMoves; i++)
+        {
+            if (moves[i] % query->grid.ncol != current % query->grid.ncol &&
+                moves[i] / query->grid.ncol != current / query->grid.ncol)
+                steps.diagonal++;
+            else
+                steps.straight++;
+            current = moves[i];
+            trajectory.push_back(current);
+            if (NOTIFY_OBSERVER(query, current, LBL_VISITED))
+            {
+                status = SEARCH_ABORTED;
+                break;
+            }
+        }
+    }
+
+    free(moves);
+    if (agent != (RtaaAgent*) query->preprocessed)
+        rtaaFree(agent);
+    if (status != SEARCH_FOUND)
+        return status;
+
+    result->pathLen = (int) trajectory.size();
+    result->path = (int*) malloc(result->pathLen * sizeof(int));
+    for (i = 0; i < result->pathLen; i++)
+        result->path[i] = trajectory[i];
+    result->cost = octileValue(steps);
+    return SEARCH_FOUND;
+}
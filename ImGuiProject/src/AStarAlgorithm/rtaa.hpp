@@ -0,0 +1,38 @@
+/*
+ * Real-Time Adaptive A*, RTAA* (Koenig & Likhachev, 2006): an agent that
+ * must move every frame plans only `lookahead` expansions ahead of itself,
+ * walks toward the most promising cell of that local search and raises the
+ * heuristic of the cells it closed. The learned heuristic persists in the
+ * RtaaAgent, so repeated trials to the same TARGET converge to a shortest
+ * path, while every decision costs at most `lookahead` expansions whatever
+ * the size of the map.
+ */
+#pragma once
+
+#include "astar.hpp"
+#include "openlist.hpp"
+
+#define RTAA_LOOKAHEAD          64
+
+typedef struct RtaaAgent
+{
+    Grid          windowSize;
+    int           targetIdx;    /* TARGET `h` was learned for, -1 before the first step */
+    int           lookahead;    /* expansions per decision, may be changed between steps; at least 1 */
+    float        *h;            /* learned heuristic, < 0 while still the octile distance */
+
+    /* Local search of one decision: only the cells it touches are ever read */
+    unsigned int  decision;     /* number of decisions so far                           */
+    unsigned int *seen;         /* decision that last set `g` and `prev` of the cell     */
+    float        *g;
+    int          *prev;
+    int          *closed;       /* cells expanded by the current decision               */
+    int           capacity;     /* slots of `closed`                                    */
+    OpenList      open;         /* emptied after every decision                         */
+} RtaaAgent;
+
+RtaaAgent* rtaaCreate(Grid windowSize, int lookahead);
+void rtaaFree(RtaaAgent* agent);
+int rtaaStep(RtaaAgent* agent, const BlockLabels* labels, int currentIdx, int targetIdx,
+             int* moves, SearchStats* stats);
+SearchStatus rtaaSearch(const SearchQuery *query, SearchResult *result);
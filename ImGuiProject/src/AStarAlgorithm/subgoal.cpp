@@ -0,0 +1,382 @@
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+#include "astar.hpp"
+#include "subgoal.hpp"
+
+
+/*
+ * A diagonal move of this grid only needs its destination to be free, so a
+ * shortest path only has to bend around a blocked cell b next to a cell s:
+ * the path comes from, or goes to, the free cell diagonal to s alongside b,
+ * and swapping its two moves would step onto b. Every other bend can be
+ * moved along the path without making it longer, so a shortest path can
+ * always be cut at subgoals into runs of diagonal moves followed by moves
+ * along one axis, which is all the scans below follow.
+ */
+
+typedef std::pair<float, int> SubgoalEntry;
+typedef std::priority_queue<SubgoalEntry, std::vector<SubgoalEntry>, std::greater<SubgoalEntry> > SubgoalQueue;
+
+static const int cardinalX[4] = {1, -1, 0, 0};
+static const int cardinalY[4] = {0, 0, 1, -1};
+
+static inline bool isFree(const BlockLabels* labels, Grid windowSize, int x, int y)
+{
+    return x >= 0 && x < windowSize.ncol && y >= 0 && y < windowSize.nrow &&
+           labels[x + y * windowSize.ncol] != LBL_BLOCKED;
+}
+
+static inline bool inGrid(Grid windowSize, int x, int y)
+{
+    return x >= 0 && x < windowSize.ncol && y >= 0 && y < windowSize.nrow;
+}
+
+static bool isSubgoal(const BlockLabels* labels, Grid windowSize, int idx)
+{
+    int x = idx % windowSize.ncol, y = idx / windowSize.ncol, k;
+
+    if (labels[idx] == LBL_BLOCKED)
+        return false;
+    for (k = 0; k < 4; k++)
+    {
+        int bx = x + cardinalX[k], by = y + cardinalY[k];
+        if (!inGrid(windowSize, bx, by) || isFree(labels, windowSize, bx, by))
+            continue;
+        /* The blocked cell has a free cell beside it, diagonal to this one */
+        if (isFree(labels, windowSize, bx + cardinalY[k], by + cardinalX[k]) ||
+            isFree(labels, windowSize, bx - cardinalY[k], by - cardinalX[k]))
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Subgoals reached from `fromIdx` by diagonal moves then moves along one
+ * axis, stopping at the first subgoal or blocked cell of each run; they are
+ * appended to `found`. `stopIdx` is looked for on the way too (TARGET, for
+ * a query), *reachesStop tells if it was met.
+ */
+static void directReachable(const SubgoalGraph* graph, const BlockLabels* labels, int fromIdx, int stopIdx,
+                            std::vector<int>* found, bool* reachesStop)
+{
+    Grid windowSize = graph->windowSize;
+    int ncol = windowSize.ncol, sx, sy, k;
+    int stopX = stopIdx % ncol, stopY = stopIdx / ncol;
+
+    for (sy = -1; sy <= 1; sy += 2)
+    {
+        for (sx = -1; sx <= 1; sx += 2)
+        {
+            /* Axes of this quadrant, as indices of cardinalX / cardinalY */
+            int axes[2] = {(sx > 0) ? 0 : 1, (sy > 0) ? 2 : 3};
+            int x = fromIdx % ncol, y = fromIdx / ncol;
+
+            while (true)
+            {
+                int idx = x + y * ncol;
+
+                for (k = 0; k < 2; k++)
+                {
+                    int a = axes[k], m = graph->clearance[4 * idx + a];
+                    int ex = x + m * cardinalX[a], ey = y + m * cardinalY[a];
+                    int along = (cardinalX[a] != 0) ? (stopX - x) * cardinalX[a] : (stopY - y) * cardinalY[a];
+
+                    if (inGrid(windowSize, ex, ey) && graph->nodeOf[ex + ey * ncol] != -1)
+                        found->push_back(graph->nodeOf[ex + ey * ncol]);
+                    if (stopIdx >= 0 && along >= 1 && along <= m &&
+                        ((cardinalX[a] != 0) ? stopY == y : stopX == x))
+                        *reachesStop = true;
+                }
+
+                if (!isFree(labels, windowSize, x + sx, y + sy))
+                    break;
+                x += sx;
+                y += sy;
+                if (x + y * ncol == stopIdx)
+                    *reachesStop = true;
+                if (graph->nodeOf[x + y * ncol] != -1)
+                {
+                    found->push_back(graph->nodeOf[x + y * ncol]);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* Place the subgoals and link each one to those it reaches directly */
+SubgoalGraph* subgoalBuild(const BlockLabels* labels, Grid windowSize)
+{
+    int numElement = windowSize.nrow * windowSize.ncol, ncol = windowSize.ncol;
+    SubgoalGraph* graph = (SubgoalGraph*) malloc(sizeof(SubgoalGraph));
+    std::vector<int> cells, neighbours, edgeNode;
+    std::vector<float> edgeCost;
+    int idx, x, y, k, s;
+    bool unused;
+
+    graph->windowSize = windowSize;
+    graph->nodeOf = (int*) malloc(numElement * sizeof(int));
+    for (idx = 0; idx < numElement; idx++)
+    {
+        graph->nodeOf[idx] = -1;
+        if (isSubgoal(labels, windowSize, idx))
+        {
+            graph->nodeOf[idx] = (int) cells.size();
+            cells.push_back(idx);
+        }
+    }
+    graph->numSubgoals = (int) cells.size();
+    graph->cellOf = (int*) malloc(MAX2(graph->numSubgoals, 1) * sizeof(int));
+    if (!cells.empty())
+        memcpy(graph->cellOf, cells.data(), cells.size() * sizeof(int));
+
+    /* Clearance in each direction, from the far end of every row / column */
+    graph->clearance = (int*) malloc(4 * (size_t) numElement * sizeof(int));
+    for (k = 0; k < 4; k++)
+    {
+        int dx = cardinalX[k], dy = cardinalY[k];
+        int x0 = (dx > 0) ? ncol - 1 : 0, y0 = (dy > 0) ? windowSize.nrow - 1 : 0;
+        int stepX = (dx > 0) ? -1 : 1, stepY = (dy > 0) ? -1 : 1;
+
+        for (y = y0; y >= 0 && y < windowSize.nrow; y += stepY)
+            for (x = x0; x >= 0 && x < ncol; x += stepX)
+            {
+                int next = (x + dx) + (y + dy) * ncol;
+                if (!isFree(labels, windowSize, x + dx, y + dy) || graph->nodeOf[next] != -1)
+                    graph->clearance[4 * (x + y * ncol) + k] = 1;
+                else
+                    graph->clearance[4 * (x + y * ncol) + k] = graph->clearance[4 * next + k] + 1;
+            }
+    }
+
+    graph->edgeStart = (int*) malloc((graph->numSubgoals + 1) * sizeof(int));
+    for (s = 0; s < graph->numSubgoals; s++)
+    {
+        graph->edgeStart[s] = (int) edgeNode.size();
+        neighbours.clear();
+        directReachable(graph, labels, cells[s], -1, &neighbours, &unused);
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        for (k = 0; k < (int) neighbours.size(); k++)
+        {
+            edgeNode.push_back(neighbours[k]);
+            edgeCost.push_back(octileValue(octileDistance(cells[s], cells[neighbours[k]], ncol)));
+        }
+    }
+    graph->edgeStart[graph->numSubgoals] = (int) edgeNode.size();
+    graph->numEdges = (int) edgeNode.size();
+    graph->edgeNode = (int*) malloc(MAX2(graph->numEdges, 1) * sizeof(int));
+    graph->edgeCost = (float*) malloc(MAX2(graph->numEdges, 1) * sizeof(float));
+    if (graph->numEdges > 0)
+    {
+        memcpy(graph->edgeNode, edgeNode.data(), edgeNode.size() * sizeof(int));
+        memcpy(graph->edgeCost, edgeCost.data(), edgeCost.size() * sizeof(float));
+    }
+    return graph;
+}
+
+void subgoalFree(SubgoalGraph* graph)
+{
+    if (graph == NULL)
+        return;
+    free(graph->cellOf);
+    free(graph->nodeOf);
+    free(graph->clearance);
+    free(graph->edgeStart);
+    free(graph->edgeNode);
+    free(graph->edgeCost);
+    free(graph);
+}
+
+/*
+ * Cells after `fromIdx` up to `toIdx` by diagonal moves first, appended to
+ * `cells`; false, with `cells` unchanged, if one of them is blocked.
+ */
+static bool diagonalFirst(const BlockLabels* labels, Grid windowSize, int fromIdx, int toIdx,
+                          std::vector<int>* cells)
+{
+    int ncol = windowSize.ncol, x = fromIdx % ncol, y = fromIdx / ncol;
+    int dx = toIdx % ncol - x, dy = toIdx / ncol - y;
+    int sx = (dx > 0) - (dx < 0), sy = (dy > 0) - (dy < 0);
+    int numDiagonal = MIN2(ABS(dx), ABS(dy)), numStraight = MAX2(ABS(dx), ABS(dy)) - numDiagonal;
+    size_t start = cells->size();
+    int i;
+
+    for (i = 0; i < numDiagonal + numStraight; i++)
+    {
+        if (i < numDiagonal)
+        {
+            x += sx;
+            y += sy;
+        }
+        else if (ABS(dx) > ABS(dy))
+            x += sx;
+        else
+            y += sy;
+        if (labels[x + y * ncol] == LBL_BLOCKED)
+        {
+            cells->resize(start);
+            return false;
+        }
+        cells->push_back(x + y * ncol);
+    }
+    return true;
+}
+
+/*
+ * An edge was found by a scan from one of its ends, so the diagonal-first
+ * walk from that end is free: try both.
+ */
+static bool refineEdge(const BlockLabels* labels, Grid windowSize, int fromIdx, int toIdx, std::vector<int>* cells)
+{
+    std::vector<int> backward;
+
+    if (diagonalFirst(labels, windowSize, fromIdx, toIdx, cells))
+        return true;
+    if (!diagonalFirst(labels, windowSize, toIdx, fromIdx, &backward))
+        return false;
+    backward.pop_back();
+    cells->insert(cells->end(), backward.rbegin(), backward.rend());
+    cells->push_back(toIdx);
+    return true;
+}
+
+/*
+ * Subgoal graph engine of findPath(), with query->preprocessed the
+ * subgoalBuild() graph of the grid. Nodes are the subgoals, then SOURCE and
+ * TARGET; `stats` count the graph search only. Paths are optimal.
+ */
+SearchStatus subgoalSearch(const SearchQuery *query, SearchResult *result)
+{
+    const SubgoalGraph* graph = (const SubgoalGraph*) query->preprocessed;
+    const BlockLabels* labels = query->labels;
+    int sourceIdx = query->sourceIdx, targetIdx = query->targetIdx, ncol = query->grid.ncol;
+    int numSubgoals, sourceId, targetId, numNodes, u, i, id;
+    std::vector<int> sourceEdges, targetEdges, nodes, path;
+    std::vector<float> g, toTarget;
+    std::vector<int> prev;
+    std::vector<char> closed;
+    SubgoalQueue open;
+    OctileCost cost = {0, 0};
+    SearchStatus status = SEARCH_NOT_FOUND;
+    bool direct = false, unused;
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+    if (graph == NULL || graph->windowSize.nrow != query->grid.nrow || graph->windowSize.ncol != ncol)
+        return SEARCH_INVALID;
+
+    numSubgoals = graph->numSubgoals;
+    sourceId = numSubgoals;
+    targetId = numSubgoals + 1;
+    numNodes = numSubgoals + 2;
+
+    directReachable(graph, labels, sourceIdx, targetIdx, &sourceEdges, &direct);
+    directReachable(graph, labels, targetIdx, -1, &targetEdges, &unused);
+    direct = direct || sourceIdx == targetIdx;
+    toTarget.assign(numSubgoals, FLT_MAX);
+    for (i = 0; i < (int) targetEdges.size(); i++)
+        toTarget[targetEdges[i]] = octileValue(octileDistance(graph->cellOf[targetEdges[i]], targetIdx, ncol));
+
+    g.assign(numNodes, FLT_MAX);
+    prev.assign(numNodes, -1);
+    closed.assign(numNodes, 0);
+    g[sourceId] = 0.0f;
+    open.push(SubgoalEntry(octileValue(octileDistance(sourceIdx, targetIdx, ncol)), sourceId));
+
+    while (!open.empty())
+    {
+        int cell, numOut;
+        bool aborted = false;
+
+        u = open.top().second;
+        open.pop();
+        if (closed[u])
+            continue;
+        closed[u] = 1;
+        result->stats.expanded++;
+        if (u == targetId)
+        {
+            status = SEARCH_FOUND;
+            break;
+        }
+
+        cell = (u == sourceId) ? sourceIdx : graph->cellOf[u];
+        if (u != sourceId && NOTIFY_OBSERVER(query, cell, LBL_VISITING))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+
+        /* Out-edges: the graph's, or those of SOURCE, and the one to TARGET */
+        nodes.clear();
+        if (u == sourceId)
+        {
+            nodes = sourceEdges;
+            if (direct)
+                nodes.push_back(targetId);
+        }
+        else
+        {
+            nodes.assign(graph->edgeNode + graph->edgeStart[u], graph->edgeNode + graph->edgeStart[u + 1]);
+            if (toTarget[u] < FLT_MAX)
+                nodes.push_back(targetId);
+        }
+        numOut = (int) nodes.size();
+
+        for (i = 0; i < numOut && !aborted; i++)
+        {
+            int v = nodes[i], next = (v == targetId) ? targetIdx : graph->cellOf[v];
+            float candidate = g[u] + octileValue(octileDistance(cell, next, ncol));
+
+            if (closed[v] || candidate >= g[v])
+                continue;
+            g[v] = candidate;
+            prev[v] = u;
+            open.push(SubgoalEntry(candidate + octileValue(octileDistance(next, targetIdx, ncol)), v));
+            result->stats.generated++;
+            result->stats.maxOpenSize = MAX2(result->stats.maxOpenSize, (long) open.size());
+            if (v != targetId)
+                aborted = NOTIFY_OBSERVER(query, next, LBL_TOBEVISITED);
+        }
+
+        if (aborted || (u != sourceId && NOTIFY_OBSERVER(query, cell, LBL_VISITED)))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+    }
+    if (status != SEARCH_FOUND)
+        return status;
+
+    /* Waypoints, then every edge walked back into cells */
+    nodes.clear();
+    for (id = targetId; id != -1; id = prev[id])
+        nodes.push_back((id == targetId) ? targetIdx : (id == sourceId) ? sourceIdx : graph->cellOf[id]);
+    std::reverse(nodes.begin(), nodes.end());
+    path.push_back(sourceIdx);
+    for (i = 1; i < (int) nodes.size(); i++)
+    {
+        if (!refineEdge(labels, query->grid, nodes[i - 1], nodes[i], &path))
+            return SEARCH_NOT_FOUND;
+    }
+    for (i = 1; i < (int) path.size(); i++)
+    {
+        if (path[i] % ncol != path[i - 1] % ncol && path[i] / ncol != path[i - 1] / ncol)
+            cost.diagonal++;
+        else
+            cost.straight++;
+    }
+
+    result->path = (int*) malloc(path.size() * sizeof(int));
+    memcpy(result->path, path.data(), path.size() * sizeof(int));
+    result->pathLen = (int) path.size();
+    result->cost = octileValue(cost);
+    return SEARCH_FOUND;
+}
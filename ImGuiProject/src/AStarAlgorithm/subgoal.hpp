@@ -0,0 +1,29 @@
+/*
+ * Simple Subgoal Graphs, SUB (Uras, Koenig & Hernandez, 2013): subgoals are
+ * placed at the corners of the obstacles, where shortest paths may bend,
+ * and two subgoals are linked when one reaches the other in a straight
+ * octile run (h-reachable) without passing another subgoal. A query links
+ * SOURCE and TARGET to the graph the same way and only searches this sparse
+ * graph; each edge is then walked back into cells.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+typedef struct SubgoalGraph
+{
+    Grid         windowSize;
+    int          numSubgoals;
+    int          numEdges;
+    int         *cellOf;        /* cell of each subgoal                                       */
+    int         *nodeOf;        /* subgoal of each cell, -1 if none                           */
+    int         *clearance;     /* 4 per cell: moves east, west, south and north to the first
+                                   blocked cell, subgoal or border                            */
+    int         *edgeStart;     /* numSubgoals + 1 offsets into edgeNode / edgeCost           */
+    int         *edgeNode;
+    float       *edgeCost;      /* octile distance, the length of the straight run           */
+} SubgoalGraph;
+
+SubgoalGraph* subgoalBuild(const BlockLabels* labels, Grid windowSize);
+void subgoalFree(SubgoalGraph* graph);
+SearchStatus subgoalSearch(const SearchQuery *query, SearchResult *result);
@@ -0,0 +1,358 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include "astar.hpp"
+#include "swamp.hpp"
+
+
+/*
+ * Why the regions can be skipped: take a shortest path between two cells
+ * outside every skipped region, and the outermost skipped region R it
+ * enters. Each visit of R enters from a cell of its door and leaves to a
+ * cell of the same door, so the straight walk along the door between the
+ * two is no longer. The door cells lie in no skipped region (see below), so
+ * replacing every visit leaves a path that is as short and meets fewer
+ * skipped cells; repeat until it meets none.
+ *
+ * That needs the regions to form a laminar family (nested or disjoint) in
+ * which the door of a region lies only in regions that enclose it. Regions
+ * are accepted from the largest down, so a candidate can only nest in or
+ * miss the accepted ones, and it is rejected if it crosses one, holds the
+ * door of one, or has its door in one it does not lie in.
+ */
+typedef struct SwampDoor
+{
+    int          start;         /* first cell                           */
+    int          length;
+    int          step;          /* 1 for a horizontal door, ncol else   */
+} SwampDoor;
+
+typedef struct SwampCandidate
+{
+    SwampDoor    door;
+    int          seed;          /* a cell of the region                 */
+    int          size;
+} SwampCandidate;
+
+/*
+ * Collect the cells reachable from `seed` whose mark is not `stamp`, marking
+ * them. Returns their number, or -1 as soon as there are more than maxCells.
+ */
+static int floodRegion(const BlockLabels* labels, Grid windowSize, int seed, int* mark, int stamp,
+                       std::vector<int>& cells, int maxCells)
+{
+    int ncol = windowSize.ncol, padx, pady;
+    size_t i;
+
+    cells.clear();
+    cells.push_back(seed);
+    mark[seed] = stamp;
+    for (i = 0; i < cells.size(); i++)
+    {
+        int idx = cells[i], x = cells[i] % ncol, y = cells[i] / ncol;
+
+        for (pady = -1; pady <= 1; pady++)
+            for (padx = -1; padx <= 1; padx++)
+            {
+                int next = idx + padx + pady * ncol;
+                if (x + padx < 0 || x + padx >= ncol || y + pady < 0 || y + pady >= windowSize.nrow ||
+                    labels[next] == LBL_BLOCKED || mark[next] == stamp)
+                    continue;
+                mark[next] = stamp;
+                cells.push_back(next);
+                if ((int) cells.size() > maxCells)
+                    return -1;
+            }
+    }
+    return (int) cells.size();
+}
+
+static void markDoor(const SwampDoor* door, int* mark, int stamp)
+{
+    int i;
+
+    for (i = 0; i < door->length; i++)
+        mark[door->start + i * door->step] = stamp;
+}
+
+/*
+ * Whether the run next to the door, `shift` rows (horizontal door) or
+ * columns (vertical door) away, is the same run: free over the same span
+ * and stopped by walls at the same places. In a corridor every cross
+ * section is such a run; only the two ends of each stack are worth trying,
+ * the ones between cut off less.
+ */
+static bool sameRun(const BlockLabels* labels, Grid windowSize, const SwampDoor* door, int shift)
+{
+    int ncol = windowSize.ncol, i;
+    int x = door->start % ncol + ((door->step == 1) ? 0 : shift);
+    int y = door->start / ncol + ((door->step == 1) ? shift : 0);
+    int dx = (door->step == 1) ? 1 : 0, dy = 1 - dx;
+
+    if (x < 0 || x >= ncol || y < 0 || y >= windowSize.nrow)
+        return false;
+    for (i = -1; i <= door->length; i++)
+    {
+        int cx = x + i * dx, cy = y + i * dy;
+        bool inside = cx >= 0 && cx < ncol && cy >= 0 && cy < windowSize.nrow;
+        bool isFree = inside && labels[cx + cy * ncol] != LBL_BLOCKED;
+
+        if (isFree != (i >= 0 && i < door->length))
+            return false;
+    }
+    return true;
+}
+
+static int findSide(std::vector<int>& group, int side)
+{
+    while (group[side] != side)
+        side = group[side] = group[group[side]];
+    return side;
+}
+
+/*
+ * Flood the sides of the door, starting from every free cell around it, one
+ * cell per side in turn; sides that meet merge. A group of sides that stops
+ * growing is a region that the door cuts off, a candidate if it is at most
+ * SWAMP_MAX_CELLS cells. The flood ends as soon as at most one group is left
+ * growing, so it costs about the size of the smaller sides, and a run that
+ * cuts nothing ends after a few cells.
+ */
+static void doorCandidates(const BlockLabels* labels, Grid windowSize, const SwampDoor* door, int* mark,
+                           int* stamp, std::vector<SwampCandidate>& candidates)
+{
+    enum { GROWING, FINISHED, TOO_LARGE };
+    int ncol = windowSize.ncol, base, numSides, numGroups, numOpen, numGrowing, i, s, padx, pady;
+    std::vector<int> group, size, state, head;
+    std::vector<bool> pending;      /* per group: a side still has cells to expand */
+    std::vector<std::vector<int> > queue;
+
+    /* The door is marked base - 1, the cells reached from side s base + s */
+    base = *stamp + 2;
+    markDoor(door, mark, base - 1);
+    for (i = 0; i < door->length; i++)
+    {
+        int idx = door->start + i * door->step, x = idx % ncol, y = idx / ncol;
+
+        for (pady = -1; pady <= 1; pady++)
+            for (padx = -1; padx <= 1; padx++)
+            {
+                int next = idx + padx + pady * ncol;
+                if (x + padx < 0 || x + padx >= ncol || y + pady < 0 || y + pady >= windowSize.nrow ||
+                    labels[next] == LBL_BLOCKED || mark[next] >= base - 1)
+                    continue;
+                mark[next] = base + (int) queue.size();
+                queue.push_back(std::vector<int>(1, next));
+            }
+    }
+    numSides = (int) queue.size();
+    *stamp = base + numSides;
+    group.resize(numSides);
+    size.assign(numSides, 1);
+    state.assign(numSides, GROWING);
+    head.assign(numSides, 0);
+    pending.resize(numSides);
+    for (s = 0; s < numSides; s++)
+        group[s] = s;
+
+    while (true)
+    {
+        /* A growing group whose sides all ran out of cells is finished */
+        numGroups = numOpen = numGrowing = 0;
+        std::fill(pending.begin(), pending.end(), false);
+        for (s = 0; s < numSides; s++)
+            if (head[s] < (int) queue[s].size())
+                pending[findSide(group, s)] = true;
+        for (s = 0; s < numSides; s++)
+            if (findSide(group, s) == s)
+            {
+                if (state[s] == GROWING && !pending[s])
+                    state[s] = FINISHED;
+                numGroups++;
+                numOpen += (state[s] != FINISHED);
+                numGrowing += (state[s] == GROWING);
+            }
+        if (numOpen <= 1 || numGrowing == 0)
+            break;
+
+        for (s = 0; s < numSides; s++)
+        {
+            int root = findSide(group, s), idx, x, y;
+
+            if (state[root] != GROWING || head[s] >= (int) queue[s].size())
+                continue;
+            idx = queue[s][head[s]++];
+            x = idx % ncol;
+            y = idx / ncol;
+            for (pady = -1; pady <= 1; pady++)
+                for (padx = -1; padx <= 1; padx++)
+                {
+                    int next = idx + padx + pady * ncol, other;
+                    if (x + padx < 0 || x + padx >= ncol || y + pady < 0 || y + pady >= windowSize.nrow ||
+                        labels[next] == LBL_BLOCKED || mark[next] == base - 1)
+                        continue;
+                    if (mark[next] >= base)
+                    {
+                        /* Reached from another side: the two are one region */
+                        other = findSide(group, mark[next] - base);
+                        root = findSide(group, s);
+                        if (other != root)
+                        {
+                            group[other] = root;
+                            size[root] += size[other];
+                            if (state[other] == TOO_LARGE || size[root] > SWAMP_MAX_CELLS)
+                                state[root] = TOO_LARGE;
+                        }
+                        continue;
+                    }
+                    mark[next] = base + s;
+                    queue[s].push_back(next);
+                    root = findSide(group, s);
+                    if (++size[root] > SWAMP_MAX_CELLS)
+                        state[root] = TOO_LARGE;
+                }
+        }
+    }
+
+    if (numGroups < 2)
+        return;
+    for (s = 0; s < numSides; s++)
+        if (findSide(group, s) == s && state[s] == FINISHED)
+        {
+            SwampCandidate candidate;
+            candidate.door = *door;
+            candidate.seed = queue[s][0];
+            candidate.size = size[s];
+            candidates.push_back(candidate);
+        }
+}
+
+/* Whether `ancestor` is -1, `region` or one of the regions enclosing it */
+static bool enclosedBy(const std::vector<int>& parent, int region, int ancestor)
+{
+    while (region != -1 && region != ancestor)
+        region = parent[region];
+    return region == ancestor;
+}
+
+SwampMap* swampBuild(const BlockLabels* labels, Grid windowSize)
+{
+    int numElement = windowSize.nrow * windowSize.ncol, ncol = windowSize.ncol, stamp = 0, x, y, i;
+    SwampMap* swamps = (SwampMap*) malloc(sizeof(SwampMap));
+    std::vector<int> mark(numElement, 0), cells;
+    std::vector<bool> isDoor(numElement, false);
+    std::vector<SwampCandidate> candidates;
+    std::vector<int> parent, size;
+
+    /* Doors: the maximal runs of free cells along a row or a column that are short enough */
+    for (y = 0; y < windowSize.nrow; y++)
+        for (x = 0; x < ncol; )
+        {
+            SwampDoor door = {x + y * ncol, 0, 1};
+            while (x < ncol && labels[x + y * ncol] != LBL_BLOCKED)
+            {
+                door.length++;
+                x++;
+            }
+            if (door.length > 0 && door.length <= SWAMP_MAX_DOOR &&
+                !(sameRun(labels, windowSize, &door, -1) && sameRun(labels, windowSize, &door, 1)))
+                doorCandidates(labels, windowSize, &door, mark.data(), &stamp, candidates);
+            if (door.length == 0)
+                x++;
+        }
+    for (x = 0; x < ncol; x++)
+        for (y = 0; y < windowSize.nrow; )
+        {
+            SwampDoor door = {x + y * ncol, 0, ncol};
+            while (y < windowSize.nrow && labels[x + y * ncol] != LBL_BLOCKED)
+            {
+                door.length++;
+                y++;
+            }
+            if (door.length > 0 && door.length <= SWAMP_MAX_DOOR &&
+                !(sameRun(labels, windowSize, &door, -1) && sameRun(labels, windowSize, &door, 1)))
+                doorCandidates(labels, windowSize, &door, mark.data(), &stamp, candidates);
+            if (door.length == 0)
+                y++;
+        }
+
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const SwampCandidate& a, const SwampCandidate& b) { return a.size > b.size; });
+
+    swamps->windowSize = windowSize;
+    swamps->numRegions = 0;
+    swamps->region = (int*) malloc(numElement * sizeof(int));
+    for (i = 0; i < numElement; i++)
+        swamps->region[i] = -1;
+
+    for (const SwampCandidate& candidate : candidates)
+    {
+        int enclosing = swamps->region[candidate.seed], id;
+        bool ok = true;
+
+        stamp++;
+        markDoor(&candidate.door, mark.data(), stamp);
+        floodRegion(labels, windowSize, candidate.seed, mark.data(), stamp, cells, numElement);
+
+        /* Crosses an accepted region, is one of them again, or holds a door */
+        for (i = 0; ok && i < (int) cells.size(); i++)
+            ok = swamps->region[cells[i]] == enclosing && !isDoor[cells[i]];
+        if (!ok || (enclosing != -1 && size[enclosing] == (int) cells.size()))
+            continue;
+        for (i = 0; ok && i < candidate.door.length; i++)
+            ok = enclosedBy(parent, enclosing, swamps->region[candidate.door.start + i * candidate.door.step]);
+        if (!ok)
+            continue;
+
+        id = swamps->numRegions++;
+        parent.push_back(enclosing);
+        size.push_back((int) cells.size());
+        for (int idx : cells)
+            swamps->region[idx] = id;
+        for (i = 0; i < candidate.door.length; i++)
+            isDoor[candidate.door.start + i * candidate.door.step] = true;
+    }
+
+    swamps->parent = (int*) malloc(MAX2(swamps->numRegions, 1) * sizeof(int));
+    swamps->size = (int*) malloc(MAX2(swamps->numRegions, 1) * sizeof(int));
+    for (i = 0; i < swamps->numRegions; i++)
+    {
+        swamps->parent[i] = parent[i];
+        swamps->size[i] = size[i];
+    }
+    return swamps;
+}
+
+void swampFree(SwampMap* swamps)
+{
+    if (swamps == NULL)
+        return;
+    free(swamps->region);
+    free(swamps->parent);
+    free(swamps->size);
+    free(swamps);
+}
+
+/*
+ * Set to LBL_BLOCKED the `state` of the cells a search from `sourceIdx` to
+ * `targetIdx` skips: those of every region holding neither SOURCE nor
+ * TARGET. The regions holding them are the innermost region of each and
+ * all that enclose it; a cell is skipped unless its innermost region is
+ * one of these.
+ */
+void swampMarkSkipped(const SwampMap* swamps, int sourceIdx, int targetIdx, BlockLabels* state)
+{
+    int numElement = swamps->windowSize.nrow * swamps->windowSize.ncol, idx, r;
+    std::vector<bool> allowed(swamps->numRegions, false);
+
+    if (swamps->numRegions == 0)
+        return;
+    for (r = swamps->region[sourceIdx]; r != -1; r = swamps->parent[r])
+        allowed[r] = true;
+    for (r = swamps->region[targetIdx]; r != -1; r = swamps->parent[r])
+        allowed[r] = true;
+    for (idx = 0; idx < numElement; idx++)
+        if (swamps->region[idx] != -1 && !allowed[swamps->region[idx]])
+            state[idx] = LBL_BLOCKED;
+}
@@ -0,0 +1,33 @@
+/*
+ * Dead-end and swamp pruning (after Pochter, Zohar & Rosenschein, 2010): a
+ * swamp is a region that a shortest path between two cells outside it never
+ * needs to enter. Computed once per map; a search then treats the cells of
+ * every swamp that holds neither SOURCE nor TARGET as blocked, and still
+ * finds an optimal path.
+ *
+ * The regions found here are the dead-ends of the map: the cells cut off
+ * from the rest by a door, a horizontal or vertical run of at most
+ * SWAMP_MAX_DOOR free cells between two walls. A path that enters such a
+ * region leaves it through the same door, and walking along the door is
+ * never longer. Regions nest (a closet in a room behind a door) but never
+ * cross, so each cell only records the innermost region it lies in.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+#define SWAMP_MAX_DOOR          8       /* cells of a door                      */
+#define SWAMP_MAX_CELLS         4096    /* cells of a region, larger ones are kept */
+
+struct SwampMap
+{
+    Grid         windowSize;
+    int          numRegions;
+    int         *region;        /* innermost region of each cell, -1 if none    */
+    int         *parent;        /* enclosing region of each region, -1 if none  */
+    int         *size;          /* cells of each region, nested ones included   */
+};
+
+SwampMap* swampBuild(const BlockLabels* labels, Grid windowSize);
+void swampFree(SwampMap* swamps);
+void swampMarkSkipped(const SwampMap* swamps, int sourceIdx, int targetIdx, BlockLabels* state);
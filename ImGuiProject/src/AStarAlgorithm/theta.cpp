@@ -0,0 +1,199 @@
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "astar.hpp"
+#include "openlist.hpp"
+#include "theta.hpp"
+
+
+/*
+ * Cells are nodes at their centre. A segment between two centres is clear
+ * when every cell it passes through is unblocked; where it goes exactly
+ * through a corner it may pass between two blocked cells, as a diagonal move
+ * of A* does, so every move of A* is a clear segment.
+ */
+bool lineOfSight(const BlockLabels* labels, Grid windowSize, int fromIdx, int toIdx)
+{
+    int x0 = fromIdx % windowSize.ncol, y0 = fromIdx / windowSize.ncol;
+    int dx = toIdx % windowSize.ncol - x0, dy = toIdx / windowSize.ncol - y0;
+    int sx = (dx > 0) - (dx < 0), sy = (dy > 0) - (dy < 0);
+    long nx = ABS(dx), ny = ABS(dy);
+    long ix = 0, iy = 0;
+
+    /*
+     * Walk the cells in the order the segment enters them: it leaves the
+     * column of step ix at t = (2 ix + 1) / 2 nx and the row of step iy at
+     * t = (2 iy + 1) / 2 ny, compared exactly on integers.
+     */
+    while (ix < nx || iy < ny)
+    {
+        long crossX = (2 * ix + 1) * ny, crossY = (2 * iy + 1) * nx;
+
+        if (iy == ny || (ix < nx && crossX < crossY))
+            ix++;
+        else if (ix == nx || crossY < crossX)
+            iy++;
+        else
+        {
+            ix++;
+            iy++;
+        }
+        if (labels[fromIdx + sx * ix + sy * iy * windowSize.ncol] == LBL_BLOCKED)
+            return false;
+    }
+    return true;
+}
+
+static float euclideanDistance(int fromIdx, int toIdx, int ncol)
+{
+    float dx = (float) (fromIdx % ncol - toIdx % ncol);
+    float dy = (float) (fromIdx / ncol - toIdx / ncol);
+    return sqrtf(dx * dx + dy * dy);
+}
+
+/*
+ * Lazy Theta*: a successor of the expanded cell takes the cell's own parent
+ * as parent, assuming the line of sight. When the successor is expanded in
+ * turn, the assumption is checked; if the parent cannot see it, it falls
+ * back to the best expanded neighbour, which is what A* would have kept.
+ *
+ * The heuristic is the euclidean distance: the octile one overestimates
+ * any-angle distances. Paths are returned as their waypoints only.
+ */
+SearchStatus lazyThetaSearch(const SearchQuery *query, SearchResult *result)
+{
+    const BlockLabels* labels = query->labels;
+    Grid windowSize = query->grid;
+    int sourceIdx = query->sourceIdx, targetIdx = query->targetIdx;
+    int numElement = windowSize.nrow * windowSize.ncol;
+    SearchStatus status = SEARCH_NOT_FOUND;
+
+    Cell* listCell;
+    BlockLabels* state;         /* LBL_UNBLOCKED, LBL_TOBEVISITED or LBL_VISITED */
+    OpenList openList;
+
+    initSearchResult(result);
+    if (!isValidQuery(query))
+        return SEARCH_INVALID;
+
+    listCell = initListCell(&windowSize, sourceIdx);
+    state = (BlockLabels*) calloc(numElement, sizeof(BlockLabels));
+    openListInit(&openList, query->openList, numElement);
+
+    listCell[sourceIdx].h = euclideanDistance(sourceIdx, targetIdx, windowSize.ncol);
+    listCell[sourceIdx].f = listCell[sourceIdx].h;
+    openListPush(&openList, sourceIdx, listCell[sourceIdx].f, 0.0f);
+    state[sourceIdx] = LBL_TOBEVISITED;
+
+    while (openList.size > 0)
+    {
+        int padx, pady, mainX, mainY, mainCellIdx, parentIdx;
+        Cell* mainCell;
+
+        mainCellIdx = openListPop(&openList);
+        mainCell = &listCell[mainCellIdx];
+        mainX = mainCellIdx % windowSize.ncol;
+        mainY = mainCellIdx / windowSize.ncol;
+
+        /* The lazy check: no line of sight to the parent, take the best expanded neighbour */
+        if (mainCell->prev != -1 && !lineOfSight(labels, windowSize, mainCell->prev, mainCellIdx))
+        {
+            mainCell->g = FLT_MAX;
+            for (pady = -1; pady <= 1; pady++)
+            {
+                for (padx = -1; padx <= 1; padx++)
+                {
+                    int neighbourIdx = mainCellIdx + padx + pady * windowSize.ncol;
+                    float neighbour_g;
+
+                    if ((padx == 0 && pady == 0) ||
+                        mainX + padx < 0 || mainX + padx >= windowSize.ncol ||
+                        mainY + pady < 0 || mainY + pady >= windowSize.nrow ||
+                        state[neighbourIdx] != LBL_VISITED)
+                        continue;
+                    neighbour_g = listCell[neighbourIdx].g + adjDistance(padx, pady);
+                    if (neighbour_g < mainCell->g)
+                    {
+                        mainCell->g = neighbour_g;
+                        mainCell->prev = neighbourIdx;
+                    }
+                }
+            }
+            mainCell->f = mainCell->g + mainCell->h;
+        }
+
+        if (mainCellIdx == targetIdx)
+        {
+            storePath(listCell, targetIdx, result);
+            status = SEARCH_FOUND;
+            break;
+        }
+
+        if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITING))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+        state[mainCellIdx] = LBL_VISITED;
+        result->stats.expanded++;
+
+        /* Successors are offered the parent of the cell, the cell itself for SOURCE */
+        parentIdx = (mainCell->prev == -1) ? mainCellIdx : mainCell->prev;
+        for (pady = -1; pady <= 1; pady++)
+        {
+            for (padx = -1; padx <= 1; padx++)
+            {
+                float successor_g;
+                Cell* successorCell;
+                int successorIdx;
+
+                if ((padx == 0 && pady == 0) ||
+                    mainX + padx < 0 || mainX + padx >= windowSize.ncol ||
+                    mainY + pady < 0 || mainY + pady >= windowSize.nrow)
+                    continue;
+
+                successorIdx = mainCellIdx + padx + pady * windowSize.ncol;
+                successorCell = &listCell[successorIdx];
+                if (labels[successorIdx] == LBL_BLOCKED || state[successorIdx] == LBL_VISITED ||
+                    successorIdx == sourceIdx)
+                    continue;
+
+                successor_g = listCell[parentIdx].g + euclideanDistance(parentIdx, successorIdx, windowSize.ncol);
+                if (successorCell->g <= successor_g)
+                    continue;
+
+                if (successorCell->h == INT_MAX)
+                    successorCell->h = euclideanDistance(successorIdx, targetIdx, windowSize.ncol);
+                successorCell->g = successor_g;
+                successorCell->f = successor_g + successorCell->h;
+                successorCell->prev = parentIdx;
+
+                state[successorIdx] = LBL_TOBEVISITED;
+                openListPush(&openList, successorIdx, successorCell->f,
+                             tieBreakValue(query->tieBreaking, successor_g, successorCell->h));
+                result->stats.generated++;
+                result->stats.maxOpenSize = MAX2(result->stats.maxOpenSize, (long) openList.size);
+                if (NOTIFY_OBSERVER(query, successorIdx, LBL_TOBEVISITED))
+                {
+                    status = SEARCH_ABORTED;
+                    goto done;
+                }
+            }
+        }
+
+        if (NOTIFY_OBSERVER(query, mainCellIdx, LBL_VISITED))
+        {
+            status = SEARCH_ABORTED;
+            break;
+        }
+    }
+
+done:
+    openListFree(&openList);
+    free(state);
+    free(listCell);
+
+    return status;
+}
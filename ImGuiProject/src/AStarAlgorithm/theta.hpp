@@ -0,0 +1,13 @@
+/*
+ * Lazy Theta* (Nash, Koenig & Tovey, 2010): any-angle A*. The parent of a
+ * cell may be any ancestor it can see, not only a neighbour, so paths are
+ * straight segments between a few waypoints instead of a zig-zag of 45 and
+ * 90 degrees moves. The line of sight is only checked when a cell is
+ * expanded, once per expansion instead of once per successor.
+ */
+#pragma once
+
+#include "astar.hpp"
+
+bool lineOfSight(const BlockLabels* labels, Grid windowSize, int fromIdx, int toIdx);
+SearchStatus lazyThetaSearch(const SearchQuery *query, SearchResult *result);
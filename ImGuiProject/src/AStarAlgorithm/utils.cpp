@@ -7,7 +7,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <utility>
-#include <set>
+#include <string.h>
 #include <iostream>
 #include <sys/time.h>
 #include <unistd.h>
@@ -16,6 +16,7 @@
 #include <pthread.h>
 
 #include "utils.hpp"
+#include "bitbfs.hpp"
 
 
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -123,99 +124,6 @@ void initLabels(BlockLabels **labels, Grid* windowSize)
     assert((*labels)[sourceIdx] != LBL_BLOCKED && (*labels)[targetIdx] != LBL_BLOCKED);
 }
 
-/*
- * Initialize a heuristic distance from each node to the target
- * The distance is composed of three kinds of movement: 1. Vertical,
- * 2. Horizontal, 3. Diagonal 45 degrees.
- */
-float* initHeuristicDistance(BlockLabels* labels, Grid *windowSize)
-{
-    assert(sourceIdx >= 0 && targetIdx >= 0); /* To be removed */
-
-    int idx, numElement;
-    ImVec2 target;
-    float* heuDistance;
-
-    numElement = windowSize->nrow * windowSize->ncol;
-    target = GetBlockByIdx(targetIdx, windowSize->ncol);
-    heuDistance = (float*) malloc(numElement * sizeof(float));
-
-    for (idx = 0; idx < numElement; ++idx)
-    {
-        if (labels[idx] == LBL_BLOCKED)
-        {
-            heuDistance[idx] = INT_MAX;
-            continue;
-        }
-
-        ImVec2 currentBlock = GetBlockByIdx(idx, windowSize->ncol);
-        int diffX = ABS(target.x - currentBlock.x);
-        int diffY = ABS(target.y - currentBlock.y);
-
-        if (diffX > diffY)
-            heuDistance[idx] = (diffX - diffY) + diffY * SQRT2;
-        else
-            heuDistance[idx] = (diffY - diffX) + diffX * SQRT2;
-    }
-
-    return heuDistance;
-};
-
-/*
- * Init a list cell representing all block in the grid with additional
- * information about heuristic distance from the block to TARGET.
- */
-Cell* initListCell(float* heuDistance, Grid* windowSize)
-{
-    int i, numElement;
-    Cell *listCell;
-
-    numElement = windowSize->nrow * windowSize->ncol;
-    listCell   = (Cell*) malloc(sizeof(Cell) * numElement);
-
-    for (i = 0; i < numElement; i++)
-    {
-        listCell[i].block       = GetBlockByIdx(i, windowSize->ncol);
-        listCell[i].f           = INT_MAX;
-        listCell[i].g           = (i == sourceIdx) ? 0.0f : INT_MAX;
-        listCell[i].h           = heuDistance[i];
-        listCell[i].f_order     = INT_MAX -  ((float) i / (numElement + 1));
-        listCell[i].prev        = NULL;
-    }
-
-    return listCell;
-}
-
-bool isValidBlock(ImVec2 blk, Grid* windowSize)
-{
-    return (blk.x >= 0 &&
-            blk.x < windowSize->ncol &&
-            blk.y >= 0 &&
-            blk.y < windowSize->nrow);
-}
-
-bool isValidIdx(int idx, int numElement)
-{
-    return (idx >= 0 &&
-            idx < numElement);
-}
-
-float adjDistance(int padx, int pady)
-{
-    if (padx == 0 && pady == 0)
-        return 0.0f;
-    if (padx == 0 || pady == 0)
-        return 1.0f;
-    return (float) SQRT2;
-}
-
-long getCurrentMicroSecs()
-{
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    return (long) now.tv_sec * (int)1e6 + now.tv_usec;
-}
-
 ImVec2 blockToPosition(ImVec2 block)
 {
     float x = block.x * blockSize + blockSize / 2;
@@ -277,10 +185,10 @@ void getDrawablePos(ImVec2& outside, ImVec2 inside, Grid windowSize)
     }
 }
 
-void drawLine(ImDrawList* draw_list, Cell* from, Cell* to, Grid windowSize) /* TODO: draw arrow on a side of a line. */
+void drawLine(ImDrawList* draw_list, ImVec2 from, ImVec2 to, Grid windowSize) /* TODO: draw arrow on a side of a line. */
 {
-    ImVec2 fromPos = GetBlockCenter(GetBlockPosition(from->block.x, from->block.y, blockSize), blockSize); 
-    ImVec2 toPos   = GetBlockCenter(GetBlockPosition(to->block.x, to->block.y, blockSize), blockSize); 
+    ImVec2 fromPos = GetBlockCenter(GetBlockPosition(from.x, from.y, blockSize), blockSize);
+    ImVec2 toPos   = GetBlockCenter(GetBlockPosition(to.x, to.y, blockSize), blockSize);
     if (outOfBox(fromPos, windowSize) && outOfBox(toPos, windowSize))
         return;
 
@@ -293,27 +201,23 @@ void drawLine(ImDrawList* draw_list, Cell* from, Cell* to, Grid windowSize) /* T
     draw_list->AddLine(fromPos, toPos, IM_COL_RED, LINE_THICKNESS);
 }
 
-void endExec(Cell* listCell, Grid windowSize)
+void endExec(const SearchResult* result, Grid windowSize)
 {
-    Cell* runningCell;
-    int runningIdx;
+    int i;
     int ncol = windowSize.ncol;
     ImDrawList* draw_list = ImGui::GetForegroundDrawList();
 
-    runningCell = &listCell[targetIdx];
-    runningIdx = targetIdx;
-
-    while (runningIdx != sourceIdx)
-    {
-        drawLine(draw_list, runningCell->prev, runningCell, windowSize);
-        runningCell = runningCell->prev;
-        runningIdx = GetIdxByBlock(runningCell->block, ncol);
-    }
+    /* print the path from TARGET to SOURCE */
+    for (i = result->pathLen - 1; i > 0; i--)
+        drawLine(draw_list,
+                 GetBlockByIdx(result->path[i - 1], ncol),
+                 GetBlockByIdx(result->path[i], ncol),
+                 windowSize);
 }
 
 void RandomGrid(BlockLabels** labels, Grid* windowSize, float blockedRatio)
 {
-    int idx, numElement;
+    int numElement;
 
     numElement = windowSize->nrow * windowSize->ncol;
 
@@ -323,47 +227,43 @@ void RandomGrid(BlockLabels** labels, Grid* windowSize, float blockedRatio)
     *labels = (BlockLabels*) malloc(numElement * sizeof(BlockLabels));
     pthread_mutex_unlock(&mutex);
 
-    /* Random two unique numbers between 0 and numElement to be source and target: */
-    sourceIdx = rand() % numElement;
-    targetIdx = -1;
-    do {
-        targetIdx = rand() % numElement;
-    }
-    while (targetIdx == sourceIdx);
+    randomGrid(*labels, *windowSize, blockedRatio, rand(), &sourceIdx, &targetIdx);
+}
 
-    (*labels)[sourceIdx] = LBL_UNBLOCKED;
-    (*labels)[targetIdx] = LBL_UNBLOCKED;
+/*
+ * Observer handed to libastar: mirror every state change on the main screen
+ * and slow the search down to `stepPerSecs`. Return non-zero to make the
+ * library stop as soon as the main thread says force end.
+ */
+static int visualizeStep(void* userData, int idx, BlockLabels label)
+{
+    ThreadSearchingState *shared = (ThreadSearchingState*) userData;
 
-    for (idx = 0; idx < numElement; idx++)
-    {
-        if (idx == sourceIdx ||
-            idx == targetIdx)
-            continue;
-        /* Random a number to be BLOCKED (blockedRatio) or UNBLOCKED (1-blockedRatio - the rest) */
-        int ranNum = rand() % 1000;
-        if (ranNum < 1000 * blockedRatio)
-            (*labels)[idx] = LBL_BLOCKED;
-        else
-            (*labels)[idx] = LBL_UNBLOCKED;
-    }
+    /* Busy waiting if the main thread says PAUSED */
+    while(*(shared->state) == THREAD_PAUSED) {
+        // deadlock might occur if we PAUSE at child, RESET at main and dont check this if-else
+    };
+    CHECK_THREAD_EXITED(*(shared->state), 1);
+
+    pthread_mutex_lock(&mutex);
+    if (idx != sourceIdx)
+        shared->labels[idx] = label; /* To change the color in main screen */
+    pthread_mutex_unlock(&mutex);
+
+    /*
+     * Because there might be a RESET signal which interrupts this execution immediately,
+     * we use `busy waiting` so that we can exit the system when `forceEnd` is set
+     */
+    if (label != LBL_VISITING)
+        BUSY_DELAY_EXECUTION(*(shared->state), 1, 1/stepPerSecs * 1e6);
+
+    return 0;
 }
 
 /*
- * DESIGN:
- *  Calculate unblocked-target heuristic from each point to target
- *  Blocked-target = infinity
- *
- * n: one of 8 neighbor
- * g(n): exact cost from SOURCE to n.
- * h(n): estimated cost from n to TARGET
- * f(n) = g(n) + h(h)
- *
- * Coordinator is as below:
- * O -------------> x
- * |
- * |
- * |
- * y
+ * Child thread entry of the visualizer. The search itself lives in libastar
+ * (findPath() runs the selected engine); here we only take a private copy of the grid, run the search
+ * with the animating observer and publish the result.
  */
 void *execAStar(void* arg)
 {
@@ -372,168 +272,54 @@ void *execAStar(void* arg)
     Grid *windowSize = &(shared->windowSize);
     int idx;
     int numElement = (int) windowSize->nrow * windowSize->ncol;
+    BlockLabels* gridCopy;
+    SearchQuery query;
+    SearchStatus status;
+    BitGrid* bitGrid;
+    bool reachable;
 
-    float* heuDistance;
-    Cell* listCell;
-    auto comp = [](Cell* a, Cell* b) {return (a->f_order < b->f_order);};
-    std::set<Cell*, decltype(comp)> openList = std::set<Cell*, decltype(comp)> (comp);
+    gridCopy = (BlockLabels*) malloc(numElement * sizeof(BlockLabels));
 
+    pthread_mutex_lock(&mutex);
     /* Clear previously run state */
     for (idx = 0; idx < numElement; idx++)
         if (labels[idx] != LBL_BLOCKED) labels[idx] = LBL_UNBLOCKED;
+    memcpy(gridCopy, labels, numElement * sizeof(BlockLabels));
+
+    initSearchQuery(&query);
+    query.labels    = gridCopy;
+    query.grid      = *windowSize;
+    query.sourceIdx = sourceIdx;
+    query.targetIdx = targetIdx;
+    query.observer  = visualizeStep;
+    query.userData  = shared;
+    query.algorithm = shared->algorithm;
+    query.preprocessed = shared->preprocessed;
+    query.openList  = shared->openList;
+    query.tieBreaking = shared->tieBreaking;
+    query.heuristic = shared->heuristic;
+    query.landmarks = shared->landmarks;
+    query.goalBounds = shared->goalBounds;
+    query.swamps = shared->swamps;
+    query.numThreads = shared->numThreads;
+    query.weight = shared->weight;
+    query.timeBudget = shared->timeBudget;
+    pthread_mutex_unlock(&mutex);
 
-    heuDistance = initHeuristicDistance(labels, windowSize);
-    listCell = initListCell(heuDistance, windowSize);
+    /*
+     * Unreachable TARGET: the bit-parallel BFS tells in a few word operations per row what the
+     * engine would only find after closing the whole component of SOURCE; leave the result empty.
+     */
+    bitGrid = bitGridBuild(gridCopy, *windowSize);
+    reachable = bitGridReachable(bitGrid, sourceIdx, targetIdx);
+    bitGridFree(bitGrid);
 
-    /* Init the openList with the source in order to start traversing */
-    openList.insert(&listCell[sourceIdx]);
+    status = reachable ? findPath(&query, &shared->result) : SEARCH_NOT_FOUND;
+    free(gridCopy);
 
-    while (!openList.empty())
-    {
-        /*
-         * If the main thread says force end, stop immediately.
-         * This seems to be redundant as we already check inside
-         * two nested for-loop condition below. But we just leave
-         * it here, and might remove it later.
-         */
-        CHECK_THREAD_EXITED(*(shared->state), heuDistance);
-
-        int padx, pady;
-        Cell* mainCell;
-        int mainCellIdx;
-
-        mainCell = *openList.begin();
-        openList.erase(openList.begin());
-        mainCellIdx = GetIdxByBlock(mainCell->block, windowSize->ncol);
-
-        /* Finally reach the TARGET? */
-        if (mainCellIdx == targetIdx)
-        {
-            shared->listCell = listCell;
-
-            break;
-        }
-
-        if (labels[mainCellIdx] == LBL_VISITED)
-            /* This block (with the seemingly shorter distance) has been already visited by other path */
-            continue;
-        /* We might want to visit cell that is ready to be visited */
-        else if (labels[mainCellIdx] == LBL_TOBEVISITED)
-        {
-            pthread_mutex_lock(&mutex);
-            /* First time this block is visited */
-            labels[mainCellIdx] = LBL_VISITED; // redundant as we assign it as visited at the end.
-            pthread_mutex_unlock(&mutex);
-        }
-        else if (mainCellIdx != sourceIdx)
-        {
-            /* Weird enough? This should not happen */
-            printf("ERROR HAPPENED");
-            pthread_mutex_lock(&mutex);
-            *(shared->state) = THREAD_EXITED; /* do we need this? Am I sure that the solution is founded?*/
-            pthread_mutex_unlock(&mutex);
-            return NULL;
-        }
-
-        pthread_mutex_lock(&mutex);
-        labels[mainCellIdx] = LBL_VISITING; /* To change the color in main screen */
-        pthread_mutex_unlock(&mutex);
-
-        for (pady = -1; pady <= 1; pady ++)
-        {
-            for (padx = -1; padx <= 1; padx ++)
-            {
-                /* Busy waiting if the main thread says PAUSED */
-                while(*(shared->state) == THREAD_PAUSED) {
-                    // deadlock might occur if we PAUSE at child, RESET at main and dont check this if-else
-                };
-                CHECK_THREAD_EXITED(*(shared->state), heuDistance);
-
-                float successor_f, successor_g, successor_h;
-                Cell* successorCell;
-                ImVec2 blk = ImVec2(mainCell->block.x+padx, mainCell->block.y+pady);
-                int successorIdx = GetIdxByBlock(blk, windowSize->ncol);
-
-                if (!isValidIdx(successorIdx, numElement))
-                    continue;
-
-                successorCell = &listCell[successorIdx];
-                successorCell->block.x = mainCell->block.x + padx; /* Are these redundant? */
-                successorCell->block.y = mainCell->block.y + pady;
-
-                /* Skip if the successor is invalid (out of grid) */
-                if (!isValidBlock(successorCell->block, windowSize))
-                    continue;
-
-                /*
-                 * Skip if the successor is BLOCKED, or SOURCE
-                 *
-                 * We still process if the successor is VISITED,
-                 * since new shorter distance might be found and
-                 * updated later.
-                 */
-                if (labels[successorIdx] == LBL_BLOCKED ||
-                    labels[successorIdx] == LBL_VISITING ||
-                    successorIdx == sourceIdx)
-                {
-                    continue;
-                }
-
-                /*
-                 * Because there might be a RESET signal which interrupts this execution immediately,
-                 * we use `busy waiting` so that we can exit the system when `forceEnd` is set
-                 */
-                BUSY_DELAY_EXECUTION(*(shared->state), heuDistance, 1/stepPerSecs * 1e6);
-
-                /* process each successor */
-                successor_g = mainCell->g + adjDistance(padx, pady);    /* from source to successor */
-                successor_h = heuDistance[successorIdx];                /* from successor to target */
-                successor_f = successor_g + successor_h;                /* total from source to target */
-
-                /*
-                 * Update shortest path to the boundary of current block accordingly
-                 *
-                 * The cell may be visited in next rounds if either the new way with
-                 * shorter path is found, or it has not been visited yet.
-                 */
-                if (successorCell->g > successor_g)
-                {
-                    successorCell->f = successor_f;
-                    successorCell->g = successor_g;
-                    successorCell->h = successor_h;
-                    /*
-                     * The set only save one element of a given key; therefore, in order
-                     * for the set to save different block with the same successor_f distance while
-                     * remaining the relative distance with other blocks, we add some
-                     * insignificantly extra `distance` and use it as key to distinguish.
-                     */
-                    successorCell->f_order = successor_f + ((float)successorIdx / (numElement * 100));
-                    successorCell->prev = mainCell;
-                    pthread_mutex_lock(&mutex);
-                    /* As new path with shorter distance is updated, we might re-visit it again. */
-                    if (labels[successorIdx] == LBL_UNBLOCKED)
-                        labels[successorIdx] = LBL_TOBEVISITED;
-                    pthread_mutex_unlock(&mutex);
-
-                    openList.insert(successorCell);
-                }
-            }
-        }
-
-        BUSY_DELAY_EXECUTION(*(shared->state), heuDistance, 1/stepPerSecs * 1e6);
-        /* Un-macro version: */
-        // prevTime = getCurrentMicroSecs();
-        // while (getCurrentMicroSecs() - prevTime < 1/stepPerSecs * 1e6)// ~ waitingTimeInterval
-        // {
-        //     CHECK_THREAD_EXITED(*(shared->state), heuDistance);
-        //     usleep(100); /* just waiting */
-        // };
-
-        pthread_mutex_lock(&mutex);
-        if (mainCellIdx != sourceIdx)
-            labels[mainCellIdx] = LBL_VISITED;
-        pthread_mutex_unlock(&mutex);
-    }
+    /* Force ended by the main thread: it will join us, nothing to report */
+    if (status == SEARCH_ABORTED)
+        return NULL;
 
     pthread_mutex_lock(&mutex);
     *(shared->state) = THREAD_FINISHED;
@@ -5,6 +5,8 @@
 #include <SDL.h>
 #include <SDL_opengl.h>
 
+#include "astar.hpp"
+
 /* constant colors used to present searching states at the main screen */
 #define WHITE                   ImVec4(1.0f, 1.0f, 1.0f, 1.0f)
 #define GRAY                    ImVec4(0.5f, 0.5f, 0.5f, 1.0f)
@@ -20,15 +22,8 @@
 #define IM_COL_RED              IM_COL32(255, 0, 0, 255)
 #define BORDER_THICKNESS        0.3f
 
-#define ABS(x)                  ((x > 0) ? (x) : -(x))
-#define MAX2(x, y)              ((x > y) ? (x) : (y))
-#define MIN2(x, y)              ((x < y) ? (x) : (y))
-
 #define LINE_THICKNESS          3.0f
 
-/* to avoid including math.h header to calculate square root */
-#define SQRT2                   1.41421356f
-
 #define MAIN_SCREEN_FPS         60
 #define BUTTON_SIZE             ImVec2(120, 30)
 #define BUTTON_SIZE_LARGE       ImVec2(200, 30)
@@ -40,20 +35,19 @@
 
 #define GetIdxByBlock(blk, size) ((int)(blk.x + blk.y * size))
 
-#define CHECK_THREAD_EXITED(state, toBeFreed) \
+#define CHECK_THREAD_EXITED(state, retval) \
 do { \
         if (state == THREAD_EXITED) { \
-            free(toBeFreed); \
-            return NULL; \
+            return retval; \
         } \
 } while(0);
 
-#define BUSY_DELAY_EXECUTION(state, toBeFreed, timeout) \
+#define BUSY_DELAY_EXECUTION(state, retval, timeout) \
 do { \
     long prevTime = getCurrentMicroSecs(); \
     while (getCurrentMicroSecs() - prevTime < timeout) \
     { \
-        CHECK_THREAD_EXITED(state, toBeFreed); \
+        CHECK_THREAD_EXITED(state, retval); \
         usleep(100); \
     }; \
 } while(0);
@@ -63,15 +57,6 @@ do { \
 
 #define GetBlockCenter(blk, blkSize)                    (ImVec2(blk.x + blkSize/2, blk.y + blkSize/2))
 
-typedef enum BlockLabels
-{
-    LBL_UNBLOCKED,
-    LBL_BLOCKED,
-    LBL_VISITED,
-    LBL_VISITING,
-    LBL_TOBEVISITED
-} BlockLabels;
-
 typedef enum ChoosingLabel
 {
     CHOOSE_SOURCE,
@@ -88,38 +73,29 @@ typedef enum ThreadState
     THREAD_EXITED               /* The child thread is exited => joined => line-draw of previous run is cleared */
 } ThreadState;
 
-typedef struct Cell
-{
-    ImVec2       block;
-    float        f;             /* Total distance (f = g + h)                   */
-    float        g;             /* Exact distance from SOURCE to this Cell      */
-    float        h;             /* Heuristic distance from this Cell to TARGET  */
-    float        f_order;       /* f + (insignificant amount), used to compare
-                                   Cell so that all Cell are uniquely stored    */
-    Cell        *prev;          /* previous Cell that when go through it
-                                   recursively, we will end at SOURCE, and
-                                   archive the total distance `g`               */
-} Cell;
-
-typedef struct Grid
-{
-    int          nrow;
-    int          ncol;
-} Grid;
-
 typedef struct ThreadSearchingState
 {
     BlockLabels     *labels;
     Grid             windowSize;
     ThreadState     *state;
-    Cell            *listCell;      /* state of nrow*ncol cell in listCell */
+    SearchAlgorithm  algorithm;     /* engine of libastar used for this run */
+    const void      *preprocessed;  /* map data of that engine, see SearchQuery */
+    OpenListKind     openList;      /* open list used by libastar for this run */
+    TieBreaking      tieBreaking;
+    HeuristicKind    heuristic;     /* A* only */
+    const AltTable  *landmarks;     /* HEURISTIC_ALT: table of the current grid */
+    const GoalBoundTable *goalBounds; /* A* and JPS: pruning table of the current grid, NULL: off */
+    const SwampMap  *swamps;        /* A*: dead-end regions of the current grid, NULL: off */
+    int              numThreads;    /* parallel engines: threads of the search itself */
+    float            weight;        /* ARA*: first inflation of the heuristic */
+    long             timeBudget;    /* ARA*: microseconds to improve the path, 0: until optimal */
+    SearchResult     result;        /* path found by the last run, pathLen = 0 if none */
 } ThreadSearchingState;
 
 
 void printBlockNotation();
 void initLabels(BlockLabels **labels, Grid* windowSize);
 void reCalculateBlockSize(Grid* windowSize);
-long getCurrentMicroSecs();
-void endExec(Cell* listCell, Grid windowSize);
+void endExec(const SearchResult* result, Grid windowSize);
 void RandomGrid(BlockLabels** labels, Grid* windowSize, float blockedRatio);
 void *execAStar(void* arg);